@@ -4,6 +4,7 @@ import multiprocessing as mpr
 from libcpp.string cimport string
 from libcpp.vector cimport vector 
 from libcpp cimport bool
+from libc.stdint cimport uint64_t
 cimport cython
 cimport cython.floating
 
@@ -36,25 +37,40 @@ cdef extern from "zentas/zentasinfo.hpp" namespace "nszen":
   string get_python_seq_string() except +;
   string get_python_spa_string() except +;
   string get_python_den_string() except +;
+  string get_python_bvec_string() except +;
+  string get_python_tseries_string() except +;
   string get_output_verbose_string() except +;
 
 
 cdef extern from "zentas/zentas.hpp" namespace "nszen":
 
   # dense vectors 
-  void vzentas[T](size_t ndata, size_t dimension, const T * const ptr_datain, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_vdimap, bool do_refinement, string rf_alg,size_t rf_max_rounds, double rf_max_time, bool do_balance_labels) except +;
+  void vzentas[T](size_t ndata, size_t dimension, const T * const ptr_datain, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_vdimap, bool do_refinement, string rf_alg,size_t rf_max_rounds, double rf_max_time, bool do_balance_labels, string storage, size_t reorder_interval) except +;
 
   # set the centers for dense data from labels etc.
   void set_vcenters[T](size_t ndata, size_t dimensions, const T * const ptr_datain, size_t K, const size_t * const labels, T * centers) except+;
   
   # sparse vectors 
-  void sparse_vector_zentas[T](size_t ndata, const size_t * const sizes, const T * const ptr_datain, const size_t * const ptr_indices_s, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_refinement, string rf_alg, size_t rf_max_rounds, double rf_max_time, bool do_balance_labels) except +;
+  void sparse_vector_zentas[T](size_t ndata, const size_t * const sizes, const T * const ptr_datain, const size_t * const ptr_indices_s, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_refinement, string rf_alg, size_t rf_max_rounds, double rf_max_time, bool do_balance_labels, size_t reorder_interval) except +;
 
   # strings / sequences 
-  void szentas[T](size_t ndata, const size_t * const sizes, const T * const ptr_datain, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, bool with_cost_matrices, size_t dict_size, double c_indel, double c_switch, const double * const c_indel_arr, const double * const c_switches_arr, double critical_radius, double exponent_coeff, bool do_balance_labels) except +;
+  void szentas[T](size_t ndata, const size_t * const sizes, const T * const ptr_datain, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, bool with_cost_matrices, size_t dict_size, double c_indel, double c_switch, const double * const c_indel_arr, const double * const c_switches_arr, double critical_radius, double exponent_coeff, bool do_balance_labels, size_t distance_cache_size, string storage, bool with_profiles) except +;
+
+  # packed binary vectors
+  void bvzentas(size_t ndata, size_t n_bits, const uint64_t * const ptr_datain, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, size_t distance_cache_size, double critical_radius, double exponent_coeff, bool do_balance_labels) except +;
+
+  # time series
+  void tszentas[T](size_t ndata, const size_t * const sizes, const T * const ptr_datain, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, size_t window, size_t distance_cache_size, double critical_radius, double exponent_coeff, bool do_balance_labels) except +;
 
   # sequences from text file
-  void textfilezentas(vector[string] filenames, string outfilename, string costfilename, size_t K, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, string initialisation_method, bool do_balance_labels) except +;
+  void textfilezentas(vector[string] filenames, string outfilename, string costfilename, size_t K, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, string initialisation_method, bool do_balance_labels, size_t distance_cache_size, string storage, bool with_profiles) except +;
+
+  # dense vectors, sparse vectors and sequences from memory mapped .npy files
+  void npyvzentas(string filename, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, double critical_radius, double exponent_coeff, size_t reorder_interval, bool do_balance_labels) except +;
+
+  void npysparse_vector_zentas(string sizes_filename, string values_filename, string indices_filename, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, double critical_radius, double exponent_coeff, size_t reorder_interval, bool do_balance_labels) except +;
+
+  void npyszentas(string sizes_filename, string values_filename, size_t K, const size_t * const indices_init, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool capture_output, string & text, size_t seed, double max_time, double min_mE, double max_itok, size_t * const indices_final, size_t * const labels, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool with_cost_matrices, size_t dict_size, double c_indel, double c_switch, const double * const c_indel_arr, const double * const c_switches_arr, size_t distance_cache_size, double critical_radius, double exponent_coeff, bool do_balance_labels) except +;
   
 
 
@@ -244,10 +260,10 @@ class pyzen(object):
   ##################################################
   
   
-  def base_vzentas(self, floating87 [:] X_v, do_vdimap, do_refinement, rf_alg, rf_max_rounds, rf_max_time, size_t [:] indices_init, pms):
+  def base_vzentas(self, floating87 [:] X_v, do_vdimap, storage, do_refinement, rf_alg, rf_max_rounds, rf_max_time, reorder_interval, size_t [:] indices_init, pms):
 
 
-    cdef void (*cw_vzentas)(size_t, size_t, const floating87 * const, size_t, const size_t * const, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool, string &, size_t seed, double max_time, double min_mE, double max_itok, size_t * const i_f, size_t * const labs, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_vdimap, bool do_refinement, string rf_alg,  size_t rf_max_rounds, double rf_max_time, bool do_balance_labels) except +
+    cdef void (*cw_vzentas)(size_t, size_t, const floating87 * const, size_t, const size_t * const, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool, string &, size_t seed, double max_time, double min_mE, double max_itok, size_t * const i_f, size_t * const labs, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_vdimap, bool do_refinement, string rf_alg,  size_t rf_max_rounds, double rf_max_time, bool do_balance_labels, string storage, size_t reorder_interval) except +
 
   
     if floating87 is double:
@@ -259,7 +275,7 @@ class pyzen(object):
     cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
     
     
-    cw_vzentas(pms['ndata'], pms['dimension'], &X_v[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &rb.indices_final[0], &rb.labels[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], pms['critical_radius'], pms['exponent_coeff'], do_vdimap, do_refinement, rf_alg, rf_max_rounds, rf_max_time, pms['do_balance_labels'])
+    cw_vzentas(pms['ndata'], pms['dimension'], &X_v[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &rb.indices_final[0], &rb.labels[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], pms['critical_radius'], pms['exponent_coeff'], do_vdimap, do_refinement, rf_alg, rf_max_rounds, rf_max_time, pms['do_balance_labels'], storage, reorder_interval)
 
     return rb.get_dict()
 
@@ -271,7 +287,9 @@ class pyzen(object):
     do_refinement = False, 
     rf_alg = "yinyang", 
     rf_max_rounds = 99999, 
-    rf_max_time = 1e7
+    rf_max_time = 1e7,
+    storage = "full",
+    reorder_interval = 0
     ):
     """
     den(se) clustering
@@ -285,7 +303,7 @@ class pyzen(object):
     
     self.pms['ndata'], self.pms['dimension'] = X.shape    
     
-    dict0 = dangerwrap(lambda : self.base_vzentas(X.ravel(), do_vdimap, do_refinement, rf_alg, rf_max_rounds, rf_max_time, self.pms['indices_init'], self.pms))
+    dict0 = dangerwrap(lambda : self.base_vzentas(X.ravel(), do_vdimap, storage, do_refinement, rf_alg, rf_max_rounds, rf_max_time, reorder_interval, self.pms['indices_init'], self.pms))
     
     
     
@@ -297,9 +315,9 @@ class pyzen(object):
   ####################################################
 
   
-  def base_sparse_vector_zentas(self, size_t [:] sizes, size_t [:] indices, floating87 [:] values, do_refinement, rf_alg, rf_max_rounds, rf_max_time, size_t [:] indices_init, pms):
+  def base_sparse_vector_zentas(self, size_t [:] sizes, size_t [:] indices, floating87 [:] values, do_refinement, rf_alg, rf_max_rounds, rf_max_time, reorder_interval, size_t [:] indices_init, pms):
   
-    cdef void (*cw_sparse_vector_zentas)(size_t, const size_t * const, const floating87 * const, const size_t * const, size_t, const size_t * const, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool, string &, size_t seed, double max_time, double min_mE, double max_itok, size_t * const i_f, size_t * const labs, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_refinement, string rf_alg, size_t rf_max_rounds, double rf_max_time, bool do_balance_labels) except +
+    cdef void (*cw_sparse_vector_zentas)(size_t, const size_t * const, const floating87 * const, const size_t * const, size_t, const size_t * const, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool, string &, size_t seed, double max_time, double min_mE, double max_itok, size_t * const i_f, size_t * const labs, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, double critical_radius, double exponent_coeff, bool do_refinement, string rf_alg, size_t rf_max_rounds, double rf_max_time, bool do_balance_labels, size_t reorder_interval) except +
 
     if floating87 is double:
       cw_sparse_vector_zentas=&sparse_vector_zentas[double]
@@ -309,7 +327,7 @@ class pyzen(object):
 
     cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
     
-    cw_sparse_vector_zentas(pms['ndata'], &sizes[0], &values[0], &indices[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &(rb.indices_final)[0], &(rb.labels)[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], pms['critical_radius'], pms['exponent_coeff'], do_refinement, rf_alg, rf_max_rounds, rf_max_time, pms['do_balance_labels'])
+    cw_sparse_vector_zentas(pms['ndata'], &sizes[0], &values[0], &indices[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &(rb.indices_final)[0], &(rb.labels)[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], pms['critical_radius'], pms['exponent_coeff'], do_refinement, rf_alg, rf_max_rounds, rf_max_time, pms['do_balance_labels'], reorder_interval)
 
     return rb.get_dict()
       
@@ -320,7 +338,8 @@ class pyzen(object):
     do_refinement = False, 
     rf_alg = "yinyang", 
     rf_max_rounds = 99999, 
-    rf_max_time = int(1e7)
+    rf_max_time = int(1e7),
+    reorder_interval = 0
     ):
     """
     spa(rse) clustering
@@ -332,16 +351,16 @@ class pyzen(object):
     if (values.size != sizes.sum()):
       raise RuntimeError("the sum of sizes is not the size of values ")
             
-    return dangerwrap(lambda : self.base_sparse_vector_zentas(sizes, indices, values, do_refinement, rf_alg, rf_max_rounds, rf_max_time, self.pms['indices_init'], self.pms))
+    return dangerwrap(lambda : self.base_sparse_vector_zentas(sizes, indices, values, do_refinement, rf_alg, rf_max_rounds, rf_max_time, reorder_interval, self.pms['indices_init'], self.pms))
 
 
   ##################################################
   ################# sequence data ##################
   ##################################################
 
-  def base_szentas(self, size_t [:] sizes, char_or_int [:] values, size_t [:] indices_init, with_cost_matrices, dict_size, c_indel, c_switch, double [:] c_indel_arr, double [:] c_switches_arr, pms):
+  def base_szentas(self, size_t [:] sizes, char_or_int [:] values, size_t [:] indices_init, with_cost_matrices, dict_size, c_indel, c_switch, double [:] c_indel_arr, double [:] c_switches_arr, distance_cache_size, storage, with_profiles, pms):
 
-    cdef void (*cw_szentas)(size_t, const size_t * const, const char_or_int * const, size_t, const size_t * const, string initialisation_method, string, size_t, size_t, bool , string & , size_t, double, double min_mE, double max_itok, size_t * const , size_t * const, string, size_t, size_t, bool, string, bool, bool, bool, size_t, double, double, const double * const, const double * const, double critical_radius, double exponent_coeff, bool do_balance_labels) except +
+    cdef void (*cw_szentas)(size_t, const size_t * const, const char_or_int * const, size_t, const size_t * const, string initialisation_method, string, size_t, size_t, bool , string & , size_t, double, double min_mE, double max_itok, size_t * const , size_t * const, string, size_t, size_t, bool, string, bool, bool, bool, size_t, double, double, const double * const, const double * const, double critical_radius, double exponent_coeff, bool do_balance_labels, size_t distance_cache_size, string storage, bool with_profiles) except +
     
     if char_or_int is int:
       cw_szentas = &szentas[int]
@@ -351,11 +370,11 @@ class pyzen(object):
 
     cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
         
-    cw_szentas(pms['ndata'], &sizes[0], &values[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &(rb.indices_final)[0], &(rb.labels)[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], with_cost_matrices, dict_size, c_indel, c_switch, &c_indel_arr[0], &c_switches_arr[0], pms['critical_radius'], pms['exponent_coeff'], pms['do_balance_labels'])
+    cw_szentas(pms['ndata'], &sizes[0], &values[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &(rb.indices_final)[0], &(rb.labels)[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], with_cost_matrices, dict_size, c_indel, c_switch, &c_indel_arr[0], &c_switches_arr[0], pms['critical_radius'], pms['exponent_coeff'], pms['do_balance_labels'], distance_cache_size, storage, with_profiles)
     
     return rb.get_dict()
   
-  def seq(self, sizes, values, cost_indel, cost_switch):
+  def seq(self, sizes, values, cost_indel, cost_switch, distance_cache_size = 0, storage = "full", with_profiles = False):
     if isinstance(cost_indel, Number) and isinstance(cost_switch, Number):
       dict_size = 0
       c_indel_arr = self.null['double']
@@ -396,14 +415,114 @@ class pyzen(object):
     
     
     self.pms['ndata'] = sizes.size  
-    return dangerwrap(lambda : self.base_szentas(sizes, values, self.pms['indices_init'], with_cost_matrices, dict_size, c_indel, c_switch, c_indel_arr.ravel(), c_switch_arr.ravel(), self.pms))
+    return dangerwrap(lambda : self.base_szentas(sizes, values, self.pms['indices_init'], with_cost_matrices, dict_size, c_indel, c_switch, c_indel_arr.ravel(), c_switch_arr.ravel(), distance_cache_size, storage, with_profiles, self.pms))
       
     
+  ##################################################
+  ############## packed binary vectors #############
+  ##################################################
+
+  def base_bvzentas(self, uint64_t [:] X_v, n_bits, distance_cache_size, size_t [:] indices_init, pms):
+
+    cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
+
+    bvzentas(pms['ndata'], n_bits, &X_v[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &(rb.indices_final)[0], &(rb.labels)[0], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], distance_cache_size, pms['critical_radius'], pms['exponent_coeff'], pms['do_balance_labels'])
+
+    return rb.get_dict()
+
+  def bvec(self, X, n_bits, distance_cache_size = 0):
+    """
+    b(inary) vec(tor) clustering
+    """
+
+    X = np.ascontiguousarray(X, dtype = np.uint64)
+    if len(X.shape) != 2 or X.shape[1] != (n_bits + 63) // 64:
+      raise RuntimeError("X should be 2-dimensional, with X.shape = (ndata, (n_bits + 63) // 64)")
+
+    self.pms['ndata'] = X.shape[0]
+    return dangerwrap(lambda : self.base_bvzentas(X.ravel(), n_bits, distance_cache_size, self.pms['indices_init'], self.pms))
+
+  ##################################################
+  ################## time series ###################
+  ##################################################
+
+  def base_tszentas(self, size_t [:] sizes, floating87 [:] values, window, distance_cache_size, size_t [:] indices_init, pms):
+
+    cdef void (*cw_tszentas)(size_t, const size_t * const, const floating87 * const, size_t, const size_t * const, string initialisation_method, string algorithm, size_t level, size_t max_proposals, bool, string &, size_t seed, double max_time, double min_mE, double max_itok, size_t * const i_f, size_t * const labs, string metric, size_t nthreads, size_t max_rounds, bool patient, string energy, bool with_tests, bool rooted, size_t window, size_t distance_cache_size, double critical_radius, double exponent_coeff, bool do_balance_labels) except +
+
+    if floating87 is double:
+      cw_tszentas=&tszentas[double]
+
+    elif floating87 is float:
+      cw_tszentas=&tszentas[float]
+
+    cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
+
+    cw_tszentas(pms['ndata'], &sizes[0], &values[0], pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &(rb.indices_final)[0], &(rb.labels)[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], window, distance_cache_size, pms['critical_radius'], pms['exponent_coeff'], pms['do_balance_labels'])
+
+    return rb.get_dict()
+
+  def tseries(self, sizes, values, window, distance_cache_size = 0):
+    """
+    t(ime) series clustering
+    """
+    self.pms['ndata'] = sizes.size
+    if (values.size != sizes.sum()):
+      raise RuntimeError("the sum of sizes is not the size of values ")
+
+    return dangerwrap(lambda : self.base_tszentas(sizes, values, window, distance_cache_size, self.pms['indices_init'], self.pms))
+
+  ##################################################
+  ############### from .npy files ##################
+  ##################################################
+
+  def base_npy_den(self, filename, reorder_interval, size_t [:] indices_init, pms):
+    cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
+
+    npyvzentas(filename, pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &rb.indices_final[0], &rb.labels[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['critical_radius'], pms['exponent_coeff'], reorder_interval, pms['do_balance_labels'])
+
+    return rb.get_dict()
+
+  def den_npy(self, filename, reorder_interval = 0):
+    """
+    den(se) clustering of the (ndata, dimension) float32 or float64 array in the .npy file filename. The file is memory mapped and clustered rooted, it is never loaded into memory, unless reorder_interval > 0 (see den). 
+    """
+    self.pms['ndata'] = np.load(filename, mmap_mode = 'r').shape[0]
+    return dangerwrap(lambda : self.base_npy_den(filename, reorder_interval, self.pms['indices_init'], self.pms))
+
+  def base_npy_spa(self, sizes_filename, indices_filename, values_filename, reorder_interval, size_t [:] indices_init, pms):
+    cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
+
+    npysparse_vector_zentas(sizes_filename, values_filename, indices_filename, pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &rb.indices_final[0], &rb.labels[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['critical_radius'], pms['exponent_coeff'], reorder_interval, pms['do_balance_labels'])
+
+    return rb.get_dict()
+
+  def spa_npy(self, sizes_filename, indices_filename, values_filename, reorder_interval = 0):
+    """
+    spa(rse) clustering, as spa, with sizes (uint64), indices (uint64) and values (float32 or float64) in .npy files, which are memory mapped as in den_npy.
+    """
+    self.pms['ndata'] = np.load(sizes_filename, mmap_mode = 'r').size
+    return dangerwrap(lambda : self.base_npy_spa(sizes_filename, indices_filename, values_filename, reorder_interval, self.pms['indices_init'], self.pms))
+
+  def base_npy_seq(self, sizes_filename, values_filename, c_indel, c_switch, distance_cache_size, size_t [:] indices_init, double [:] null_arr, pms):
+    cdef RetBundle rb = RetBundle(self.pms['ndata'], self.pms['K'])
+
+    npyszentas(sizes_filename, values_filename, pms['K'], &indices_init[0], pms['initialisation_method'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], &rb.indices_final[0], &rb.labels[0], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], False, 0, c_indel, c_switch, &null_arr[0], &null_arr[0], distance_cache_size, pms['critical_radius'], pms['exponent_coeff'], pms['do_balance_labels'])
+
+    return rb.get_dict()
+
+  def seq_npy(self, sizes_filename, values_filename, cost_indel, cost_switch, distance_cache_size = 0):
+    """
+    seq(uence) clustering, as seq with (float, float) costs, with sizes (uint64) and values (int8, S1 or int32) in .npy files, which are memory mapped as in den_npy, and with_profiles False. With the hamming metric the sequences are packed into memory, at 1 to 8 bits per int8 or S1 value (1 to 32 per int32 value).
+    """
+    self.pms['ndata'] = np.load(sizes_filename, mmap_mode = 'r').size
+    return dangerwrap(lambda : self.base_npy_seq(sizes_filename, values_filename, cost_indel, cost_switch, distance_cache_size, self.pms['indices_init'], self.null['double'], self.pms))
+
   ##################################################
   ################# from files #####################
   ##################################################    
 
-  def base_fromfiles(self, filenames_list, outfilename, costfilename, pms):
+  def base_fromfiles(self, filenames_list, outfilename, costfilename, distance_cache_size, storage, with_profiles, pms):
     cdef vector[string] filenames_vec
     for fn in filenames_list:
       filenames_vec.push_back(fn)
@@ -411,12 +530,12 @@ class pyzen(object):
     dummy_ndata = 0
     cdef RetBundle rb = RetBundle(dummy_ndata, self.pms['K'])
 
-    textfilezentas(filenames_vec, outfilename, costfilename, pms['K'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], pms['critical_radius'], pms['exponent_coeff'], pms['initialisation_method'], pms['do_balanace_centers'])
+    textfilezentas(filenames_vec, outfilename, costfilename, pms['K'], pms['algorithm'], pms['level'], pms['max_proposals'], pms['capture_output'], rb.output_string, pms['seed'], pms['max_time'], pms['min_mE'], pms['max_itok'], pms['metric'], pms['nthreads'], pms['max_rounds'], pms['patient'], pms['energy'], pms['with_tests'], pms['rooted'], pms['critical_radius'], pms['exponent_coeff'], pms['initialisation_method'], pms['do_balanace_centers'], distance_cache_size, storage, with_profiles)
     
     return rb.get_dict()
 
-  def txt_seq(self, filenames_list, outfile, costfile):
-    return dangerwrap(lambda : self.base_fromfiles(filenames_list, outfile, costfile, self.pms))
+  def txt_seq(self, filenames_list, outfile, costfile, distance_cache_size = 0, storage = "full", with_profiles = False):
+    return dangerwrap(lambda : self.base_fromfiles(filenames_list, outfile, costfile, distance_cache_size, storage, with_profiles, self.pms))
     
   def get_output_verbose_string():
     return get_output_verbose_string()
@@ -479,4 +598,6 @@ pyzen.txt_seq.__func__.__doc__ = get_python_txt_seq_string()
 pyzen.seq.__func__.__doc__ = get_python_seq_string()
 pyzen.spa.__func__.__doc__ = get_python_spa_string()
 pyzen.den.__func__.__doc__ = get_python_den_string()
+pyzen.bvec.__func__.__doc__ = get_python_bvec_string()
+pyzen.tseries.__func__.__doc__ = get_python_tseries_string()
 pyzen.get_output_verbose_string.__func__.__doc__ = get_output_verbose_string()
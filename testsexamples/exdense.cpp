@@ -102,6 +102,10 @@ int cluster_dense()
   // varying length.
   bool rooted = false;
 
+  // only relevant if rooted is true : the data is copied in order of cluster after initialisation
+  // and every reorder_interval rounds, so that samples of a cluster are contiguous. 0 for never.
+  size_t reorder_interval = 0;
+
   // only relevant if energy is squarepotential : squarepotential(d) = 1 if d > (>=? need to check)
   // criticial_radius, otherwise 0.
   double critical_radius = 0;
@@ -113,6 +117,11 @@ int cluster_dense()
 
   bool do_vdimap = false;
 
+  // how the data is stored while clustering : "full" (as TFloat), or with reduced precision,
+  // "fp16", "bf16" or "int8". With reduced precision, the medoids are checked with full
+  // precision at the end.
+  std::string storage = "full";
+
   bool do_refinement = false;
 
   std::string rf_alg = "none";
@@ -154,7 +163,9 @@ int cluster_dense()
                          rf_alg,
                          rf_max_rounds,
                          rf_max_time,
-                         do_balance_labels);
+                         do_balance_labels,
+                         storage,
+                         reorder_interval);
 
   // labels and indices_final have now been set, and can now used for the next step in your
   // application.
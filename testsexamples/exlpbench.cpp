@@ -0,0 +1,86 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <zentas/zentas.hpp>
+
+/* Benchmark : clarans on low dimensional dense vectors with many samples. In this regime
+ * the cost of each distance calculation is dominated by call overhead, not arithmetic.
+ * The data and seed are fixed, so that the number of distance calculations is the same
+ * from run to run, and only the time changes. */
+template <typename TFloat>
+double time_lp(std::string metric, size_t ndata, size_t dimension, size_t K, size_t max_rounds)
+{
+
+  std::vector<TFloat>                    data(ndata * dimension);
+  std::mt19937_64                        gen(1011);
+  std::uniform_real_distribution<TFloat> dis(0, 1);
+  for (auto& x : data)
+  {
+    x = dis(gen);
+  }
+
+  std::vector<size_t> indices_final(K);
+  std::vector<size_t> labels(ndata);
+  std::string         text;
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+  nszen::vzentas<TFloat>(ndata,
+                         dimension,
+                         data.data(),
+                         K,
+                         nullptr,
+                         "uniform",
+                         "clarans",
+                         3,
+                         1000000,
+                         true,
+                         text,
+                         1011,
+                         1000.,
+                         0.,
+                         1000.,
+                         indices_final.data(),
+                         labels.data(),
+                         metric,
+                         1,
+                         max_rounds,
+                         false,
+                         "identity",
+                         false,
+                         false,
+                         0.,
+                         0.,
+                         false,
+                         false,
+                         "none",
+                         0,
+                         0.,
+                         false,
+                         "full",
+                         0);
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1000000.;
+}
+
+int main()
+{
+  size_t ndata      = 200000;
+  size_t dimension  = 2;
+  size_t K          = 100;
+  size_t max_rounds = 250;
+
+  std::cout << "ndata = " << ndata << "  dimension = " << dimension << "  K = " << K
+            << "  max_rounds = " << max_rounds << std::endl;
+  for (std::string metric : {"l1", "l2", "li"})
+  {
+    std::cout << metric << "  float : " << time_lp<float>(metric, ndata, dimension, K, max_rounds)
+              << " [s]  double : " << time_lp<double>(metric, ndata, dimension, K, max_rounds)
+              << " [s]" << std::endl;
+  }
+  return 0;
+}
@@ -49,16 +49,17 @@ int cluster_sparse()
   double              max_itok = 100.0;
   std::vector<size_t> indices_final(K);
   std::vector<size_t> labels(ndata);
-  std::string         metric          = "l2";
-  std::string         energy          = "identity";
-  size_t              nthreads        = 1;
-  size_t              max_rounds      = 100;
-  bool                patient         = true;
-  bool                rooted          = true;
-  double              critical_radius = 0;
-  double              exponent_coeff  = 0;
-  bool                with_tests      = false;
-  bool                do_refinement   = false;
+  std::string         metric           = "l2";
+  std::string         energy           = "identity";
+  size_t              nthreads         = 1;
+  size_t              max_rounds       = 100;
+  bool                patient          = true;
+  bool                rooted           = true;
+  size_t              reorder_interval = 0;
+  double              critical_radius  = 0;
+  double              exponent_coeff   = 0;
+  bool                with_tests       = false;
+  bool                do_refinement    = false;
   std::string         rf_alg("none");
   size_t              rf_max_rounds     = 0;
   double              rf_max_time       = 0;
@@ -95,7 +96,8 @@ int cluster_sparse()
                               rf_alg,
                               rf_max_rounds,
                               rf_max_time,
-                              do_balance_labels);
+                              do_balance_labels,
+                              reorder_interval);
 
   std::cout << std::endl;
   for (size_t i = 0; i < ndata; ++i)
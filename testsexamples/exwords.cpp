@@ -42,6 +42,19 @@ int cluster_words()
   std::string initialisation_method("kmeans++-10");
   bool        with_tests        = false;
   bool        do_balance_labels = false;
+
+  // the number of distances to cache (0 for none). Useful with long sequences, as clarans
+  // computes many of the same distances again.
+  size_t distance_cache_size = 0;
+
+  // "packed" to store nucleotide sequences with 2 bits per value (4 with the IUPAC codes)
+  std::string storage("full");
+
+  // true for the symbol and bigram profiles of the sequences, which give cheap lower bounds on
+  // levenshtein distances. They cost memory, and are only built for long enough sequences, and
+  // not with storage "packed".
+  bool with_profiles = false;
+
   nszen::textfilezentas(filenames,
                         outfilename,
                         costfilename,
@@ -65,7 +78,10 @@ int cluster_words()
                         critical_radius,
                         exponent_coeff,
                         initialisation_method,
-                        do_balance_labels);
+                        do_balance_labels,
+                        distance_cache_size,
+                        storage,
+                        with_profiles);
 
   return 0;
 }
@@ -51,11 +51,11 @@ class BaseClarans : public SkeletonClusterer
 {
 
   private:
-  std::vector<std::vector<XNearestInfo>> nearest_2_infos;
+  NearestInfos nearest_2_infos;
 
   public:
-  std::vector<std::vector<double>> energy_margins;
-  std::vector<ClaransStatistics>   cluster_statistics;
+  ClusterSegmentedVector<InfoFloat> energy_margins;
+  std::vector<ClaransStatistics>    cluster_statistics;
 
   protected:
   size_t k_to;
@@ -67,6 +67,11 @@ class BaseClarans : public SkeletonClusterer
   const size_t max_proposals;
   bool         patient;
 
+  /* the batch thresholds and distances of update_k_to_sample_info_l2, one entry per sample of
+   * k_to. Threads write disjoint ranges, and the capacity is kept between proposals. */
+  std::vector<double> k_to_thresholds;
+  std::vector<double> k_to_distances;
+
   public:
   // TODO : move to cpp file. also, cc in level 2,3 should be freed.
   void base_clarans_custom_initialise_refinement();
@@ -75,6 +80,10 @@ class BaseClarans : public SkeletonClusterer
 
   virtual void custom_rf_clear_initmem() override final;
 
+  virtual void custom_reserve(const std::vector<size_t>& capacities) override final;
+
+  virtual size_t get_custom_n_bytes_reallocated() override final;
+
   BaseClarans(const SkeletonClustererInitBundle& sb, const ExtrasBundle& eb)
     : SkeletonClusterer(sb),
       nearest_2_infos(sb.K),
@@ -88,11 +97,11 @@ class BaseClarans : public SkeletonClusterer
 
   size_t get_max_proposals() { return max_proposals; }
 
-  size_t get_a2(size_t k, size_t j) { return nearest_2_infos[k][j].a_x; }
+  size_t get_a2(size_t k, size_t j) { return nearest_2_infos.get_a(k, j); }
 
-  double get_d2(size_t k, size_t j) { return nearest_2_infos[k][j].d_x; }
+  double get_d2(size_t k, size_t j) { return nearest_2_infos.get_d(k, j); }
 
-  double get_e2(size_t k, size_t j) { return nearest_2_infos[k][j].e_x; }
+  double get_e2(size_t k, size_t j) { return nearest_2_infos.get_e(k, j); }
 
   bool update_centers_greedy();
   bool update_centers_patient();
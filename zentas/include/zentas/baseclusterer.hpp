@@ -4,6 +4,7 @@
 #ifndef ZENTAS_BASECLUSTERER_HPP
 #define ZENTAS_BASECLUSTERER_HPP
 
+#include <zentas/distancecache.hpp>
 #include <zentas/extrasbundle.hpp>
 #include <zentas/lpmetric.hpp>
 #include <zentas/skeletonclusterer.hpp>
@@ -66,14 +67,40 @@ class BaseClusterer : public TOpt
   public:
   typedef typename TMetric::Initializer TMetricInitializer;
   typedef typename TData::DataIn        DataIn;
+  typedef std::is_base_of<BaseDataRooted<DataIn>, TData> is_rooted;
 
   protected:
-  TData                  centers_data;
-  std::vector<TData>     cluster_datas;
-  const DataIn* const    ptr_datain;
-  TMetric                metric;
-  std::unique_ptr<TData> ptr_kmoo_c_dt;
-  std::vector<TData>     p2buns_dt;
+  TData centers_data;
+  /* the values of the samples of all clusters, of which cluster_datas[k] holds segment k */
+  typename TData::ClusterStore cluster_store;
+  std::vector<TData>           cluster_datas;
+  const DataIn*                ptr_datain;
+  TMetric                      metric;
+  std::unique_ptr<TData>       ptr_kmoo_c_dt;
+  std::vector<TData>           p2buns_dt;
+  DistanceCache                distance_cache;
+  /* the private copy of the input made by reorder_datain, and the arrays it is constructed on */
+  std::unique_ptr<DataIn>                  up_reordered_datain;
+  std::vector<typename DataIn::AtomicType> reordered_values;
+  std::vector<size_t>                      reordered_sizes;
+  std::vector<size_t>                      reordered_indices;
+
+  /* the metric, through distance_cache if it is active. i1 and i2 are the IDs of s1 and s2 */
+  template <typename TSample>
+  void set_cached_distance(
+    size_t i1, const TSample& s1, size_t i2, const TSample& s2, double threshold, double& distance)
+  {
+    if (distance_cache.is_active() == false)
+    {
+      metric.set_distance(s1, s2, threshold, distance);
+    }
+
+    else if (distance_cache.get(i1, i2, threshold, distance) == false)
+    {
+      metric.set_distance(s1, s2, threshold, distance);
+      distance_cache.put(i1, i2, threshold, distance);
+    }
+  }
 
   /////////////////////////////////////
   /////////// public //////////////////
@@ -84,6 +111,9 @@ class BaseClusterer : public TOpt
   using TOpt::K;
   using TOpt::aq2p_p2buns;
   using TOpt::kmoo_p2bun;
+  using TOpt::center_IDs;
+  using TOpt::sample_IDs;
+  using TOpt::get_position;
 
   BaseClusterer(const SkeletonClustererInitBundle& sc,
                 const DataIn&                      datain,
@@ -92,10 +122,17 @@ class BaseClusterer : public TOpt
     : TOpt(sc, eb),
 
       centers_data(datain, true),
+      cluster_store(TData::get_cluster_store(sc.K, datain)),
       ptr_datain(&datain),
       metric(datain, sc.nthreads, metric_initializer),
-      ptr_kmoo_c_dt(new TData(datain, true))
+      ptr_kmoo_c_dt(new TData(datain, true)),
+      distance_cache(eb.distance_cache_size, datain.get_ndata())
   {
+    if (eb.reorder_interval > 0 && is_rooted::value == false)
+    {
+      throw zentas::zentas_error("reorder_interval > 0 is only an option for rooted data");
+    }
+    SkeletonClusterer::reorder_interval = eb.reorder_interval;
   }
 
   BaseClusterer(const ClustererInitBundle<DataIn, TMetric>& ib)
@@ -108,6 +145,16 @@ class BaseClusterer : public TOpt
 
   virtual size_t get_ncalcs() override final { return metric.get_ncalcs(); }
 
+  virtual bool satisfies_triangle_inequality() override final
+  {
+    return TMetric::satisfies_triangle_inequality;
+  }
+
+  virtual std::string get_distance_cache_string() override final
+  {
+    return distance_cache.get_summary_string();
+  }
+
   virtual void set_cc_pp_distance(size_t k1, size_t k2) override final
   {
     metric.set_distance(ptr_kmoo_c_dt->at_for_metric(k1),
@@ -130,8 +177,12 @@ class BaseClusterer : public TOpt
                                             double  threshold,
                                             double& distance) override final
   {
-    metric.set_distance(
-      centers_data.at_for_metric(k), ptr_datain->at_for_metric(i), threshold, distance);
+    set_cached_distance(center_IDs[k],
+                        centers_data.at_for_metric(k),
+                        i,
+                        ptr_datain->at_for_metric(get_position(i)),
+                        threshold,
+                        distance);
   }
 
   virtual void set_sampleID_sampleID_distance(size_t  i1,
@@ -139,14 +190,20 @@ class BaseClusterer : public TOpt
                                               double  threshold,
                                               double& distance) override final
   {
-    metric.set_distance(
-      ptr_datain->at_for_metric(i1), ptr_datain->at_for_metric(i2), threshold, distance);
+    set_cached_distance(i1,
+                        ptr_datain->at_for_metric(get_position(i1)),
+                        i2,
+                        ptr_datain->at_for_metric(get_position(i2)),
+                        threshold,
+                        distance);
   }
 
   virtual void set_sample_sample_distance(
     size_t k1, size_t j1, size_t k2, size_t j2, double threshold, double& adistance) override final
   {
-    metric.set_distance(cluster_datas[k1].at_for_metric(j1),
+    set_cached_distance(sample_IDs(k1, j1),
+                        cluster_datas[k1].at_for_metric(j1),
+                        sample_IDs(k2, j2),
                         cluster_datas[k2].at_for_metric(j2),
                         threshold,
                         adistance);
@@ -154,12 +211,13 @@ class BaseClusterer : public TOpt
 
   virtual void append_to_centers_from_ID(size_t i) override final
   {
-    centers_data.append(ptr_datain->at_for_move(i));
+    centers_data.append(ptr_datain->at_for_move(get_position(i)));
   }
 
   virtual void add_empty_cluster() override final
   {
     cluster_datas.emplace_back(*ptr_datain, true);
+    cluster_datas.back().set_cluster_store(cluster_store, cluster_datas.size() - 1);
   }
 
   protected:
@@ -171,7 +229,7 @@ class BaseClusterer : public TOpt
 
   virtual void append_from_ID(size_t k, size_t i) override final
   {
-    cluster_datas[k].append(ptr_datain->at_for_move(i));
+    cluster_datas[k].append(ptr_datain->at_for_move(get_position(i)));
   }
 
   virtual void append_across(size_t k_to, size_t k_from, size_t j_from) override final
@@ -181,7 +239,7 @@ class BaseClusterer : public TOpt
 
   virtual void append_pp_from_ID(size_t i) override final
   {
-    ptr_kmoo_c_dt->append(ptr_datain->at_for_move(i));
+    ptr_kmoo_c_dt->append(ptr_datain->at_for_move(get_position(i)));
   }
 
   virtual void append_pp_from_bin(size_t bin, size_t j) override final
@@ -191,7 +249,7 @@ class BaseClusterer : public TOpt
 
   virtual void append_aq2p_p2buns(size_t bin, size_t i) override final
   {
-    p2buns_dt[bin].append(ptr_datain->at_for_move(i));
+    p2buns_dt[bin].append(ptr_datain->at_for_move(get_position(i)));
   }
 
   virtual size_t get_ndata(size_t k) override final { return cluster_datas[k].get_ndata(); }
@@ -236,18 +294,86 @@ class BaseClusterer : public TOpt
   virtual void kmoo_finish_with() override final
   {
     kmoo_cc.resize(0);
-    kmoo_p2bun = P2Bundle(0);
+    kmoo_p2bun = P2Bundle(0, false);
     ptr_kmoo_c_dt.reset();
   }
 
   virtual std::string string_from_ID(size_t i) override final
   {
-    return ptr_datain->string_for_sample(i);
+    return ptr_datain->string_for_sample(get_position(i));
   }
 
   virtual void swap_data(size_t k1, size_t k2) override final
   {
     std::swap(cluster_datas[k1], cluster_datas[k2]);
+    cluster_store.swap_clusters(k1, k2);
+    cluster_datas[k1].set_cluster_store(cluster_store, k1);
+    cluster_datas[k2].set_cluster_store(cluster_store, k2);
+  }
+
+  virtual void reserve_cluster_datas(const std::vector<size_t>& capacities) override final
+  {
+    for (size_t k = 0; k < K; ++k)
+    {
+      cluster_datas[k].reserve(capacities[k]);
+    }
+    cluster_store.reserve(capacities);
+  }
+
+  virtual size_t get_cluster_datas_n_bytes_reallocated() override final
+  {
+    size_t n_bytes = cluster_store.get_n_bytes_reallocated();
+    for (auto& x : cluster_datas)
+    {
+      n_bytes += x.get_n_bytes_reallocated();
+    }
+    return n_bytes;
+  }
+
+  virtual void reorder_datain(const std::vector<size_t>& order,
+                              const std::vector<size_t>& old_to_new) override final
+  {
+    reorder_datain(order, old_to_new, is_rooted());
+  }
+
+  private:
+  void reorder_datain(const std::vector<size_t>& order,
+                      const std::vector<size_t>& old_to_new,
+                      std::true_type)
+  {
+    /* the new arrays are swapped in after the new input is constructed on them, as the current
+     * input may be the previous copy */
+    std::vector<typename DataIn::AtomicType> values;
+    std::vector<size_t>                      sizes;
+    std::vector<size_t>                      indices;
+    auto ib =
+      ptr_datain->get_reordered_ib(order, SkeletonClusterer::nthreads, values, sizes, indices);
+    std::unique_ptr<DataIn> up_datain(new DataIn(ib));
+    ptr_datain = up_datain.get();
+
+    centers_data.set_reordered(*ptr_datain, old_to_new);
+    for (auto& x : cluster_datas)
+    {
+      x.set_reordered(*ptr_datain, old_to_new);
+    }
+    for (auto& x : p2buns_dt)
+    {
+      x.set_reordered(*ptr_datain, old_to_new);
+    }
+    if (ptr_kmoo_c_dt)
+    {
+      ptr_kmoo_c_dt->set_reordered(*ptr_datain, old_to_new);
+    }
+
+    up_reordered_datain = std::move(up_datain);
+    reordered_values.swap(values);
+    reordered_sizes.swap(sizes);
+    reordered_indices.swap(indices);
+  }
+
+  void reorder_datain(const std::vector<size_t>&, const std::vector<size_t>&, std::false_type)
+  {
+    throw zentas::zentas_error("only rooted data can be reordered");
   }
 };
 
@@ -259,6 +385,9 @@ class Clusterer : public BaseClusterer<TMetric, TData, TOpt>
   using BaseClusterer<TMetric, TData, TOpt>::metric;
   using BaseClusterer<TMetric, TData, TOpt>::centers_data;
   using BaseClusterer<TMetric, TData, TOpt>::cluster_datas;
+  using BaseClusterer<TMetric, TData, TOpt>::center_IDs;
+  using BaseClusterer<TMetric, TData, TOpt>::sample_IDs;
+  using BaseClusterer<TMetric, TData, TOpt>::set_cached_distance;
 
   typedef typename TData::DataIn DataIn;
   Clusterer(const ClustererInitBundle<DataIn, TMetric>& ib)
@@ -271,8 +400,32 @@ class Clusterer : public BaseClusterer<TMetric, TData, TOpt>
   virtual void set_center_sample_distance(
     size_t k, size_t k1, size_t j1, double threshold, double& distance) override final
   {
-    metric.set_distance(
-      centers_data.at_for_metric(k), cluster_datas[k1].at_for_metric(j1), threshold, distance);
+    set_cached_distance(center_IDs[k],
+                        centers_data.at_for_metric(k),
+                        sample_IDs(k1, j1),
+                        cluster_datas[k1].at_for_metric(j1),
+                        threshold,
+                        distance);
+  }
+
+  /* one pair at a time, the metric has no batch set_distances */
+  virtual void set_center_sample_distances(size_t              k,
+                                           size_t              k1,
+                                           size_t              j_begin,
+                                           size_t              j_end,
+                                           const double* const thresholds,
+                                           double* const       distances) override final
+  {
+    for (size_t j = j_begin; j < j_end; ++j)
+    {
+      set_cached_distance(
+        center_IDs[k],
+        centers_data.at_for_metric(k),
+        sample_IDs(k1, j),
+        cluster_datas[k1].at_for_metric(j),
+        thresholds ? thresholds[j - j_begin] : std::numeric_limits<double>::max(),
+        distances[j - j_begin]);
+    }
   }
 
   virtual void set_center_center_distance(size_t  k1,
@@ -280,8 +433,12 @@ class Clusterer : public BaseClusterer<TMetric, TData, TOpt>
                                           double  threshold,
                                           double& adistance) override final
   {
-    metric.set_distance(
-      centers_data.at_for_metric(k1), centers_data.at_for_metric(k2), threshold, adistance);
+    set_cached_distance(center_IDs[k1],
+                        centers_data.at_for_metric(k1),
+                        center_IDs[k2],
+                        centers_data.at_for_metric(k2),
+                        threshold,
+                        adistance);
   }
 
   virtual std::string string_for_center(size_t k) override final
@@ -291,9 +448,9 @@ class Clusterer : public BaseClusterer<TMetric, TData, TOpt>
 };
 
 /* The LpMetric, which can do refinement and so has additional methods */
-template <class TData, class TOpt>
-class Clusterer<LpMetric<typename TData::DataIn>, TData, TOpt>
-  : public BaseClusterer<LpMetric<typename TData::DataIn>, TData, TOpt>
+template <class TData, class TOpt, char P>
+class Clusterer<LpMetric<typename TData::DataIn, P>, TData, TOpt>
+  : public BaseClusterer<LpMetric<typename TData::DataIn, P>, TData, TOpt>
 {
 
   public:
@@ -310,17 +467,17 @@ class Clusterer<LpMetric<typename TData::DataIn>, TData, TOpt>
   using AtomicType = typename DataIn::AtomicType;
   using Sample     = typename DataIn::Sample;
 
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::cluster_datas;
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::get_ndata;
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::metric;
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::centers_data;
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::energy;
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::bigbang;
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::K;
-  using BaseClusterer<LpMetric<DataIn>, TData, TOpt>::mowri;
-
-  Clusterer(const ClustererInitBundle<DataIn, LpMetric<typename TData::DataIn>>& ib)
-    : BaseClusterer<LpMetric<typename TData::DataIn>, TData, TOpt>(ib),
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::cluster_datas;
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::get_ndata;
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::metric;
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::centers_data;
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::energy;
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::bigbang;
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::K;
+  using BaseClusterer<LpMetric<DataIn, P>, TData, TOpt>::mowri;
+
+  Clusterer(const ClustererInitBundle<DataIn, LpMetric<typename TData::DataIn, P>>& ib)
+    : BaseClusterer<LpMetric<typename TData::DataIn, P>, TData, TOpt>(ib),
       rf_center_data(ib.datain.dimension),
       rf_sum_data(ib.datain.dimension),
       old_rf_center_data(ib.datain.dimension)
@@ -358,38 +515,37 @@ class Clusterer<LpMetric<typename TData::DataIn>, TData, TOpt>
   {
     EnergyInitialiser   sub_ei;
     auto                datain_ib = centers_data.get_as_datain_ib();
-    LpMetricInitializer sub_mi(
-      metric.get_p(), false, "none", 0, 0);  // same lp as parent, but no refinement.
+    LpMetricInitializer sub_mi(P, false, "none", 0, 0);  // same lp as parent, but no refinement.
 
     if (K != datain_ib.ndata)
     {
       throw zentas::zentas_error("weird, K is not centers_tdatain.get_ndata()...");
     }
 
-    zentas_base<TData, LpMetric<typename TData::DataIn>>(datain_ib,
-                                                         sub_K,
-                                                         sub_indices_init,
-                                                         sub_initialisation_method,
-                                                         sub_algorithm,
-                                                         sub_level,
-                                                         sub_max_proposals,
-                                                         sub_capture_output,
-                                                         sub_output_text,
-                                                         sub_seed,
-                                                         sub_max_time,
-                                                         sub_min_mE,
-                                                         sub_max_itok,
-                                                         sub_indices_final,
-                                                         sub_labels,
-                                                         sub_nthreads,
-                                                         sub_max_rounds,
-                                                         sub_patient,
-                                                         sub_energy,
-                                                         sub_with_tests,
-                                                         sub_mi,
-                                                         sub_ei,
-                                                         sub_bigbang,
-                                                         do_balance_labels);
+    zentas_base<TData, LpMetric<typename TData::DataIn, P>>(datain_ib,
+                                                            sub_K,
+                                                            sub_indices_init,
+                                                            sub_initialisation_method,
+                                                            sub_algorithm,
+                                                            sub_level,
+                                                            sub_max_proposals,
+                                                            sub_capture_output,
+                                                            sub_output_text,
+                                                            sub_seed,
+                                                            sub_max_time,
+                                                            sub_min_mE,
+                                                            sub_max_itok,
+                                                            sub_indices_final,
+                                                            sub_labels,
+                                                            sub_nthreads,
+                                                            sub_max_rounds,
+                                                            sub_patient,
+                                                            sub_energy,
+                                                            sub_with_tests,
+                                                            sub_mi,
+                                                            sub_ei,
+                                                            sub_bigbang,
+                                                            do_balance_labels);
   }
 
   virtual void append_zero_to_rf_center_data() override final { rf_center_data.append_zero(); }
@@ -429,6 +585,28 @@ class Clusterer<LpMetric<typename TData::DataIn>, TData, TOpt>
       centers_data.at_for_metric(k), cluster_datas[k1].at_for_metric(j1), threshold, distance);
   }
 
+  virtual void set_center_sample_distances(size_t              k,
+                                           size_t              k1,
+                                           size_t              j_begin,
+                                           size_t              j_end,
+                                           const double* const thresholds,
+                                           double* const       distances) override final
+  {
+    metric.set_distances(
+      centers_data.at_for_metric(k), cluster_datas[k1], j_begin, j_end, thresholds, distances);
+  }
+
+  virtual void set_rf_center_sample_distances(size_t              k,
+                                              size_t              k1,
+                                              size_t              j_begin,
+                                              size_t              j_end,
+                                              const double* const thresholds,
+                                              double* const       distances) override final
+  {
+    metric.set_distances(
+      rf_center_data.at_for_metric(k), cluster_datas[k1], j_begin, j_end, thresholds, distances);
+  }
+
   virtual void set_rf_center_sample_distance(
     size_t k, size_t k1, size_t j1, double threshold, double& distance) override final
   {
@@ -471,7 +649,7 @@ class Clusterer<LpMetric<typename TData::DataIn>, TData, TOpt>
       // do nothing.
     }
 
-    else if (metric.get_p() != '2')
+    else if (P != '2')
     {
       std::function<Sample(size_t)> f_sample(
         [this, k](size_t j) { return cluster_datas[k].at_for_metric(j); });
@@ -21,7 +21,8 @@ void scrutinize_input_1(const EnergyInitialiser& energy_initialiser,
                         size_t                   K,
                         std::string              algorithm,
                         size_t                   level,
-                        size_t                   ndata);
+                        size_t                   ndata,
+                        bool                     satisfies_triangle_inequality);
 
 template <typename TData, typename TMetric, typename TInitBundle>
 void dispatch(std::string                                                 algorithm,
@@ -45,7 +46,9 @@ void dispatch(std::string                                                 algori
               const typename TMetric::Initializer&                        metric_initializer,
               const EnergyInitialiser&                                    energy_initialiser,
               std::chrono::time_point<std::chrono::high_resolution_clock> bigbang,
-              bool                                                        do_balance_labels)
+              bool                                                        do_balance_labels,
+              size_t                                                      distance_cache_size,
+              size_t                                                      reorder_interval)
 {
 
   typedef typename TData::DataIn DataIn;
@@ -69,7 +72,7 @@ void dispatch(std::string                                                 algori
                                         labels,
                                         &energy_initialiser,
                                         do_balance_labels);
-  ExtrasBundle eb(max_proposals, patient);
+  ExtrasBundle eb(max_proposals, patient, distance_cache_size, reorder_interval);
   ClustererInitBundle<DataIn, TMetric> ib(sc, datain, metric_initializer, eb);
 
   //  BaseClaransInitBundle clib();
@@ -149,7 +152,9 @@ void zentas_base(const TInitBundle&                   datain_ib,
                  const typename TMetric::Initializer& metric_initializer,
                  const EnergyInitialiser&             energy_initialiser,
                  const std::chrono::time_point<std::chrono::high_resolution_clock>& bigbang,
-                 bool do_balance_labels)
+                 bool   do_balance_labels,
+                 size_t distance_cache_size = 0,
+                 size_t reorder_interval    = 0)
 {
 
 /* used during experiments to see if openblas worth the effort. Decided not.
@@ -166,7 +171,13 @@ void zentas_base(const TInitBundle&                   datain_ib,
   std::ofstream nowhere;
 #endif
 
-  scrutinize_input_1(energy_initialiser, energy, K, algorithm, level, datain_ib.ndata);
+  scrutinize_input_1(energy_initialiser,
+                     energy,
+                     K,
+                     algorithm,
+                     level,
+                     datain_ib.ndata,
+                     TMetric::satisfies_triangle_inequality);
 
   if (initialisation_method == "from_init_indices" && indices_init == nullptr)
   {
@@ -195,7 +206,9 @@ void zentas_base(const TInitBundle&                   datain_ib,
                            metric_initializer,
                            energy_initialiser,
                            bigbang,
-                           do_balance_labels);
+                           do_balance_labels,
+                           distance_cache_size,
+                           reorder_interval);
 
 #ifndef COMPILE_FOR_R
   if (capture_output == true)
@@ -0,0 +1,82 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#ifndef ZENTAS_DISTANCECACHE_HPP
+#define ZENTAS_DISTANCECACHE_HPP
+
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nszen
+{
+
+/* A bounded cache of distances between samples, keyed by the (unordered) pair of sample IDs.
+ * For expensive metrics (Levenshtein), where clarans computes the same distances round after
+ * round : distances to centers which have not changed, and to proposals which were rejected.
+ *
+ * A distance computed with threshold t is exact if it is below t. Otherwise it only says that
+ * the true distance is at least t, so it answers any threshold t' up to t : it is at least t',
+ * which is all the metrics promise when not exact, but it need not be the value the metric
+ * would return for t' (Levenshtein returns t' itself). Entries store the threshold below which
+ * they are valid, which is max double for exact distances.
+ *
+ * The entries are split over shards, each with its own mutex, selected by a hash of the key.
+ * Within a shard, a key can go in one of 4 entries (a bucket). When the bucket is full, an
+ * entry is overwritten. */
+class DistanceCache
+{
+
+  private:
+  static constexpr size_t n_shards     = 64;
+  static constexpr size_t bucket_size  = 4;
+  static constexpr double always_valid = std::numeric_limits<double>::max();
+
+  struct Entry
+  {
+    /* 0 for an empty entry */
+    uint64_t key = 0;
+    double   distance;
+    double   valid_below;
+  };
+
+  struct Shard
+  {
+    std::mutex         mutex;
+    std::vector<Entry> entries;
+    size_t             n_queries = 0;
+    size_t             n_hits    = 0;
+  };
+
+  size_t             ndata;
+  size_t             n_buckets_per_shard;
+  std::vector<Shard> shards;
+
+  uint64_t get_key(size_t i1, size_t i2) const;
+  Entry*   get_bucket(Shard& shard, uint64_t key) const;
+  Shard&   get_shard(uint64_t key);
+
+  public:
+  /* capacity is the number of entries (of 24 bytes), 0 to not cache */
+  DistanceCache(size_t capacity, size_t ndata);
+
+  bool is_active() const { return n_buckets_per_shard > 0; }
+
+  /* if there is an entry for i1, i2 which is valid for threshold, set distance and return true.
+   * distance is then exact if below threshold, and otherwise at least threshold. */
+  bool get(size_t i1, size_t i2, double threshold, double& distance);
+
+  /* distance is the result of the metric with threshold */
+  void put(size_t i1, size_t i2, double threshold, double distance);
+
+  size_t get_n_queries();
+  size_t get_n_hits();
+
+  /* for the round summary, empty if not active */
+  std::string get_summary_string();
+};
+}
+
+#endif
@@ -0,0 +1,55 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#ifndef ZENTAS_DTW_HPP
+#define ZENTAS_DTW_HPP
+
+#include <memory>
+#include <zentas/tdatain.hpp>
+
+namespace nszen
+{
+
+class DTWInitializer
+{
+
+  public:
+  /* the Sakoe-Chiba band : x[i] and y[j] can be matched if |i - j| <= window. If the lengths
+   * differ by more than window, the band is widened to the difference of the lengths. */
+  size_t window;
+
+  DTWInitializer(size_t window);
+  DTWInitializer();
+};
+
+/* using pimpl for DTW, as for Levenshtein. This is the working class, */
+template <typename TSDataIn>
+class DTWMetric_X;
+
+/* Dynamic time warping of real-valued time series. The distance is the square root of the
+ * smallest sum of squared differences along a warping path in the band (with window 0 and
+ * equal lengths, it is the l2 distance). DTW does not satisfy the triangle inequality, so
+ * only the algorithms and levels which do not eliminate with it are available. */
+template <typename TSDataIn>
+class DTWMetric
+{
+
+  private:
+  std::unique_ptr<DTWMetric_X<TSDataIn>> dtwm;
+
+  public:
+  typedef typename TSDataIn::Sample Sample;
+  typedef DTWInitializer            Initializer;
+
+  static constexpr bool satisfies_triangle_inequality = false;
+
+  DTWMetric(const TSDataIn& datain, size_t nthreads, const DTWInitializer& di);
+  void set_distance(const Sample& a, const Sample& b, double threshold, double& distance);
+  size_t get_ncalcs();
+  double get_rel_calccosts();
+  ~DTWMetric();
+};
+
+}  // namespace nszen
+
+#endif
@@ -4,6 +4,9 @@
 #ifndef ZENTAS_ENERGYINIT_HPP
 #define ZENTAS_ENERGYINIT_HPP
 
+#include <functional>
+#include <string>
+
 namespace nszen
 {
 
@@ -22,6 +25,11 @@ struct EnergyInitialiser
 
   double get_exponent_coeff() const;
 };
+
+/* the energy function named energy (identity, quadratic, cubic, squarepotential, log, exp, sqrt)
+ */
+std::function<double(double)> get_f_energy(const std::string&       energy,
+                                           const EnergyInitialiser& energy_initialiser);
 }
 
 #endif
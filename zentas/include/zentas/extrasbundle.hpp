@@ -11,7 +11,19 @@ class ExtrasBundle
 
   public:
   ClaransExtrasBundle clarans;
-  ExtrasBundle(size_t max_proposals, size_t patient) : clarans(max_proposals, patient) {}
+  /* number of entries of the DistanceCache, 0 for none */
+  size_t distance_cache_size;
+  /* rounds between reorderings of rooted data, 0 for none (see reorder_rooted_data) */
+  size_t reorder_interval;
+  ExtrasBundle(size_t max_proposals,
+               size_t patient,
+               size_t distance_cache_size_,
+               size_t reorder_interval_)
+    : clarans(max_proposals, patient),
+      distance_cache_size(distance_cache_size_),
+      reorder_interval(reorder_interval_)
+  {
+  }
 };
 
 #endif
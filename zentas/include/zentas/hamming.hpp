@@ -0,0 +1,129 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#ifndef ZENTAS_HAMMING_HPP
+#define ZENTAS_HAMMING_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <zentas/lpmetric.hpp>
+#include <zentas/tdatain.hpp>
+
+namespace nszen
+{
+
+/* Hamming distances between samples packed into 64-bit words. A sample is a sequence of fields
+ * of field_width bits (one of 1, 2, 4, 8, 16, 32), a field never straddles two words, and the
+ * distance is the number of fields in which two samples differ. For binary vectors field_width
+ * is 1, for nucleotides (4 symbols) it is 2. The fields beyond the end of a sample in its last
+ * word must be 0. */
+namespace hamming
+{
+
+/* The threshold test is made once per block of block_size words. If the threshold is
+ * exceeded, the returned value is the partial count (which is greater than threshold).
+ * n_visited is set to the number of words processed. */
+constexpr size_t block_size = 16;
+
+using HammingKernel = size_t (*)(const uint64_t* a,
+                                 const uint64_t* b,
+                                 size_t          n_words,
+                                 size_t          threshold,
+                                 size_t&         n_visited);
+
+/* The kernel is selected at runtime according to the instruction sets the CPU supports
+ * (avx512f + avx512vpopcntdq, popcnt, or a portable fallback). */
+HammingKernel get_hamming_kernel(size_t field_width);
+
+/* the name of the instruction set used by get_hamming_kernel on this machine. */
+std::string get_hamming_isa();
+
+/* For sequences of equal length. The distinct values are coded as 0, 1, ..., in increasing
+ * order, with the smallest field_width which fits them all. Sample i is in words
+ * [i * n_words, (i + 1) * n_words) of packed. */
+template <typename TAtomic>
+void set_packed_sequences(size_t                 ndata,
+                          const size_t* const    sizes,
+                          const TAtomic* const   data,
+                          std::vector<uint64_t>& packed,
+                          size_t&                field_width,
+                          size_t&                n_words);
+}
+
+class HammingInitializer
+{
+
+  public:
+  size_t field_width;
+  /* the number of fields in a sample */
+  size_t n_fields;
+
+  HammingInitializer(size_t field_width, size_t n_fields);
+  HammingInitializer();
+};
+
+/* TDataIn is DenseVectorData(Un)RootedIn<uint64_t>, of which the dimension is the number of
+ * words per sample */
+template <typename TDataIn>
+class HammingMetric
+{
+
+  private:
+  size_t                      n_words;
+  size_t                      n_fields;
+  hamming::HammingKernel      kernel;
+  std::vector<DistanceCounts> v_counts;
+  size_t                      counts_mask;
+
+  public:
+  typedef typename TDataIn::Sample Sample;
+  typedef HammingInitializer       Initializer;
+
+  static constexpr bool satisfies_triangle_inequality = true;
+
+  HammingMetric(const TDataIn& datain, size_t nthreads, const HammingInitializer& hi)
+    : n_words(datain.dimension),
+      n_fields(hi.n_fields),
+      kernel(hamming::get_hamming_kernel(hi.field_width)),
+      v_counts(get_n_distance_counts(nthreads)),
+      counts_mask(get_n_distance_counts(nthreads) - 1)
+  {
+  }
+
+  void set_distance(const uint64_t* a, const uint64_t* b, double threshold, double& distance)
+  {
+    /* the count is an integer, so exceeding threshold is exceeding its floor */
+    size_t int_threshold =
+      threshold < static_cast<double>(n_fields) ? static_cast<size_t>(threshold) : n_fields;
+    size_t n_visited;
+    distance = static_cast<double>(kernel(a, b, n_words, int_threshold, n_visited));
+    v_counts[get_thread_index() & counts_mask].add(1, n_visited);
+  }
+
+  size_t get_ncalcs() const
+  {
+    size_t ncalcs = 0;
+    for (auto& x : v_counts)
+    {
+      ncalcs += x.ncalcs.load(std::memory_order_relaxed);
+    }
+    return ncalcs;
+  }
+
+  /* the mean number of words visited, relative to the number of words per sample */
+  double get_rel_calccosts() const
+  {
+    size_t calccosts = 0;
+    for (auto& x : v_counts)
+    {
+      calccosts += x.calccosts.load(std::memory_order_relaxed);
+    }
+    return static_cast<double>(calccosts) /
+           static_cast<double>(std::max<size_t>(1, get_ncalcs() * n_words));
+  }
+};
+
+}  // namespace nszen
+
+#endif
@@ -33,6 +33,9 @@ class LevenshteinInitializer
                          const double* const c_switch_arr,
                          bool                normalised);
   LevenshteinInitializer();
+
+  /* whether the StringProfiles of sequences of mean_size can speed up the metric */
+  bool profiles_can_pay_off(double mean_size) const;
 };
 
 /* using pimpl for Levenshtein. This is the working class, */
@@ -50,6 +53,10 @@ class LevenshteinMetric
   public:
   typedef typename TSDataIn::Sample Sample;
   typedef LevenshteinInitializer    Initializer;
+
+  /* the costs are checked in LevenshteinInitializer */
+  static constexpr bool satisfies_triangle_inequality = true;
+
   LevenshteinMetric(const TSDataIn& datain, size_t nthreads, const LevenshteinInitializer& li);
   void set_distance(const Sample& v_vertical,
                     const Sample& v_horizontal,
@@ -0,0 +1,98 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#ifndef ZENTAS_LPKERNELS_HPP
+#define ZENTAS_LPKERNELS_HPP
+
+#include <cstddef>
+#include <string>
+#include <zentas/quantise.hpp>
+
+namespace nszen
+{
+namespace lpkernels
+{
+
+/* Dense Lp distance kernels. A kernel returns the accumulated (uncorrected) distance between
+ * a and b, so for p = '2' this is the squared l2 distance. The threshold is also uncorrected.
+ * The early-exit threshold test is made once per block of dense_block_size dimensions,
+ * so that the accumulation within a block can be vectorised. If the threshold is exceeded,
+ * the returned value is the partial accumulation (which is greater than threshold).
+ * n_visited is set to the number of dimensions processed. */
+constexpr size_t dense_block_size = 16;
+
+template <typename TNumber>
+using DenseLpKernel = double (*)(const TNumber* a,
+                                 const TNumber* b,
+                                 size_t         dimension,
+                                 double         threshold,
+                                 size_t&        n_visited);
+
+/* p is one of '0', '1', '2', 'i'. The kernel is selected at runtime according to the
+ * instruction sets the CPU supports (avx512f, avx2 + fma, sse2, or a portable fallback). */
+template <typename TNumber>
+DenseLpKernel<TNumber> get_dense_lp_kernel(char p);
+
+/* Batch kernels : the distances from a to each of bs[0], ..., bs[n_bs - 1], with a
+ * threshold for each. The samples are processed batch_width at a time, so that the loads of a
+ * are shared and there are batch_width independent accumulations in flight. Each distance is
+ * identical to that of the DenseLpKernel for the same p. n_visited is set to the total number
+ * of dimensions processed. */
+constexpr size_t batch_width = 4;
+
+template <typename TNumber>
+using DenseLpBatchKernel = void (*)(const TNumber*              a,
+                                    const TNumber* const* const bs,
+                                    size_t                      n_bs,
+                                    size_t                      dimension,
+                                    const double* const         thresholds,
+                                    double* const               distances,
+                                    size_t&                     n_visited);
+
+template <typename TNumber>
+DenseLpBatchKernel<TNumber> get_dense_lp_batch_kernel(char p);
+
+/* the name of the instruction set used by get_dense_lp_kernel on this machine. */
+std::string get_dense_lp_isa();
+
+/* Dense dot product kernels, accumulated in double, for l2 with cached squared norms. The
+ * isa is selected as for get_dense_lp_kernel, and does not change during a run, so the dot
+ * product of a vector with itself is always exactly its cached squared norm. */
+template <typename TNumber>
+using DenseDotKernel = double (*)(const TNumber* a, const TNumber* b, size_t dimension);
+
+template <typename TNumber>
+DenseDotKernel<TNumber> get_dense_dot_kernel();
+
+/* Sparse dot products, for l2 with sparse vectors, of which the indices are sorted. Only the
+ * intersection of the indices is walked. The products are accumulated in double in order of
+ * increasing index, so the result does not depend on the isa, and the dot product of a vector
+ * with itself is exactly its cached squared norm. */
+template <typename TNumber>
+using SparseDotKernel = double (*)(const TNumber* a_values,
+                                   const size_t*  a_indices,
+                                   size_t         a_size,
+                                   const TNumber* b_values,
+                                   const size_t*  b_indices,
+                                   size_t         b_size);
+
+template <typename TNumber>
+SparseDotKernel<TNumber> get_sparse_dot_kernel();
+
+/* Kernels for reduced precision storage, with TCode one of Float16, BFloat16 and int8_t (see
+ * quantise.hpp). The codes are widened to float, and the difference in dimension d is
+ * (widen(a[d]) - widen(b[d])) * scales[d], computed in float. Otherwise as DenseLpKernel. */
+template <typename TCode>
+using QuantisedLpKernel = double (*)(const TCode* a,
+                                     const TCode* b,
+                                     const float* scales,
+                                     size_t       dimension,
+                                     double       threshold,
+                                     size_t&      n_visited);
+
+template <typename TCode>
+QuantisedLpKernel<TCode> get_quantised_lp_kernel(char p);
+}
+}
+
+#endif
@@ -19,6 +19,12 @@ class TMetric{
 
 */
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <zentas/lpkernels.hpp>
 #include <zentas/sparsevectorrfcenter.hpp>
 #include <zentas/tdatain.hpp>
 /* the above is included for this guy:
@@ -58,63 +64,91 @@ class LpMetricInitializer
 >> distance = wblas::dot(dimension, worker, 1, worker, 1);
 >> calccosts += dimension; */
 
+/* A small index for each thread, distinct among the threads alive. The index of a thread
+ * which has finished is reused. */
+class ThreadIndex
+{
+  public:
+  size_t index;
+  ThreadIndex();
+  ~ThreadIndex();
+};
+
+inline size_t get_thread_index()
+{
+  static thread_local ThreadIndex thread_index;
+  return thread_index.index;
+}
+
+/* The distance counters of (usually) one thread. A slot is chosen by thread index & mask, so
+ * two threads can share a slot : the relaxed fetch_add does not lose their counts, and is
+ * uncontended when they do not. The 64 bytes of padding between the counters of consecutive
+ * slots keep them on different cache lines, whatever the alignment of the array. */
+struct DistanceCounts
+{
+  std::atomic<size_t> ncalcs;
+  std::atomic<size_t> calccosts;
+  char                padding[64];
+
+  DistanceCounts() : ncalcs(0), calccosts(0) {}
+
+  void add(size_t n_calcs, size_t n_costs)
+  {
+    ncalcs.fetch_add(n_calcs, std::memory_order_relaxed);
+    calccosts.fetch_add(n_costs, std::memory_order_relaxed);
+  }
+};
+
+/* the number of DistanceCounts : a power of 2 at least nthreads + 1 (the main thread) */
+size_t get_n_distance_counts(size_t nthreads);
+
+/* Not polymorphic : LpMetric holds the TLpDistance by value (p is a template parameter of
+ * LpMetric), so that set_distance calls are not virtual and can be inlined. */
 template <typename TNumber>
 class BaseLpDistance
 {
 
   public:
   size_t dimension;
-  size_t ncalcs    = 0;
-  size_t calccosts = 0;
-
-  virtual ~BaseLpDistance() = default;
-
-  BaseLpDistance(size_t d) : dimension(d) {}
-
-  size_t get_ncalcs() { return ncalcs; }
-
-  size_t get_calccosts() { return calccosts; }
-
-  virtual void set_distance(const TNumber* const& a,
-                            const TNumber* const& b,
-                            double                threshold,
-                            double&               a_distance) = 0;
-  virtual void set_distance(const SparseVectorSample<TNumber>& a,
-                            const SparseVectorSample<TNumber>& b,
-                            double                             threshold,
-                            double&                            distance) = 0;
-  virtual void set_distance(const SparseVectorRfCenter<TNumber>& a,
-                            const SparseVectorSample<TNumber>&   b,
-                            double                               threshold,
-                            double&                              distance) = 0;
-  virtual void set_distance(const SparseVectorRfCenter<TNumber>& a,
-                            const SparseVectorRfCenter<TNumber>& b,
-                            double                               threshold,
-                            double&                              distance) = 0;
-
-  virtual void set_center(const std::string&                           energy,
-                          const std::function<const TNumber*(size_t)>& f_sample,
-                          size_t                                       ndata,
-                          TNumber* const                               ptr_center)
+
+  private:
+  /* Previously a single (ncalcs, calccosts), incremented by all threads. That was a race,
+   * and at 16 threads the cache line bouncing between cores was visible in profiles. */
+  std::vector<DistanceCounts> v_counts;
+  size_t                      counts_mask;
+
+  public:
+  BaseLpDistance(size_t d, size_t nthreads)
+    : dimension(d),
+      v_counts(get_n_distance_counts(nthreads)),
+      counts_mask(get_n_distance_counts(nthreads) - 1)
   {
-    (void)energy;
-    (void)f_sample;
-    (void)ndata;
-    (void)ptr_center;
-    throw zentas::zentas_error("cannot set vector center : from BaseLpDistance base class dense");
   }
 
-  virtual void
-  set_center(const std::string&                                               energy,
-             const std::function<const SparseVectorSample<TNumber>&(size_t)>& f_sample,
-             size_t                                                           ndata,
-             SparseVectorRfCenter<TNumber>* const                             ptr_center)
+  /* called by the thread which computed the distances */
+  void count(size_t n_calcs, size_t n_costs)
   {
-    (void)energy;
-    (void)f_sample;
-    (void)ndata;
-    (void)ptr_center;
-    throw zentas::zentas_error("cannot set vector center : from BaseLpDistance base class sparse");
+    v_counts[get_thread_index() & counts_mask].add(n_calcs, n_costs);
+  }
+
+  size_t get_ncalcs() const
+  {
+    size_t ncalcs = 0;
+    for (auto& x : v_counts)
+    {
+      ncalcs += x.ncalcs.load(std::memory_order_relaxed);
+    }
+    return ncalcs;
+  }
+
+  size_t get_calccosts() const
+  {
+    size_t calccosts = 0;
+    for (auto& x : v_counts)
+    {
+      calccosts += x.calccosts.load(std::memory_order_relaxed);
+    }
+    return calccosts;
   }
 
   void update_sum(const std::string&                           energy,
@@ -196,17 +230,30 @@ class L2Minimiser
     }
   }
 
-  void set_center(const std::string&                                               energy,
-                  const std::function<const SparseVectorSample<TNumber>&(size_t)>& f_sample,
-                  size_t                                                           ndata,
-                  SparseVectorRfCenter<TNumber>* const                             minimiser)
+  /* the mean, as a running sum over the samples. An empty cluster keeps its center, as in
+   * set_rf_center_data, rather than becoming 0 / 0. */
+  void set_center(const std::string&                                        energy,
+                  const std::function<SparseVectorSample<TNumber>(size_t)>& f_sample,
+                  size_t                                                    ndata,
+                  SparseVectorRfCenter<TNumber>* const                      ptr_center)
   {
-    (void)energy;
-    (void)f_sample;
-    (void)ndata;
-    (void)minimiser;
-    throw zentas::zentas_error(
-      "cannot set vector centers for sparse data yet : from L2Minimiser base class sparse. ");
+    if (energy != "quadratic")
+    {
+      throw zentas::zentas_error(
+        "cannot yet perform L2 metric minimisation unless the energy is quadratic");
+    }
+
+    if (ndata == 0)
+    {
+      return;
+    }
+
+    ptr_center->set_to_zero();
+    for (size_t j = 0; j < ndata; ++j)
+    {
+      ptr_center->add_scaled(f_sample(j), 1);
+    }
+    ptr_center->scale(1. / static_cast<double>(ndata));
   }
 };
 
@@ -249,17 +296,75 @@ class L1Minimiser
     }
   }
 
-  void set_center(const std::string&                                               energy,
-                  const std::function<const SparseVectorSample<TNumber>&(size_t)>& f_sample,
-                  size_t                                                           ndata,
-                  SparseVectorRfCenter<TNumber>* const                             minimiser)
+  /* The median in each dimension, of ndata values of which only the nonzeros are stored. The
+   * (ndata - n_nonzero) implicit zeros lie between the negative and the positive values, so the
+   * median of the dense case (the value of rank ndata / 2) is either 0, or a value of known rank
+   * amongst the nonzeros, found with nth_element. */
+  void set_center(const std::string&                                        energy,
+                  const std::function<SparseVectorSample<TNumber>(size_t)>& f_sample,
+                  size_t                                                    ndata,
+                  SparseVectorRfCenter<TNumber>* const                      ptr_center)
   {
-    (void)energy;
-    (void)f_sample;
-    (void)ndata;
-    (void)minimiser;
-    throw zentas::zentas_error(
-      "cannot set vector centers for sparse data yet : from L1Minimiser base class sparse. ");
+    if (energy != "identity")
+    {
+      throw zentas::zentas_error("cannot yet perform L1 metric minimisation unless the energy is "
+                                 "identity (ie loss is sum of l1 distances to nearest centers)");
+    }
+
+    std::vector<std::pair<size_t, TNumber>> nonzeros;
+    for (size_t j = 0; j < ndata; ++j)
+    {
+      SparseVectorSample<TNumber> sample = f_sample(j);
+      for (size_t d = 0; d < sample.size; ++d)
+      {
+        nonzeros.emplace_back(sample.indices[d], sample.values[d]);
+      }
+    }
+    std::sort(nonzeros.begin(),
+              nonzeros.end(),
+              [](const std::pair<size_t, TNumber>& a, const std::pair<size_t, TNumber>& b) {
+                return a.first < b.first;
+              });
+
+    std::vector<size_t>  indices;
+    std::vector<TNumber> values;
+    std::vector<TNumber> dimension_values;
+    size_t               rank = ndata / 2;
+    size_t               n_negative;
+    size_t               n_zero;
+    TNumber              median;
+    auto                 begin = nonzeros.begin();
+    while (begin != nonzeros.end())
+    {
+      dimension_values.clear();
+      n_negative = 0;
+      auto end   = begin;
+      while (end != nonzeros.end() && end->first == begin->first)
+      {
+        dimension_values.push_back(end->second);
+        n_negative += (end->second < 0);
+        ++end;
+      }
+      n_zero = ndata - dimension_values.size();
+
+      median = 0;
+      if (rank < n_negative || rank >= n_negative + n_zero)
+      {
+        size_t nonzero_rank = rank < n_negative ? rank : rank - n_zero;
+        std::nth_element(dimension_values.begin(),
+                         dimension_values.begin() + nonzero_rank,
+                         dimension_values.end());
+        median = dimension_values[nonzero_rank];
+      }
+      if (median != 0)
+      {
+        indices.push_back(begin->first);
+        values.push_back(median);
+      }
+      begin = end;
+    }
+
+    ptr_center->swap_in_sorted(indices, values);
   }
 };
 
@@ -289,6 +394,19 @@ class NoimplMinimiser
   }
 };
 
+/* For l2 with cached squared norms, the absolute error in ||a||^2 + ||b||^2 - 2 a.b is
+ * about dimension * epsilon * (||a||^2 + ||b||^2). When the squared distance is less than
+ * normed_l2_recompute_ratio * dimension * (||a||^2 + ||b||^2) it is recomputed directly,
+ * which keeps the relative error below about 1e-7. */
+constexpr double normed_l2_recompute_ratio = 1e-9;
+
+/* The dot product of a sorted sparse refinement center and a sample is by binary search when
+ * the center has more than sparse_rf_center_search_ratio times as many entries as the sample */
+constexpr size_t sparse_rf_center_search_ratio = 16;
+
+/* The number of samples gathered per call to a batch kernel, in TLpDistance::set_distances */
+constexpr size_t batch_tile_size = 64;
+
 template <typename TNumber,
           class CorrectThreshold,
           class CorrectDistance,
@@ -299,8 +417,7 @@ class TLpDistance : public BaseLpDistance<TNumber>
 
   public:
   using BaseLpDistance<TNumber>::dimension;
-  using BaseLpDistance<TNumber>::ncalcs;
-  using BaseLpDistance<TNumber>::calccosts;
+  using BaseLpDistance<TNumber>::count;
 
   private:
   CorrectThreshold correct_threshold;
@@ -308,55 +425,25 @@ class TLpDistance : public BaseLpDistance<TNumber>
   UpdateDistance   update_distance;
   FMinimiser       f_minimiser;
 
-  public:
-  TLpDistance(size_t dimension) : BaseLpDistance<TNumber>(dimension), f_minimiser(dimension) {}
-
-  void set_distance(const TNumber* const& a,
-                    const TNumber* const& b,
-                    double                threshold,
-                    double&               a_distance) override final
+  /* chosen at runtime, according to the instruction sets the CPU supports */
+  lpkernels::DenseLpKernel<TNumber>      dense_kernel;
+  lpkernels::DenseLpBatchKernel<TNumber> dense_batch_kernel;
+  lpkernels::DenseDotKernel<TNumber>     dot_kernel;
+  lpkernels::SparseDotKernel<TNumber>    sparse_dot_kernel;
+
+  /* the distance before correct_distance, abandoned once it exceeds threshold */
+  double get_sparse_merge_distance(const SparseVectorSample<TNumber>& a,
+                                   const SparseVectorSample<TNumber>& b,
+                                   double                             threshold,
+                                   size_t&                            n_costs)
   {
-
-    ++ncalcs;
-    a_distance = 0;
-    TNumber diff;
-    size_t  d;
-    correct_threshold(threshold);
-    for (d = 0; d < dimension; ++d)
-    {
-      diff = *(a + d) - *(b + d);
-      update_distance(a_distance, diff);
-
-      // This check helps when the data is pca-ed.
-      if (a_distance > static_cast<TNumber>(threshold))
-      {
-        correct_distance(a_distance);
-        calccosts += (1 + d);
-        return;
-      }
-    }
-    calccosts += dimension;
-
-    // checked, not too slow.
-    correct_distance(a_distance);
-  }
-
-  void set_distance(const SparseVectorSample<TNumber>& a,
-                    const SparseVectorSample<TNumber>& b,
-                    double                             threshold,
-                    double&                            distance) override final
-  {
-
-    ++ncalcs;
-    distance     = 0;
-    size_t a_pos = 0;
-    size_t b_pos = 0;
+    double distance = 0;
+    size_t a_pos    = 0;
+    size_t b_pos    = 0;
     /* if both a and b have unchecked indices remaining */
     bool    indices_remain = (a.size > 0 && b.size > 0);
     TNumber diff;
 
-    correct_threshold(threshold);
-
     while (indices_remain && distance <= threshold)
     {
       if (a.indices[a_pos] == b.indices[b_pos])
@@ -382,14 +469,14 @@ class TLpDistance : public BaseLpDistance<TNumber>
       }
 
       update_distance(distance, diff);
-      calccosts += 1;
+      n_costs += 1;
     }
 
     while (a_pos != a.size && distance < threshold)
     {
       diff = a.values[a_pos];
       update_distance(distance, diff);
-      calccosts += 1;
+      n_costs += 1;
       ++a_pos;
     }
 
@@ -397,107 +484,402 @@ class TLpDistance : public BaseLpDistance<TNumber>
     {
       diff = b.values[b_pos];
       update_distance(distance, diff);
-      calccosts += 1;
+      n_costs += 1;
       ++b_pos;
     }
 
-    correct_distance(distance);
+    return distance;
   }
 
-  void set_distance(const SparseVectorRfCenter<TNumber>& c_in,
-                    const SparseVectorSample<TNumber>&   x,
-                    double                               threshold,
-                    double&                              distance) override final
+  /* the dot product of c and x, accumulated in order of increasing index */
+  double get_sparse_rf_center_dot(const SparseVectorRfCenter<TNumber>& c,
+                                  const SparseVectorSample<TNumber>&   x,
+                                  size_t&                              n_costs)
   {
+    const TNumber* const c_values = c.get_values();
+    size_t               n        = c.get_n_entries();
+    double               dot      = 0;
 
-    ++ncalcs;
-    distance = 0;
-    correct_threshold(threshold);
+    if (c.is_dense())
+    {
+      for (size_t k = 0; k < x.size && x.indices[k] < n; ++k)
+      {
+        dot += static_cast<double>(c_values[x.indices[k]]) * static_cast<double>(x.values[k]);
+      }
+      n_costs += x.size;
+    }
 
-    SparseVectorRfCenter<TNumber> c(c_in);
+    else if (n > sparse_rf_center_search_ratio * x.size)
+    {
+      const size_t* const c_indices = c.get_indices();
+      const size_t*       position  = c_indices;
+      for (size_t k = 0; k < x.size; ++k)
+      {
+        position = std::lower_bound(position, c_indices + n, x.indices[k]);
+        if (position == c_indices + n)
+        {
+          break;
+        }
+        if (*position == x.indices[k])
+        {
+          dot += static_cast<double>(c_values[position - c_indices]) *
+                 static_cast<double>(x.values[k]);
+        }
+      }
+      n_costs += x.size;
+    }
 
-    for (size_t d = 0; d < x.size; ++d)
+    else
     {
+      dot = sparse_dot_kernel(c_values, c.get_indices(), n, x.values, x.indices, x.size);
+      n_costs += n + x.size;
+    }
 
-      if (c.count(x.indices[d]) == 1)
+    return dot;
+  }
+
+  /* the distance before correct_distance, abandoned once it exceeds threshold */
+  double get_sparse_rf_center_merge_distance(const SparseVectorRfCenter<TNumber>& c,
+                                             const SparseVectorSample<TNumber>&   x,
+                                             double                               threshold,
+                                             size_t&                              n_costs)
+  {
+    double  distance = 0;
+    size_t  e        = 0;
+    size_t  k        = 0;
+    size_t  n        = c.get_n_entries();
+    TNumber diff;
+    while ((e < n || k < x.size) && distance <= threshold)
+    {
+      if (k == x.size || (e < n && c.index_at(e) < x.indices[k]))
       {
-        update_distance(distance, c.at(x.indices[d]) - x.values[d]);
-        c[x.indices[d]] = 0;
+        diff = c.value_at(e);
+        ++e;
+      }
+      else if (e == n || x.indices[k] < c.index_at(e))
+      {
+        diff = x.values[k];
+        ++k;
       }
       else
       {
-        update_distance(distance, x.values[d]);
-        calccosts += 1;
+        diff = c.value_at(e) - x.values[k];
+        ++e;
+        ++k;
+      }
+      update_distance(distance, diff);
+      n_costs += 1;
+    }
+    return distance;
+  }
+
+  public:
+  TLpDistance(size_t dimension, size_t nthreads)
+    : BaseLpDistance<TNumber>(dimension, nthreads),
+      f_minimiser(dimension),
+      dense_kernel(lpkernels::get_dense_lp_kernel<TNumber>(UpdateDistance::p)),
+      dense_batch_kernel(lpkernels::get_dense_lp_batch_kernel<TNumber>(UpdateDistance::p)),
+      dot_kernel(lpkernels::get_dense_dot_kernel<TNumber>()),
+      sparse_dot_kernel(lpkernels::get_sparse_dot_kernel<TNumber>())
+  {
+  }
+
+  void set_distance(const TNumber* const& a,
+                    const TNumber* const& b,
+                    double                threshold,
+                    double&               a_distance)
+  {
+
+    correct_threshold(threshold);
+
+    /* Below one block, the call to the kernel costs more than the distance. This loop
+     * inlines (LpMetric is not virtual), and is the common case for low dimensional data. */
+    if (dimension < lpkernels::dense_block_size)
+    {
+      a_distance = 0;
+      TNumber diff;
+      for (size_t d = 0; d < dimension; ++d)
+      {
+        diff = a[d] - b[d];
+        update_distance(a_distance, diff);
+      }
+      count(1, dimension);
+      correct_distance(a_distance);
+      return;
+    }
+
+    /* The threshold check helps when the data is pca-ed. It is made once per block of
+     * lpkernels::dense_block_size, so that within a block the kernel can vectorise. */
+    size_t n_visited;
+    a_distance = dense_kernel(a, b, dimension, threshold, n_visited);
+    count(1, n_visited);
+
+    // checked, not too slow.
+    correct_distance(a_distance);
+  }
+
+  /* The distances from a to data.at_for_metric(j) for j in [j_begin, j_end), with
+   * thresholds[j - j_begin] (or no thresholds if thresholds is nullptr). The samples are
+   * gathered in tiles of batch_tile_size, a stays in L1 while the tile streams through the
+   * batch kernel. The distances are the same as from set_distance. */
+  template <class TData>
+  void set_distances(const TNumber* const& a,
+                     const TData&          data,
+                     size_t                j_begin,
+                     size_t                j_end,
+                     const double* const   thresholds,
+                     double* const         distances)
+  {
+    if (dimension < lpkernels::dense_block_size)
+    {
+      for (size_t j = j_begin; j < j_end; ++j)
+      {
+        set_distance(a,
+                     data.at_for_metric(j),
+                     thresholds ? thresholds[j - j_begin] : std::numeric_limits<double>::max(),
+                     distances[j - j_begin]);
       }
+      return;
     }
 
-    if (distance < threshold)
+    const TNumber* tile_samples[batch_tile_size];
+    double         tile_thresholds[batch_tile_size];
+    size_t         t_end;
+    size_t         n_visited;
+    for (size_t t_begin = j_begin; t_begin < j_end; t_begin = t_end)
     {
-      for (auto iter = c.cbegin(); iter != c.cend(); ++iter)
+      t_end = std::min(t_begin + batch_tile_size, j_end);
+      for (size_t j = t_begin; j < t_end; ++j)
       {
-        update_distance(distance, iter->second);
-        calccosts += 1;
+        tile_samples[j - t_begin] = data.at_for_metric(j);
+        tile_thresholds[j - t_begin] =
+          thresholds ? thresholds[j - j_begin] : std::numeric_limits<double>::max();
+        correct_threshold(tile_thresholds[j - t_begin]);
       }
+
+      dense_batch_kernel(a,
+                         tile_samples,
+                         t_end - t_begin,
+                         dimension,
+                         tile_thresholds,
+                         distances + (t_begin - j_begin),
+                         n_visited);
+      count(t_end - t_begin, n_visited);
+    }
+
+    for (size_t j = j_begin; j < j_end; ++j)
+    {
+      correct_distance(distances[j - j_begin]);
+    }
+  }
+
+  /* The fallback, one pair at a time (sparse vectors, refinement centers, l2c). */
+  template <typename TSample, class TData>
+  void set_distances(const TSample&      a,
+                     const TData&        data,
+                     size_t              j_begin,
+                     size_t              j_end,
+                     const double* const thresholds,
+                     double* const       distances)
+  {
+    for (size_t j = j_begin; j < j_end; ++j)
+    {
+      set_distance(a,
+                   data.at_for_metric(j),
+                   thresholds ? thresholds[j - j_begin] : std::numeric_limits<double>::max(),
+                   distances[j - j_begin]);
+    }
+  }
+
+  /* Metric "l2c". The threshold is not used : it changes between calls with the same pair,
+   * and the tests in with_tests mode require that the distance of a pair does not. */
+  void set_distance(const NormedDenseSample<TNumber>& a,
+                    const NormedDenseSample<TNumber>& b,
+                    double                            threshold,
+                    double&                           distance)
+  {
+    if (UpdateDistance::p != '2')
+    {
+      set_distance(a.values, b.values, threshold, distance);
+      return;
+    }
+
+    size_t n_costs  = dimension;
+    double sq_norms = a.sq_norm + b.sq_norm;
+    distance        = sq_norms - 2. * dot_kernel(a.values, b.values, dimension);
+
+    /* cancellation. This also catches negative distances. */
+    if (distance < normed_l2_recompute_ratio * dimension * sq_norms)
+    {
+      size_t n_visited;
+      distance = dense_kernel(
+        a.values, b.values, dimension, std::numeric_limits<double>::max(), n_visited);
+      n_costs += n_visited;
     }
+
+    count(1, n_costs);
     correct_distance(distance);
   }
 
-  void set_distance(const SparseVectorRfCenter<TNumber>& c1,
-                    const SparseVectorRfCenter<TNumber>& c2,
-                    double                               threshold,
-                    double&                              distance) override final
+  /* Reduced precision storage. TNumber is the type of the full precision input, which is not
+   * used here. The kernel is chosen on the first call, for each TCode. */
+  template <typename TCode>
+  void set_distance(const QuantisedDenseSample<TCode>& a,
+                    const QuantisedDenseSample<TCode>& b,
+                    double                             threshold,
+                    double&                            distance)
   {
+    static const lpkernels::QuantisedLpKernel<TCode> quantised_kernel =
+      lpkernels::get_quantised_lp_kernel<TCode>(UpdateDistance::p);
+
+    correct_threshold(threshold);
+    size_t n_visited;
+    distance = quantised_kernel(a.codes, b.codes, a.scales, dimension, threshold, n_visited);
+    count(1, n_visited);
+    correct_distance(distance);
+  }
 
-    ++ncalcs;
-    distance = 0;
+  /* For l2, ||a||^2 + ||b||^2 - 2 a.b, where only the intersection of the indices of a and b is
+   * walked. As for l2c, the threshold is not used. For the other p, the indices are merged. */
+  void set_distance(const SparseVectorSample<TNumber>& a,
+                    const SparseVectorSample<TNumber>& b,
+                    double                             threshold,
+                    double&                            distance)
+  {
+    size_t n_costs = 0;
     correct_threshold(threshold);
 
-    for (auto iter = c1.cbegin(); iter != c1.cend(); ++iter)
+    if (UpdateDistance::p == '2')
     {
-      calccosts += 1;
-      if (c2.count(iter->first) == 0)
+      double sq_norms = a.sq_norm + b.sq_norm;
+      distance =
+        sq_norms -
+        2. * sparse_dot_kernel(a.values, a.indices, a.size, b.values, b.indices, b.size);
+      n_costs = a.size + b.size;
+
+      /* cancellation, as for l2c, with a.size + b.size in place of the dimension */
+      if (distance < normed_l2_recompute_ratio * (a.size + b.size) * sq_norms)
       {
-        update_distance(distance, iter->second);
+        distance = get_sparse_merge_distance(a, b, std::numeric_limits<double>::max(), n_costs);
       }
-      else
-      {
-        update_distance(distance, iter->second - c2.at(iter->first));
-      }
-      if (distance > threshold)
+    }
+
+    else
+    {
+      distance = get_sparse_merge_distance(a, b, threshold, n_costs);
+    }
+
+    count(1, n_costs);
+    correct_distance(distance);
+  }
+
+  /* Sparse refinement centers. For l2, as for two samples, with the dot product by direct
+   * lookup if c is dense, by binary search if c has many more entries than x, and by the
+   * sparse dot kernel otherwise. */
+  void set_distance(const SparseVectorRfCenter<TNumber>& c,
+                    const SparseVectorSample<TNumber>&   x,
+                    double                               threshold,
+                    double&                              distance)
+  {
+    size_t n_costs = 0;
+    correct_threshold(threshold);
+
+    if (UpdateDistance::p == '2')
+    {
+      double sq_norms = c.get_sq_norm() + x.sq_norm;
+      distance        = sq_norms - 2. * get_sparse_rf_center_dot(c, x, n_costs);
+      if (distance < normed_l2_recompute_ratio * (c.get_n_entries() + x.size) * sq_norms)
       {
-        break;
+        distance =
+          get_sparse_rf_center_merge_distance(c, x, std::numeric_limits<double>::max(), n_costs);
       }
     }
 
-    for (auto iter = c2.cbegin(); iter != c2.cend(); ++iter)
+    else
     {
-      if (c1.count(iter->first) == 0)
+      distance = get_sparse_rf_center_merge_distance(c, x, threshold, n_costs);
+    }
+
+    count(1, n_costs);
+    correct_distance(distance);
+  }
+
+  void set_distance(const SparseVectorRfCenter<TNumber>& c1,
+                    const SparseVectorRfCenter<TNumber>& c2,
+                    double                               threshold,
+                    double&                              distance)
+  {
+
+    size_t n_costs = 0;
+    distance       = 0;
+    correct_threshold(threshold);
+
+    size_t  e1 = 0;
+    size_t  e2 = 0;
+    size_t  n1 = c1.get_n_entries();
+    size_t  n2 = c2.get_n_entries();
+    TNumber diff;
+    while ((e1 < n1 || e2 < n2) && distance <= threshold)
+    {
+      if (e2 == n2 || (e1 < n1 && c1.index_at(e1) < c2.index_at(e2)))
+      {
+        diff = c1.value_at(e1);
+        ++e1;
+      }
+      else if (e1 == n1 || c2.index_at(e2) < c1.index_at(e1))
       {
-        update_distance(distance, iter->second);
-        calccosts += 1;
+        diff = c2.value_at(e2);
+        ++e2;
       }
-      if (distance > threshold)
+      else
       {
-        break;
+        diff = c1.value_at(e1) - c2.value_at(e2);
+        ++e1;
+        ++e2;
       }
+      update_distance(distance, diff);
+      n_costs += 1;
     }
 
+    count(1, n_costs);
     correct_distance(distance);
   }
 
-  virtual void set_center(const std::string&                           energy,
-                          const std::function<const TNumber*(size_t)>& f_sample,
-                          size_t                                       ndata,
-                          TNumber* const                               ptr_center) override final
+  void set_center(const std::string&                           energy,
+                  const std::function<const TNumber*(size_t)>& f_sample,
+                  size_t                                       ndata,
+                  TNumber* const                               ptr_center)
   {
     f_minimiser.set_center(energy, f_sample, ndata, ptr_center);
   }
 
-  virtual void
-  set_center(const std::string&                                               energy,
-             const std::function<const SparseVectorSample<TNumber>&(size_t)>& f_sample,
-             size_t                                                           ndata,
-             SparseVectorRfCenter<TNumber>* const ptr_center) override final
+  void set_center(const std::string&                                       energy,
+                  const std::function<NormedDenseSample<TNumber>(size_t)>& f_sample,
+                  size_t                                                   ndata,
+                  TNumber* const                                           ptr_center)
+  {
+    std::function<const TNumber*(size_t)> f_values(
+      [&f_sample](size_t j) { return f_sample(j).values; });
+    f_minimiser.set_center(energy, f_values, ndata, ptr_center);
+  }
+
+  template <typename TCode, typename TPointerCenter>
+  void set_center(const std::string&                                         energy,
+                  const std::function<QuantisedDenseSample<TCode>(size_t)>& f_sample,
+                  size_t                                                     ndata,
+                  TPointerCenter                                             ptr_center)
+  {
+    (void)energy;
+    (void)f_sample;
+    (void)ndata;
+    (void)ptr_center;
+    throw zentas::zentas_error("cannot set vector centers with reduced precision storage");
+  }
+
+  void set_center(const std::string&                                        energy,
+                  const std::function<SparseVectorSample<TNumber>(size_t)>& f_sample,
+                  size_t                                                    ndata,
+                  SparseVectorRfCenter<TNumber>* const                      ptr_center)
   {
     f_minimiser.set_center(energy, f_sample, ndata, ptr_center);
   }
@@ -521,27 +903,78 @@ class RootDouble
   inline void operator()(double& x) { x = std::sqrt(x); }
 };
 
+/* Metrics cosine and angular, for samples of unit l2 norm (scaled once, in vzentas and
+ * sparse_vector_zentas). The distances are computed as for l2, in the squared l2 distance
+ * s = 2 - 2 cos(a, b), with the squared norms cached. Metric cosine is sqrt(1 - cos(a, b)),
+ * which (unlike 1 - cos(a, b)) satisfies the triangle inequality : with energy quadratic, the
+ * energy is the sum of the cosine distances 1 - cos(a, b), as with l2 and k-means. Metric
+ * angular is the angle between a and b, divided by pi. */
+constexpr double angular_pi = 3.14159265358979323846;
+
+class CosineToSquared
+{
+  public:
+  inline void operator()(double& x) { x = 2 * x * x; }
+};
+
+class SquaredToCosine
+{
+  public:
+  inline void operator()(double& x) { x = std::sqrt(std::max(0., x) / 2); }
+};
+
+class AngularToSquared
+{
+  public:
+  inline void operator()(double& x)
+  {
+    if (x >= 1)
+    {
+      x = std::numeric_limits<double>::max();
+    }
+    else
+    {
+      x = 2 * std::sin(angular_pi * x / 2);
+      x *= x;
+    }
+  }
+};
+
+/* 2 asin(chord / 2), which unlike acos(1 - s / 2) is well conditioned for small angles */
+class SquaredToAngular
+{
+  public:
+  inline void operator()(double& x)
+  {
+    x = 2 * std::asin(std::min(1., std::sqrt(std::max(0., x)) / 2)) / angular_pi;
+  }
+};
+
 class NonZero
 {
   public:
+  static constexpr char p = '0';
   inline void operator()(double& dist, const double& diff) { dist += (diff != 0); }
 };
 
 class AbsDiff
 {
   public:
+  static constexpr char p = '1';
   inline void operator()(double& dist, const double& diff) { dist += std::abs(diff); }
 };
 
 class SquareDiff
 {
   public:
+  static constexpr char p = '2';
   inline void operator()(double& dist, const double& diff) { dist += diff * diff; }
 };
 
 class MaxDiff
 {
   public:
+  static constexpr char p = 'i';
   inline void operator()(double& dist, const double& diff)
   {
     dist = std::max(dist, std::abs(diff));
@@ -561,8 +994,57 @@ using L2Distance =
 template <typename TNumber>
 using L_oo_Distance = TLpDistance<TNumber, NullOpDouble, NullOpDouble, MaxDiff, NoimplMinimiser>;
 
-/* where TVDataIn has public size_t dimension and typename TVDataIn::Sample */
-template <typename TVDataIn>
+template <typename TNumber>
+using CosineDistance =
+  TLpDistance<TNumber, CosineToSquared, SquaredToCosine, SquareDiff, NoimplMinimiser>;
+
+template <typename TNumber>
+using AngularDistance =
+  TLpDistance<TNumber, AngularToSquared, SquaredToAngular, SquareDiff, NoimplMinimiser>;
+
+/* The distance class for each p in {'0', '1', '2', 'i'}, and 'c' (cosine) and 'a' (angular) */
+template <typename TNumber, char P>
+struct LpDistanceType;
+
+template <typename TNumber>
+struct LpDistanceType<TNumber, '0'>
+{
+  typedef L0Distance<TNumber> type;
+};
+
+template <typename TNumber>
+struct LpDistanceType<TNumber, '1'>
+{
+  typedef L1Distance<TNumber> type;
+};
+
+template <typename TNumber>
+struct LpDistanceType<TNumber, '2'>
+{
+  typedef L2Distance<TNumber> type;
+};
+
+template <typename TNumber>
+struct LpDistanceType<TNumber, 'i'>
+{
+  typedef L_oo_Distance<TNumber> type;
+};
+
+template <typename TNumber>
+struct LpDistanceType<TNumber, 'c'>
+{
+  typedef CosineDistance<TNumber> type;
+};
+
+template <typename TNumber>
+struct LpDistanceType<TNumber, 'a'>
+{
+  typedef AngularDistance<TNumber> type;
+};
+
+/* where TVDataIn has public size_t dimension and typename TVDataIn::Sample.
+ * P is chosen once, in vzentas and sparse_vector_zentas (see lp_zentas_base). */
+template <typename TVDataIn, char P>
 class LpMetric
 {
 
@@ -571,42 +1053,24 @@ class LpMetric
   typedef typename TVDataIn::AtomicType AtomicType;
   typedef LpMetricInitializer           Initializer;
 
+  static constexpr bool satisfies_triangle_inequality = true;
+
   private:
-  std::unique_ptr<BaseLpDistance<AtomicType>> uptr_lpdistance;
+  /* Previously this was a unique_ptr to a BaseLpDistance, and each call to set_distance was
+   * virtual. That cost about 2% when dimension = 2, but it also prevented inlining
+   * of the distance (and now the dense kernel call) into the Clusterer methods. */
+  typename LpDistanceType<AtomicType, P>::type lpdistance;
 
   public:
-  char get_p() { return p; }
+  char get_p() { return P; }
 
-  LpMetric(const TVDataIn& datain, size_t nthreads, const LpMetricInitializer& l2mi) : p(l2mi.p)
+  LpMetric(const TVDataIn& datain, size_t nthreads, const LpMetricInitializer& l2mi)
+    : lpdistance(datain.dimension, nthreads)
   {
-
-    // quelch warning.
-    (void)nthreads;
-
-    if (p == '2')
-    {
-      uptr_lpdistance.reset(new L2Distance<AtomicType>(datain.dimension));
-    }
-
-    else if (p == '1')
+    if (l2mi.p != P)
     {
-      uptr_lpdistance.reset(new L1Distance<AtomicType>(datain.dimension));
-    }
-
-    else if (p == '0')
-    {
-      uptr_lpdistance.reset(new L0Distance<AtomicType>(datain.dimension));
-    }
-
-    else if (p == 'i')
-    {
-      uptr_lpdistance.reset(new L_oo_Distance<AtomicType>(datain.dimension));
-    }
-
-    else
-    {
-      std::string err = "No implementation for p = ";
-      err             = err + p;
+      std::string err = "LpMetric with p = ";
+      err             = err + P + " initialised with p = " + l2mi.p;
       throw zentas::zentas_error(err);
     }
   }
@@ -614,20 +1078,26 @@ class LpMetric
   template <typename T, typename V>
   void set_distance(const T& a, const V& b, double threshold, double& distance)
   {
-    /* This virtual function call costs
-     * about 2% when dimension = 2. 2%
-     * slowdown is negligible, I'm going
-     * for this clean code.  */
+    lpdistance.set_distance(a, b, threshold, distance);
+  }
 
-    uptr_lpdistance->set_distance(a, b, threshold, distance);
+  template <typename T, class TData>
+  void set_distances(const T&            a,
+                     const TData&        data,
+                     size_t              j_begin,
+                     size_t              j_end,
+                     const double* const thresholds,
+                     double* const       distances)
+  {
+    lpdistance.set_distances(a, data, j_begin, j_end, thresholds, distances);
   }
 
-  size_t get_ncalcs() const { return uptr_lpdistance->ncalcs; }
+  size_t get_ncalcs() const { return lpdistance.get_ncalcs(); }
 
   double get_rel_calccosts() const
   {
-    return static_cast<double>(uptr_lpdistance->calccosts) /
-           static_cast<double>(uptr_lpdistance->ncalcs);
+    return static_cast<double>(lpdistance.get_calccosts()) /
+           static_cast<double>(lpdistance.get_ncalcs());
   }
 
   template <typename TPointerCenter, typename TFunction>
@@ -636,7 +1106,7 @@ class LpMetric
                   size_t             ndata,
                   TPointerCenter     ptr_center)
   {
-    uptr_lpdistance->set_center(energy, f_sample, ndata, ptr_center);
+    lpdistance.set_center(energy, f_sample, ndata, ptr_center);
   }
 
   template <typename TPointerCenter, typename TFunction>
@@ -647,11 +1117,8 @@ class LpMetric
                   size_t             n_subtract,
                   TPointerCenter     ptr_sum)
   {
-    uptr_lpdistance->set_center(energy, f_add, n_add, f_subtract, n_subtract, ptr_sum);
+    lpdistance.update_sum(energy, f_add, n_add, f_subtract, n_subtract, ptr_sum);
   }
-
-  private:
-  const char p;
 };
 
 }  // namespace nszen
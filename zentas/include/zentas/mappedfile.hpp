@@ -0,0 +1,106 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#ifndef ZENTAS_MAPPEDFILE_HPP
+#define ZENTAS_MAPPEDFILE_HPP
+
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <zentas/zentaserror.hpp>
+
+namespace nszen
+{
+
+enum class AccessAdvice
+{
+  normal,
+  sequential,
+  random
+};
+
+/* A file mapped read-only into memory (mmap), so that rooted data can be clustered without
+ * loading it into the heap : pages are read on access, and may be dropped by the kernel under
+ * memory pressure. Unmapped on destruction. */
+class MappedFile
+{
+
+  private:
+  std::string filename;
+  const char* data;
+  size_t      size;
+
+  public:
+  MappedFile(const std::string& filename);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* get_data() const { return data; }
+
+  size_t get_size() const { return size; }
+
+  /* madvise the kernel on how the pages will be accessed (read ahead or not) */
+  void advise(AccessAdvice advice) const;
+};
+
+/* advise all MappedFiles which currently exist. SkeletonClusterer calls this with sequential
+ * before initialisation (kmeans++ makes passes over the data), with random before k-medoids,
+ * and with normal when done. Without MappedFiles it does nothing. */
+void advise_mapped_files(AccessAdvice advice);
+
+/* the numpy dtype string of T (little endian, as are all hosts zentas runs on) */
+template <typename T>
+std::string get_npy_descr()
+{
+  std::string kind = std::is_floating_point<T>::value ? "f" : std::is_signed<T>::value ? "i" : "u";
+  return (sizeof(T) == 1 ? "|" : "<") + kind + std::to_string(sizeof(T));
+}
+
+/* An array in a .npy file (numpy.save), memory mapped. The data must be C-ordered (not
+ * fortran_order) and of the type requested in get_data, which is not converted. */
+class NpyArray
+{
+
+  private:
+  MappedFile          file;
+  std::string         descr;
+  std::vector<size_t> shape;
+  size_t              n_values;
+  size_t              data_offset;
+
+  public:
+  NpyArray(const std::string& filename);
+
+  const std::vector<size_t>& get_shape() const { return shape; }
+
+  size_t get_n_values() const { return n_values; }
+
+  const std::string& get_descr() const { return descr; }
+
+  template <typename T>
+  bool is_of_type() const
+  {
+    /* bytes (dtype S1) are accepted as char */
+    return descr == get_npy_descr<T>() || (sizeof(T) == 1 && descr == "|S1");
+  }
+
+  template <typename T>
+  const T* get_data() const
+  {
+    if (is_of_type<T>() == false)
+    {
+      throw zentas::zentas_error("the .npy array has dtype " + descr + ", not the expected " +
+                                 get_npy_descr<T>());
+    }
+    if (data_offset % alignof(T) != 0)
+    {
+      throw zentas::zentas_error("the data of the .npy array is not aligned for its dtype");
+    }
+    return reinterpret_cast<const T*>(file.get_data() + data_offset);
+  }
+};
+
+}  // namespace nszen
+
+#endif
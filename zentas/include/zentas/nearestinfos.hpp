@@ -0,0 +1,535 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#ifndef ZENTAS_NEARESTINFOS_HPP
+#define ZENTAS_NEARESTINFOS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+#include <zentas/zentaserror.hpp>
+
+namespace nszen
+{
+
+/* The type in which the distances and energies of the samples to their nearest centers are
+ * stored. With the cmake option FLOAT_NEAREST_INFOS they are floats, which halves their memory
+ * but rounds the distances and energies which the algorithms compare. */
+#ifdef ZENTAS_FLOAT_NEAREST_INFOS
+using InfoFloat = float;
+#else
+using InfoFloat = double;
+#endif
+
+/* x, rounded as it is when stored as an InfoFloat. */
+inline double get_as_stored(double x) { return static_cast<InfoFloat>(x); }
+
+/* K segments (one per cluster) in a single vector. Segment k is
+ * [offsets[k], offsets[k] + sizes[k]) of data, with room for capacities[k] values. A full
+ * segment gets twice the capacity, in place if it is at the end of data, otherwise by moving
+ * it to the end. Capacities do not shrink, so a cluster which returns to a size it had does
+ * not move again. When data has no capacity left for a growing segment, rather than being
+ * reallocated, the segments are packed (leaving out the space of segments which moved) into
+ * a new data with the capacity for as many values again as all segments can hold. As with
+ * std::vector, append invalidates references to values. */
+template <typename T>
+class ClusterSegmentedVector
+{
+
+  private:
+  std::vector<T>      data;
+  std::vector<size_t> offsets;
+  std::vector<size_t> sizes;
+  std::vector<size_t> capacities;
+  size_t              n_values;
+  /* the sum of capacities */
+  size_t n_capacity;
+  /* the bytes copied by relocating and packing segments (data is not otherwise reallocated) */
+  size_t n_bytes_reallocated;
+
+  void pack()
+  {
+    n_bytes_reallocated += n_values * sizeof(T);
+    std::vector<T> packed;
+    packed.reserve(2 * n_capacity);
+    for (size_t k = 0; k < offsets.size(); ++k)
+    {
+      size_t offset = packed.size();
+      packed.insert(packed.end(),
+                    data.begin() + static_cast<std::ptrdiff_t>(offsets[k]),
+                    data.begin() + static_cast<std::ptrdiff_t>(offsets[k] + sizes[k]));
+      packed.resize(offset + capacities[k]);
+      offsets[k] = offset;
+    }
+    data.swap(packed);
+  }
+
+  /* segment k gets room for new_capacity values, which data has the capacity for */
+  void relocate(size_t k, size_t new_capacity)
+  {
+    if (offsets[k] + capacities[k] == data.size())
+    {
+      data.resize(offsets[k] + new_capacity);
+    }
+
+    else
+    {
+      size_t offset = data.size();
+      data.resize(offset + new_capacity);
+      n_bytes_reallocated += sizes[k] * sizeof(T);
+      std::copy(data.begin() + static_cast<std::ptrdiff_t>(offsets[k]),
+                data.begin() + static_cast<std::ptrdiff_t>(offsets[k] + sizes[k]),
+                data.begin() + static_cast<std::ptrdiff_t>(offset));
+      offsets[k] = offset;
+    }
+    n_capacity += new_capacity - capacities[k];
+    capacities[k] = new_capacity;
+  }
+
+  /* segment k gets room for at least min_capacity values */
+  void grow(size_t k, size_t min_capacity)
+  {
+    size_t new_capacity = std::max<size_t>({4, 2 * capacities[k], min_capacity});
+    bool   is_at_end    = offsets[k] + capacities[k] == data.size();
+    size_t n_new        = is_at_end ? new_capacity - capacities[k] : new_capacity;
+    if (data.size() + n_new > data.capacity())
+    {
+      n_capacity += new_capacity - capacities[k];
+      capacities[k] = new_capacity;
+      pack();
+    }
+
+    else
+    {
+      relocate(k, new_capacity);
+    }
+  }
+
+  public:
+  ClusterSegmentedVector(size_t K)
+    : offsets(K, 0),
+      sizes(K, 0),
+      capacities(K, 0),
+      n_values(0),
+      n_capacity(0),
+      n_bytes_reallocated(0)
+  {
+  }
+
+  size_t size(size_t k) const { return sizes[k]; }
+
+  T& operator()(size_t k, size_t j) { return data[offsets[k] + j]; }
+
+  const T& operator()(size_t k, size_t j) const { return data[offsets[k] + j]; }
+
+  /* the values of cluster k are get(k)[0, ..., size(k) - 1] */
+  const T* get(size_t k) const { return data.data() + offsets[k]; }
+
+  T* get(size_t k) { return data.data() + offsets[k]; }
+
+  const T& back(size_t k) const { return data[offsets[k] + sizes[k] - 1]; }
+
+  size_t get_n_bytes_reallocated() const { return n_bytes_reallocated; }
+
+  /* room for new_capacities[k] values in segment k. If any segment grows, the segments are
+   * packed with their new capacities. */
+  void reserve(const std::vector<size_t>& new_capacities)
+  {
+    bool is_growing = false;
+    for (size_t k = 0; k < offsets.size(); ++k)
+    {
+      if (new_capacities[k] > capacities[k])
+      {
+        n_capacity += new_capacities[k] - capacities[k];
+        capacities[k] = new_capacities[k];
+        is_growing    = true;
+      }
+    }
+    if (is_growing)
+    {
+      pack();
+    }
+  }
+
+  void append(size_t k, T value)
+  {
+    if (sizes[k] == capacities[k])
+    {
+      grow(k, 0);
+    }
+    data[offsets[k] + sizes[k]] = value;
+    ++sizes[k];
+    ++n_values;
+  }
+
+  /* values[0, ..., n - 1] are appended to segment k. If segment k grows, values which are in
+   * data (in another segment) are copied first, as growing moves them. */
+  void append(size_t k, const T* values, size_t n)
+  {
+    std::vector<T> copied;
+    if (sizes[k] + n > capacities[k])
+    {
+      if (std::less_equal<const T*>()(data.data(), values) &&
+          std::less<const T*>()(values, data.data() + data.size()))
+      {
+        copied.assign(values, values + n);
+        values = copied.data();
+      }
+      while (sizes[k] + n > capacities[k])
+      {
+        grow(k, sizes[k] + n);
+      }
+    }
+    std::copy(
+      values, values + n, data.begin() + static_cast<std::ptrdiff_t>(offsets[k] + sizes[k]));
+    sizes[k] += n;
+    n_values += n;
+  }
+
+  void remove_last(size_t k)
+  {
+    if (sizes[k] == 0)
+    {
+      throw zentas::zentas_error("Request for remove_last, but the segment is empty");
+    }
+    --sizes[k];
+    --n_values;
+  }
+
+  /* n values T() are appended to segment k */
+  void extend(size_t k, size_t n)
+  {
+    while (sizes[k] + n > capacities[k])
+    {
+      grow(k, sizes[k] + n);
+    }
+    std::fill_n(data.begin() + static_cast<std::ptrdiff_t>(offsets[k] + sizes[k]), n, T());
+    sizes[k] += n;
+    n_values += n;
+  }
+
+  /* the last n values of segment k are removed */
+  void remove_last(size_t k, size_t n)
+  {
+    if (sizes[k] < n)
+    {
+      throw zentas::zentas_error("Request for remove_last, but the segment is too small");
+    }
+    sizes[k] -= n;
+    n_values -= n;
+  }
+
+  void replace_with_last(size_t k, size_t j) { (*this)(k, j) = back(k); }
+
+  void swap_clusters(size_t k1, size_t k2)
+  {
+    std::swap(offsets[k1], offsets[k2]);
+    std::swap(sizes[k1], sizes[k2]);
+    std::swap(capacities[k1], capacities[k2]);
+  }
+
+  /* all clusters are emptied, and the memory is released */
+  void clear()
+  {
+    std::vector<T>().swap(data);
+    std::fill(offsets.begin(), offsets.end(), 0);
+    std::fill(sizes.begin(), sizes.end(), 0);
+    std::fill(capacities.begin(), capacities.end(), 0);
+    n_values   = 0;
+    n_capacity = 0;
+  }
+};
+
+/* Sample indices (sample IDs, and positions of samples in the input) are stored in 32 bits,
+ * unless there are 2^32 or more samples, in which case in 64 bits. The width is chosen per run,
+ * from ndata, by is_wide_sample_IDs. */
+inline bool is_wide_sample_IDs(size_t ndata)
+{
+  return ndata > std::numeric_limits<uint32_t>::max();
+}
+
+/* A vector of sample indices, of uint32_t or (if wide) uint64_t. */
+class SampleIDVector
+{
+
+  private:
+  bool                  is_wide;
+  std::vector<uint32_t> narrow_IDs;
+  std::vector<uint64_t> wide_IDs;
+
+  public:
+  SampleIDVector(bool is_wide_ = false) : is_wide(is_wide_) {}
+
+  size_t size() const { return is_wide ? wide_IDs.size() : narrow_IDs.size(); }
+
+  bool empty() const { return size() == 0; }
+
+  size_t operator[](size_t i) const { return is_wide ? wide_IDs[i] : narrow_IDs[i]; }
+
+  size_t back() const { return (*this)[size() - 1]; }
+
+  void set(size_t i, size_t ID)
+  {
+    if (is_wide)
+    {
+      wide_IDs[i] = ID;
+    }
+    else
+    {
+      narrow_IDs[i] = static_cast<uint32_t>(ID);
+    }
+  }
+
+  void resize(size_t n)
+  {
+    if (is_wide)
+    {
+      wide_IDs.resize(n);
+    }
+    else
+    {
+      narrow_IDs.resize(n);
+    }
+  }
+
+  void push_back(size_t ID)
+  {
+    if (is_wide)
+    {
+      wide_IDs.push_back(ID);
+    }
+    else
+    {
+      narrow_IDs.push_back(static_cast<uint32_t>(ID));
+    }
+  }
+
+  void pop_back()
+  {
+    if (is_wide)
+    {
+      wide_IDs.pop_back();
+    }
+    else
+    {
+      narrow_IDs.pop_back();
+    }
+  }
+};
+
+/* The sample IDs of the clusters, as a ClusterSegmentedVector of uint32_t or (if wide)
+ * uint64_t. */
+class SegmentedSampleIDs
+{
+
+  private:
+  bool                             is_wide;
+  ClusterSegmentedVector<uint32_t> narrow_IDs;
+  ClusterSegmentedVector<uint64_t> wide_IDs;
+
+  public:
+  SegmentedSampleIDs(size_t K, bool is_wide_)
+    : is_wide(is_wide_), narrow_IDs(is_wide ? 0 : K), wide_IDs(is_wide ? K : 0)
+  {
+  }
+
+  size_t operator()(size_t k, size_t j) const
+  {
+    return is_wide ? wide_IDs(k, j) : narrow_IDs(k, j);
+  }
+
+  void set(size_t k, size_t j, size_t ID)
+  {
+    if (is_wide)
+    {
+      wide_IDs(k, j) = ID;
+    }
+    else
+    {
+      narrow_IDs(k, j) = static_cast<uint32_t>(ID);
+    }
+  }
+
+  size_t get_n_bytes_reallocated() const
+  {
+    return is_wide ? wide_IDs.get_n_bytes_reallocated() : narrow_IDs.get_n_bytes_reallocated();
+  }
+
+  void reserve(const std::vector<size_t>& new_capacities)
+  {
+    if (is_wide)
+    {
+      wide_IDs.reserve(new_capacities);
+    }
+    else
+    {
+      narrow_IDs.reserve(new_capacities);
+    }
+  }
+
+  void append(size_t k, size_t ID)
+  {
+    if (is_wide)
+    {
+      wide_IDs.append(k, ID);
+    }
+    else
+    {
+      narrow_IDs.append(k, static_cast<uint32_t>(ID));
+    }
+  }
+
+  void remove_last(size_t k)
+  {
+    if (is_wide)
+    {
+      wide_IDs.remove_last(k);
+    }
+    else
+    {
+      narrow_IDs.remove_last(k);
+    }
+  }
+
+  void replace_with_last(size_t k, size_t j)
+  {
+    if (is_wide)
+    {
+      wide_IDs.replace_with_last(k, j);
+    }
+    else
+    {
+      narrow_IDs.replace_with_last(k, j);
+    }
+  }
+
+  void swap_clusters(size_t k1, size_t k2)
+  {
+    if (is_wide)
+    {
+      wide_IDs.swap_clusters(k1, k2);
+    }
+    else
+    {
+      narrow_IDs.swap_clusters(k1, k2);
+    }
+  }
+};
+
+/* For each sample, its cluster k and index j in the cluster : the index of a center (a), the
+ * distance to it (d) and its energy (e). As a structure of arrays, with 32-bit center indices,
+ * of 20 bytes per sample (12 with FLOAT_NEAREST_INFOS), where an array of (size_t, double,
+ * double) is 24. This replaces a vector per cluster of XNearestInfos. */
+class NearestInfos
+{
+
+  private:
+  ClusterSegmentedVector<uint32_t>  a_x;
+  ClusterSegmentedVector<InfoFloat> d_x;
+  ClusterSegmentedVector<InfoFloat> e_x;
+
+  public:
+  NearestInfos(size_t K) : a_x(K), d_x(K), e_x(K)
+  {
+    if (K > std::numeric_limits<uint32_t>::max())
+    {
+      throw zentas::zentas_error("K > 2^32 - 1, center indices are stored in 32 bits");
+    }
+  }
+
+  size_t size(size_t k) const { return a_x.size(k); }
+
+  size_t get_a(size_t k, size_t j) const { return a_x(k, j); }
+
+  double get_d(size_t k, size_t j) const { return d_x(k, j); }
+
+  double get_e(size_t k, size_t j) const { return e_x(k, j); }
+
+  double get_e_tail(size_t k) const { return e_x.back(k); }
+
+  const InfoFloat* get_d(size_t k) const { return d_x.get(k); }
+
+  void reset(size_t k, size_t j, size_t a, double d, double e)
+  {
+    a_x(k, j) = static_cast<uint32_t>(a);
+    d_x(k, j) = static_cast<InfoFloat>(d);
+    e_x(k, j) = static_cast<InfoFloat>(e);
+  }
+
+  void append(size_t k, size_t a, double d, double e)
+  {
+    a_x.append(k, static_cast<uint32_t>(a));
+    d_x.append(k, static_cast<InfoFloat>(d));
+    e_x.append(k, static_cast<InfoFloat>(e));
+  }
+
+  /* append (k, j) to cluster k_new */
+  void append_from(size_t k_new, size_t k, size_t j)
+  {
+    a_x.append(k_new, a_x(k, j));
+    d_x.append(k_new, d_x(k, j));
+    e_x.append(k_new, e_x(k, j));
+  }
+
+  /* (k1, j1) becomes (k2, j2) */
+  void replace_with(size_t k1, size_t j1, size_t k2, size_t j2)
+  {
+    a_x(k1, j1) = a_x(k2, j2);
+    d_x(k1, j1) = d_x(k2, j2);
+    e_x(k1, j1) = e_x(k2, j2);
+  }
+
+  void replace_with_last(size_t k, size_t j)
+  {
+    a_x.replace_with_last(k, j);
+    d_x.replace_with_last(k, j);
+    e_x.replace_with_last(k, j);
+  }
+
+  void remove_last(size_t k)
+  {
+    a_x.remove_last(k);
+    d_x.remove_last(k);
+    e_x.remove_last(k);
+  }
+
+  void reserve(const std::vector<size_t>& capacities)
+  {
+    a_x.reserve(capacities);
+    d_x.reserve(capacities);
+    e_x.reserve(capacities);
+  }
+
+  size_t get_n_bytes_reallocated() const
+  {
+    return a_x.get_n_bytes_reallocated() + d_x.get_n_bytes_reallocated() +
+           e_x.get_n_bytes_reallocated();
+  }
+
+  void swap_clusters(size_t k1, size_t k2)
+  {
+    a_x.swap_clusters(k1, k2);
+    d_x.swap_clusters(k1, k2);
+    e_x.swap_clusters(k1, k2);
+  }
+
+  void clear()
+  {
+    a_x.clear();
+    d_x.clear();
+    e_x.clear();
+  }
+
+  std::string get_string(size_t k, size_t j) const
+  {
+    return std::to_string(get_a(k, j)) + "\t " + std::to_string(get_d(k, j)) + "\t " +
+           std::to_string(get_e(k, j));
+  }
+};
+
+}  // namespace nszen
+
+#endif
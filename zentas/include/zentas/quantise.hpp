@@ -0,0 +1,95 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#ifndef ZENTAS_QUANTISE_HPP
+#define ZENTAS_QUANTISE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace nszen
+{
+
+/* Reduced precision storage of dense vectors (vzentas with storage "fp16", "bf16" or "int8").
+ * Dimension d of a sample is stored as a code c, and its value is
+ * offsets[d] + scales[d] * widen(c). The offset cancels in differences, so only the scales are
+ * used in the distance kernels, where the codes are widened to float. */
+
+/* ieee half precision : 1 sign bit, 5 exponent bits, 10 mantissa bits */
+struct Float16
+{
+  uint16_t bits;
+};
+
+/* bfloat16 : the top 16 bits of a float */
+struct BFloat16
+{
+  uint16_t bits;
+};
+
+inline float bits_to_float(uint32_t bits)
+{
+  float x;
+  std::memcpy(&x, &bits, sizeof(float));
+  return x;
+}
+
+inline uint32_t float_to_bits(float x)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(float));
+  return bits;
+}
+
+/* The exponent and mantissa are shifted into place, and a multiplication by 2^112 corrects the
+ * exponent bias. This is exact, also for subnormal halves. There are no infinities or nans, as
+ * the codes are in [-1, 1]. The vector kernels in lpkernels.cpp do the same operations. */
+inline float widen(Float16 x)
+{
+  float magnitude = bits_to_float((x.bits & 0x7fffu) << 13) * bits_to_float((127u + 112u) << 23);
+  return bits_to_float(float_to_bits(magnitude) | ((x.bits & 0x8000u) << 16));
+}
+
+inline float widen(BFloat16 x) { return bits_to_float(static_cast<uint32_t>(x.bits) << 16); }
+
+inline float widen(int8_t x) { return static_cast<float>(x); }
+
+/* The per dimension offsets and scales. For int8, the range of dimension d is mapped onto
+ * [-127, 127]. For fp16 and bf16 it is mapped onto [-1, 1], which keeps fp16 well clear of
+ * overflow, and centers the values for better relative precision. */
+struct DenseQuantisation
+{
+  std::vector<float> offsets;
+  std::vector<float> scales;
+};
+
+/* set quantisation and codes (ndata * dimension) from data, rounding to nearest */
+template <typename TAtomic, typename TCode>
+void set_dense_quantisation(size_t               ndata,
+                            size_t               dimension,
+                            const TAtomic* const data,
+                            DenseQuantisation&   quantisation,
+                            std::vector<TCode>&  codes);
+
+/* After clustering with reduced precision storage, the medoids are re-checked with the full
+ * precision data. For each cluster, the members nearest to its medoid are considered as
+ * alternative medoids, and the one with the lowest full precision energy is chosen. The labels
+ * are not changed. A summary is written to out. */
+template <typename TAtomic>
+void reverify_medoids(size_t                               ndata,
+                      size_t                               dimension,
+                      const TAtomic* const                 data,
+                      size_t                               K,
+                      char                                 p,
+                      const std::function<double(double)>& f_energy,
+                      size_t                               nthreads,
+                      const size_t* const                  labels,
+                      size_t* const                        indices_final,
+                      std::ostream&                        out);
+}
+
+#endif
@@ -5,6 +5,7 @@
 #define ZENTAS_SKELETONCLUSTERER_HPP
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
@@ -16,6 +17,7 @@
 #include <vector>
 #include <zentas/energyinit.hpp>
 #include <zentas/initialisation.hpp>
+#include <zentas/nearestinfos.hpp>
 #include <zentas/outputwriter.hpp>
 #include <zentas/tenergyfunc.hpp>
 #include <zentas/zentaserror.hpp>
@@ -30,11 +32,7 @@ enum class RfAlg
   Yinyang  = 1
 };
 
-/* Note on data layout here:
- * The choice to store (a,d,e) contiguously initially
- * for clearer code. However, I have implemented a version
- * with a,d and e stored as separate vectors, and there
- * is no speed-up */
+/* (a,d,e) of a single center (see claransl1). For the samples, see NearestInfos. */
 struct XNearestInfo
 {
   // the assigned center of the data point
@@ -57,7 +55,7 @@ class RefinementData
 
   public:
   virtual ~RefinementData() = default;
-  using XNInfos             = std::vector<std::vector<XNearestInfo>>;
+  using XNInfos             = NearestInfos;
 
   // ALL
   size_t                           K;
@@ -73,7 +71,7 @@ class RefinementData
   size_t                           rf_round;
 
   // EXPONION SPECIFIC
-  std::vector<std::vector<size_t>> v_b;   // second nearest, when set.
+  std::vector<std::vector<uint32_t>> v_b;  // second nearest, when set.
   std::vector<double>              u1_C;  // upper bound on furthest cluster member.
   std::vector<double>              l_gC;  // of size K * rf_n_groups.
 
@@ -82,7 +80,7 @@ class RefinementData
     l_gps;  // lower bounds on distances to groups. size ndata*rf_n_groups. mapped from glt_ID.
   std::vector<size_t>
                                    t_gps;  // times when lower bounds set. size ndata*rf_n_groups.  mapped from glt_ID.
-  std::vector<std::vector<size_t>> glt_ID;
+  std::vector<SampleIDVector>        glt_ID;
 
   void swap(size_t k1, size_t k2);
   virtual void specific_swap(size_t k1, size_t k2)           = 0;
@@ -113,7 +111,6 @@ class RefinementData
 
 class ExponionData : public RefinementData
 {
-  using XNInfos = std::vector<std::vector<XNearestInfo>>;
   virtual void specific_swap(size_t k1, size_t k2) override final;
   virtual void specific_set_n_groups(size_t K, size_t ndata) override final;
   virtual void specific_update_centers() override final;
@@ -151,28 +148,30 @@ class P2Bundle
    * I've also tried with d1 and d2 separate,
    * slower (as d1 and d2 always used together). */
   std::unique_ptr<std::array<double, 2>[]> d12_;
-  std::unique_ptr<size_t[]> k_1_;
-  std::unique_ptr<size_t[]> k_2_;
-  std::unique_ptr<size_t[]> ori_;
+  std::unique_ptr<uint32_t[]> k_1_;
+  std::unique_ptr<uint32_t[]> k_2_;
+  SampleIDVector              ori_;
 
   public:
-  size_t& k_1(size_t i) { return k_1_[i]; }
+  uint32_t& k_1(size_t i) { return k_1_[i]; }
 
-  size_t& k_2(size_t i) { return k_2_[i]; }
+  uint32_t& k_2(size_t i) { return k_2_[i]; }
 
   double& d_1(size_t i) { return std::get<0>(d12_[i]); }
 
   double& d_2(size_t i) { return std::get<1>(d12_[i]); }
 
-  size_t& ori(size_t i) { return ori_[i]; }
+  size_t get_ori(size_t i) const { return ori_[i]; }
+
+  void set_ori(size_t i, size_t ID) { ori_.set(i, ID); }
 
   size_t get_ndata() const { return ndata; }
 
-  void initialise_data(size_t n);
+  void initialise_data(size_t n, bool is_wide);
 
   P2Bundle() = default;
-  P2Bundle(size_t n);
-  P2Bundle(const std::vector<size_t>& ori);
+  P2Bundle(size_t n, bool is_wide);
+  P2Bundle(const SampleIDVector& ori, bool is_wide);
 };
 
 class SkeletonClustererInitBundle
@@ -224,7 +223,7 @@ class SkeletonClusterer
 
   /* TODO certain variables should be private. */
   protected:
-  std::vector<std::vector<size_t>>                            aq2p_original_indices;
+  std::vector<SampleIDVector>                                 aq2p_original_indices;
   std::vector<P2Bundle>                                       aq2p_p2buns;
   zentas::outputwriting::OutputWriter                         mowri;
   const size_t                                                K;
@@ -233,8 +232,10 @@ class SkeletonClusterer
   std::function<double(double)>                               f_energy;
   std::string                                                 initialisation_method;
   size_t*                                                     center_IDs;
-  std::vector<std::vector<XNearestInfo>>                      nearest_1_infos;
-  std::vector<std::vector<size_t>>                            sample_IDs;
+  NearestInfos                                                nearest_1_infos;
+  /* 32 or 64-bit, see is_wide_sample_IDs */
+  const bool                                                  wide_sample_IDs;
+  SegmentedSampleIDs                                          sample_IDs;
   std::vector<std::vector<size_t>>                            to_leave_cluster;
   std::vector<bool>                                           cluster_has_changed;
   std::vector<double>                                         cluster_energies;
@@ -258,6 +259,14 @@ class SkeletonClusterer
   size_t                                                      ncalcs_in_update_sample_info = 0;
   size_t                                                      ncalcs_initialising          = 0;
   size_t                                                      ncalcs_total                 = 0;
+  /* bytes copied when cluster memory is reallocated, see get_n_bytes_reallocated */
+  size_t n_bytes_reallocated_initialising = 0;
+  /* rooted data is reordered by cluster after initialisation and every reorder_interval rounds,
+   * or never if 0. Sample i is then at reordered_positions[i] of the reordered input. */
+  size_t         reorder_interval = 0;
+  SampleIDVector reordered_positions;
+  size_t         n_reorders      = 0;
+  size_t         time_reordering = 0;
   /* passed in through constructor */
   std::chrono::time_point<std::chrono::high_resolution_clock> t_update_centers_start,
     t_update_centers_end, t_update_sample_info_end, t_redistribute_end,
@@ -289,11 +298,23 @@ class SkeletonClusterer
   * ***************** */
   virtual double get_rel_calccosts() = 0;
   virtual size_t get_ncalcs()        = 0;
+  /* if not (dtw), there is no fundamental_triangle_inequality_test */
+  virtual bool satisfies_triangle_inequality() = 0;
+  /* the hit rate of the distance cache, empty if there is no cache */
+  virtual std::string get_distance_cache_string() = 0;
   virtual void set_cc_pp_distance(size_t k1, size_t k2) = 0;
   virtual void
   set_center_sample_pp_distance(size_t k, size_t bin, size_t i, double& adistance) = 0;
   virtual void set_center_sample_distance(
     size_t k, size_t k1, size_t j1, double threshold, double& distance) = 0;
+  /* from center k to elements [j_begin, j_end) of cluster k1. thresholds has j_end - j_begin
+   * elements, or is nullptr for no thresholds. */
+  virtual void set_center_sample_distances(size_t              k,
+                                           size_t              k1,
+                                           size_t              j_begin,
+                                           size_t              j_end,
+                                           const double* const thresholds,
+                                           double* const       distances) = 0;
   virtual void
   set_center_sampleID_distance(size_t k, size_t i, double threshold, double& distance) = 0;
   virtual void
@@ -330,6 +351,17 @@ class SkeletonClusterer
   virtual void kmoo_finish_with()                   = 0;
   virtual void centers_replace_with_sample(size_t k1, size_t k2, size_t j2) = 0;
   virtual void swap_data(size_t k1, size_t k2) = 0;
+  virtual void reserve_cluster_datas(const std::vector<size_t>& capacities) = 0;
+  virtual size_t get_cluster_datas_n_bytes_reallocated() = 0;
+  /* the input becomes samples order[0], order[1], ... of the current input */
+  virtual void reorder_datain(const std::vector<size_t>& order,
+                              const std::vector<size_t>& old_to_new) = 0;
+
+  /* the position in the input of the sample with ID i */
+  size_t get_position(size_t i) const
+  {
+    return reordered_positions.empty() ? i : reordered_positions[i];
+  }
 
   /* general rule : functions with suffix
    * 'basic' will not touch to_leave_cluster */
@@ -370,6 +402,9 @@ class SkeletonClusterer
   void set_center_center_distance_nothreshold(size_t k1, size_t k2, double& adistance);
   void output_halt_kmedoids_reason();
   bool halt_kmedoids();
+  void reserve_clusters(const std::vector<size_t>& capacities);
+  size_t get_n_bytes_reallocated();
+  void   reorder_rooted_data();
 
   void set_t_ncalcs_update_centers_start();
   void update_t_ncalcs_center_end();
@@ -401,6 +436,8 @@ class SkeletonClusterer
   virtual void custom_replace_with_last(size_t, size_t) {}
   virtual void custom_replace_with(size_t, size_t, size_t, size_t) {}
   virtual void custom_remove_last(size_t) {}
+  virtual void custom_reserve(const std::vector<size_t>&) {}
+  virtual size_t get_custom_n_bytes_reallocated() { return 0; }
   virtual void increment_custom_cluster_statistics(size_t, size_t) {}
   virtual void set_normalised_custom_cluster_statistics(size_t k) = 0;
   virtual void set_to_zero_custom_cluster_statistics(size_t k)    = 0;
@@ -449,13 +486,13 @@ class SkeletonClusterer
   /* set energy of cluster k, and set as custom cluster statistics */
   void set_cluster_statistics(size_t k);
 
-  size_t get_a1(size_t k, size_t j) { return nearest_1_infos[k][j].a_x; }
+  size_t get_a1(size_t k, size_t j) { return nearest_1_infos.get_a(k, j); }
 
-  double get_d1(size_t k, size_t j) { return nearest_1_infos[k][j].d_x; }
+  double get_d1(size_t k, size_t j) { return nearest_1_infos.get_d(k, j); }
 
-  double get_e1(size_t k, size_t j) { return nearest_1_infos[k][j].e_x; }
+  double get_e1(size_t k, size_t j) { return nearest_1_infos.get_e(k, j); }
 
-  double get_e1_tail(size_t k) { return nearest_1_infos[k].back().e_x; }
+  double get_e1_tail(size_t k) { return nearest_1_infos.get_e_tail(k); }
 
   double get_E_total() { return E_total; }
 
@@ -614,6 +651,21 @@ class SkeletonClusterer
     (void)distance;
     throw zentas::zentas_error("virtual function set_rf_center_sample_distance not possible");
   }
+  virtual void set_rf_center_sample_distances(size_t              k,
+                                              size_t              k1,
+                                              size_t              j_begin,
+                                              size_t              j_end,
+                                              const double* const thresholds,
+                                              double* const       distances)
+  {
+    (void)k;
+    (void)k1;
+    (void)j_begin;
+    (void)j_end;
+    (void)thresholds;
+    (void)distances;
+    throw zentas::zentas_error("virtual function set_rf_center_sample_distances not possible");
+  }
   virtual void
   set_rf_center_center_distance(size_t k1, size_t k2, double threshold, double& adistance)
   {
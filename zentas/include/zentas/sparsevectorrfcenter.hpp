@@ -4,13 +4,11 @@
 #ifndef ZENTAS_SPARSEVECTORRFCENTER_HPP
 #define ZENTAS_SPARSEVECTORRFCENTER_HPP
 
-#include <unordered_map>
-
-// TODO : currently computing distances involiving SparseVectorRfCenters is slow
-// it can probably be optimised is a hand-crafted data structure is used to store sparse centers
-
-template <typename TAtomic>
-using SparseVectorRfCenter = std::unordered_map<size_t, TAtomic>;
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
 
 template <typename TAtomic>
 struct SparseVectorSample
@@ -19,9 +17,226 @@ struct SparseVectorSample
   size_t               size;
   const TAtomic* const values;
   const size_t* const  indices;
-  SparseVectorSample(size_t sz, const TAtomic* const vals, const size_t* const inds)
-    : size(sz), values(vals), indices(inds)
+  /* cached, for l2 distances via dot products */
+  double sq_norm;
+  SparseVectorSample(size_t               sz,
+                     const TAtomic* const vals,
+                     const size_t* const  inds,
+                     double               sqn)
+    : size(sz), values(vals), indices(inds), sq_norm(sqn)
+  {
+  }
+};
+
+/* A center becomes dense when its number of entries is at least this fraction of its largest
+ * index. For float, sorted storage uses 12 bytes per entry and dense storage 4 bytes per index,
+ * so dense storage is then at most a little larger. */
+constexpr double sparse_rf_center_dense_fraction = 0.25;
+
+/* Buffered additions are not merged in while there are fewer than this many */
+constexpr size_t sparse_rf_center_min_pending = 1024;
+
+/* Refinement centers (and the sums from which they are computed) for sparse vectors. The
+ * entries are either sorted by index (indices[e], values[e]), or dense (values[d] at index d).
+ * Additions to a sorted center are buffered, and merged in once the buffer is as large as the
+ * center, so that adding a sample costs O(nnz of the sample), amortised. Entries which become
+ * exactly zero are dropped when merging, as they were from the unordered_map used previously.
+ *
+ * The accessors for distances (get_n_entries, index_at, get_values, ...) assume that there are
+ * no buffered additions : call consolidate first. */
+template <typename TAtomic>
+class SparseVectorRfCenter
+{
+
+  private:
+  bool                                    dense;
+  std::vector<size_t>                     indices;
+  std::vector<TAtomic>                    values;
+  std::vector<std::pair<size_t, TAtomic>> pending;
+  /* negative when stale */
+  double sq_norm;
+
+  void set_dense()
+  {
+    std::vector<TAtomic> dense_values(indices.back() + 1, 0);
+    for (size_t e = 0; e < indices.size(); ++e)
+    {
+      dense_values[indices[e]] = values[e];
+    }
+    values.swap(dense_values);
+    indices.clear();
+    dense = true;
+  }
+
+  void set_dense_if_full()
+  {
+    if (dense == false && indices.size() > 0 &&
+        static_cast<double>(indices.size()) >=
+          sparse_rf_center_dense_fraction * static_cast<double>(indices.back() + 1))
+    {
+      set_dense();
+    }
+  }
+
+  public:
+  SparseVectorRfCenter() : dense(false), sq_norm(0) {}
+
+  bool is_dense() const { return dense; }
+
+  size_t get_n_entries() const { return values.size(); }
+
+  size_t index_at(size_t e) const { return dense ? e : indices[e]; }
+
+  TAtomic value_at(size_t e) const { return values[e]; }
+
+  const TAtomic* get_values() const { return values.data(); }
+
+  /* only when not dense */
+  const size_t* get_indices() const { return indices.data(); }
+
+  double get_sq_norm() const
+  {
+    if (sq_norm >= 0)
+    {
+      return sq_norm;
+    }
+    double x = 0;
+    for (size_t e = 0; e < values.size(); ++e)
+    {
+      x += static_cast<double>(values[e]) * static_cast<double>(values[e]);
+    }
+    return x;
+  }
+
+  void set_to_zero()
+  {
+    dense = false;
+    indices.clear();
+    values.clear();
+    pending.clear();
+    sq_norm = 0;
+  }
+
+  /* alpha is 1 or -1 */
+  void add_scaled(const SparseVectorSample<TAtomic>& x, TAtomic alpha)
+  {
+    sq_norm = -1;
+    if (dense)
+    {
+      if (x.size > 0 && x.indices[x.size - 1] >= values.size())
+      {
+        values.resize(x.indices[x.size - 1] + 1, 0);
+      }
+      for (size_t d = 0; d < x.size; ++d)
+      {
+        values[x.indices[d]] += alpha * x.values[d];
+      }
+    }
+
+    else
+    {
+      for (size_t d = 0; d < x.size; ++d)
+      {
+        pending.emplace_back(x.indices[d], alpha * x.values[d]);
+      }
+      if (pending.size() > std::max(values.size(), sparse_rf_center_min_pending))
+      {
+        consolidate();
+      }
+    }
+  }
+
+  /* merge the buffered additions in. The additions to an index are summed in the order in
+   * which they were made. */
+  void consolidate()
+  {
+    if (pending.empty())
+    {
+      return;
+    }
+
+    std::stable_sort(pending.begin(),
+                     pending.end(),
+                     [](const std::pair<size_t, TAtomic>& a, const std::pair<size_t, TAtomic>& b) {
+                       return a.first < b.first;
+                     });
+
+    std::vector<size_t>  new_indices;
+    std::vector<TAtomic> new_values;
+    new_indices.reserve(values.size() + pending.size());
+    new_values.reserve(values.size() + pending.size());
+
+    size_t  e = 0;
+    size_t  q = 0;
+    size_t  index;
+    TAtomic value;
+    while (e < values.size() || q < pending.size())
+    {
+      index = (q == pending.size() || (e < values.size() && indices[e] <= pending[q].first))
+                ? indices[e]
+                : pending[q].first;
+      value = 0;
+      if (e < values.size() && indices[e] == index)
+      {
+        value = values[e];
+        ++e;
+      }
+      while (q < pending.size() && pending[q].first == index)
+      {
+        value += pending[q].second;
+        ++q;
+      }
+      if (value != 0)
+      {
+        new_indices.push_back(index);
+        new_values.push_back(value);
+      }
+    }
+
+    indices.swap(new_indices);
+    values.swap(new_values);
+    pending.clear();
+    set_dense_if_full();
+  }
+
+  /* consolidate and scale by alpha, with the squared norm cached */
+  void scale(double alpha)
+  {
+    consolidate();
+    for (size_t e = 0; e < values.size(); ++e)
+    {
+      values[e] *= alpha;
+    }
+    sq_norm = -1;
+    sq_norm = get_sq_norm();
+  }
+
+  void set_as_scaled(const SparseVectorRfCenter& rfc, double alpha)
+  {
+    *this = rfc;
+    scale(alpha);
+  }
+
+  /* to the entries (new_indices, new_values), with new_indices sorted. The vectors are swapped
+   * in, and so are left with the previous entries. */
+  void swap_in_sorted(std::vector<size_t>& new_indices, std::vector<TAtomic>& new_values)
+  {
+    set_to_zero();
+    indices.swap(new_indices);
+    values.swap(new_values);
+    set_dense_if_full();
+    sq_norm = -1;
+    sq_norm = get_sq_norm();
+  }
+
+  double get_sum_abs() const
   {
+    double sum_abs = 0;
+    for (size_t e = 0; e < values.size(); ++e)
+    {
+      sum_abs += std::abs(values[e]);
+    }
+    return sum_abs;
   }
 };
 
@@ -20,13 +20,20 @@ class TData{
     const TDataIn::Sample & at (size_t) const; //by reference optional...
     void remove_last ();
     void replace_with(size_t, const TDataIn::Sample &);
+    void reserve(size_t); // capacity for this many samples
+    size_t get_n_bytes_reallocated() const;
+    typedef ... ClusterStore; // the values of all clusters, owned by the clusterer
+    static ClusterStore get_cluster_store(size_t K, const TDataIn &);
+    void set_cluster_store(ClusterStore &, size_t k); // this is cluster k
 };
 
 */
 
 #include <sstream>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
+#include <zentas/nearestinfos.hpp>
 #include <zentas/sparsevectorrfcenter.hpp>
 #include <zentas/tdatain.hpp>
 #include <zentas/zentaserror.hpp>
@@ -34,89 +41,179 @@ class TData{
 namespace nszen
 {
 
-template <typename TAtomic>
-class SparseRefinementCenterData
+/* The number of bytes which v copies if it grows to size n (0 if n is within its capacity). The
+ * TData classes sum these in n_bytes_reallocated, to measure the cost of samples migrating. */
+template <typename T>
+size_t get_reallocation_bytes(const std::vector<T>& v, size_t n)
+{
+  return n > v.capacity() ? v.size() * sizeof(T) : 0;
+}
+
+/* The values of the samples of all K clusters, width values per sample, in one
+ * ClusterSegmentedVector in which cluster k is segment k. It is owned by the clusterer, and
+ * is the ClusterStore of the TData classes of fixed width samples. */
+template <typename T>
+class ClusterValueStore
 {
 
   public:
-  using RfCenter = SparseVectorRfCenter<TAtomic>;
+  ClusterSegmentedVector<T> values;
+  size_t                    width;
+
+  ClusterValueStore(size_t K, size_t width_) : values(K), width(width_) {}
+
+  /* room for capacities[k] samples in cluster k */
+  void reserve(const std::vector<size_t>& capacities)
+  {
+    std::vector<size_t> value_capacities(capacities);
+    for (auto& x : value_capacities)
+    {
+      x *= width;
+    }
+    values.reserve(value_capacities);
+  }
+
+  void swap_clusters(size_t k1, size_t k2) { values.swap_clusters(k1, k2); }
+
+  size_t get_n_bytes_reallocated() const { return values.get_n_bytes_reallocated(); }
+};
+
+/* The ClusterStore of the TData classes of variable length samples, which keep their values in
+ * arenas of their own. */
+class NoClusterStore
+{
+  public:
+  void reserve(const std::vector<size_t>&) {}
+
+  void swap_clusters(size_t, size_t) {}
+
+  size_t get_n_bytes_reallocated() const { return 0; }
+};
+
+/* The values of a TData of fixed width samples. Those of cluster k are segment k of the
+ * clusterer's store, set with set_store. Those of a TData without a store (the centers, and
+ * the bins of kmeans++) are in a vector of their own. */
+template <typename T>
+class SegmentStorage
+{
 
   private:
-  std::vector<RfCenter> cdata;
+  ClusterSegmentedVector<T>* store = nullptr;
+  size_t                     k     = 0;
+  std::vector<T>             own;
+  size_t                     n_bytes_reallocated = 0;
 
   public:
-  SparseRefinementCenterData(size_t dimension)
+  void set_store(ClusterSegmentedVector<T>& store_, size_t k_)
   {
-    (void)dimension;
-  }  // maybe use dimension to initialise size of maps
+    if (own.empty() == false)
+    {
+      throw zentas::zentas_error("Request for set_store, but the values are not empty");
+    }
+    store = &store_;
+    k     = k_;
+  }
+
+  size_t size() const { return store ? store->size(k) : own.size(); }
+
+  const T* data() const { return store ? store->get(k) : own.data(); }
+
+  T* data() { return store ? store->get(k) : own.data(); }
+
+  T& operator[](size_t i) { return data()[i]; }
+
+  const T& operator[](size_t i) const { return data()[i]; }
 
-  void add(size_t i, const SparseVectorSample<TAtomic>& svs)
+  void append(const T* values, size_t n)
   {
-    for (size_t d = 0; d < svs.size; ++d)
+    if (store)
     {
-      if (cdata[i].count(svs.indices[d]) == 1)
-      {
-        cdata[i][svs.indices[d]] += svs.values[d];
-      }
-      else
-      {
-        cdata[i][svs.indices[d]] = svs.values[d];
-      }
-      if (cdata[i].at(svs.indices[d]) == 0)
-      {
-        cdata[i].erase(svs.indices[d]);
-      }
+      store->append(k, values, n);
+    }
+
+    else
+    {
+      n_bytes_reallocated += get_reallocation_bytes(own, own.size() + n);
+      own.insert(own.end(), values, values + n);
     }
   }
 
-  void subtract(size_t i, const SparseVectorSample<TAtomic>& svs)
+  /* values[0, ..., n - 1], padded with T() to width values */
+  void append(const T* values, size_t n, size_t width)
   {
-    for (size_t d = 0; d < svs.size; ++d)
+    append(values, n);
+    if (store)
     {
-      if (cdata[i].count(svs.indices[d]) == 1)
-      {
-        cdata[i][svs.indices[d]] -= svs.values[d];
-      }
-      else
-      {
-        cdata[i][svs.indices[d]] = -svs.values[d];
-      }
+      store->extend(k, width - n);
+    }
 
-      if (cdata[i].at(svs.indices[d]) == 0)
-      {
-        cdata[i].erase(svs.indices[d]);
-      }
+    else
+    {
+      own.resize(own.size() + width - n);
     }
   }
 
-  void set_to_zero(size_t)
+  void remove_last(size_t n)
   {
-    throw zentas::zentas_error("SparseRefinementCenterData cannot CURRENTLY set to zero");
+    if (store)
+    {
+      store->remove_last(k, n);
+    }
+
+    else
+    {
+      own.resize(own.size() - n);
+    }
   }
 
-  void set_as_scaled(size_t i, const RfCenter& rfc, double alpha)
+  /* the store is reserved by the clusterer, for all clusters at once */
+  void reserve(size_t n)
   {
-    cdata[i] = rfc;
-    for (auto iter = cdata[i].begin(); iter != cdata[i].end(); ++iter)
+    if (store == nullptr)
     {
-      iter->second *= alpha;
+      own.reserve(n);
     }
   }
 
-  const RfCenter& at_for_metric(size_t i) const { return cdata[i]; }
+  /* the bytes copied when the own vector grew (those of the store are counted by the store) */
+  size_t get_n_bytes_reallocated() const { return n_bytes_reallocated; }
+};
 
-  RfCenter* at_for_change(size_t)
+template <typename TAtomic>
+class SparseRefinementCenterData
+{
+
+  public:
+  using RfCenter = SparseVectorRfCenter<TAtomic>;
+
+  private:
+  std::vector<RfCenter> cdata;
+
+  public:
+  SparseRefinementCenterData(size_t dimension) { (void)dimension; }
+
+  void add(size_t i, const SparseVectorSample<TAtomic>& svs) { cdata[i].add_scaled(svs, 1); }
+
+  void subtract(size_t i, const SparseVectorSample<TAtomic>& svs)
   {
-    throw zentas::zentas_error("SparseRefinementCenterData cannot CURRENTLY return at_for_change");
+    cdata[i].add_scaled(svs, -1);
   }
 
-  void append_zero() { cdata.emplace_back(std::unordered_map<size_t, TAtomic>{}); }
+  void set_to_zero(size_t i) { cdata[i].set_to_zero(); }
 
-  void set_zero(size_t)
+  void set_as_scaled(size_t i, const RfCenter& rfc, double alpha)
   {
-    throw zentas::zentas_error("SparseRefinementCenterData cannot CURRENTLY set_zero");
+    cdata[i].set_as_scaled(rfc, alpha);
   }
 
+  const RfCenter& at_for_metric(size_t i) const { return cdata[i]; }
+
+  RfCenter* at_for_change(size_t i) { return &cdata[i]; }
+
+  void append_zero() { cdata.emplace_back(); }
+
+  void set_zero(size_t i) { cdata[i].set_to_zero(); }
+
   void replace_with(size_t j, const RfCenter& t) { cdata[j] = t; }
 
   bool equals(size_t j, const RfCenter& t)
@@ -126,173 +223,809 @@ class SparseRefinementCenterData
     throw zentas::zentas_error("SparseRefinementCenterData cannot CURRENTLY equals");
   }
 
-  std::string string_for_sample(size_t)
+  std::string string_for_sample(size_t)
+  {
+    throw zentas::zentas_error("SparseRefinementCenterData cannot CURRENTLY string_for_sample");
+  }
+
+  void set_sum_abs(size_t i, double& sum_abs) { sum_abs = cdata[i].get_sum_abs(); }
+};
+
+template <typename TAtomic>
+class VCenterData
+{
+
+  public:
+  size_t               ndata;
+  size_t               dimension;
+  std::vector<TAtomic> data;
+
+  VCenterData(size_t dimension_) : ndata(0), dimension(dimension_) {}
+
+  void add(size_t i, const TAtomic* const datapoint)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      data[i * dimension + d] += *(datapoint + d);
+    }
+  }
+
+  void subtract(size_t i, const TAtomic* const datapoint)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      data[i * dimension + d] -= *(datapoint + d);
+    }
+  }
+
+  void set_to_zero(size_t i)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      data[i * dimension + d] = 0;
+    }
+  }
+
+  void set_as_scaled(size_t i, const TAtomic* const datapoint, double alpha)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      data[i * dimension + d] = *(datapoint + d) * static_cast<TAtomic>(alpha);
+    }
+  }
+
+  void append_zero()
+  {
+    data.resize((ndata + 1) * dimension, 0);
+    ++ndata;
+  }
+
+  void set_zero(size_t i)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      data[i * dimension + d] = 0;
+    }
+  }
+
+  std::string string_for_sample(size_t i)
+  {
+    std::stringstream ss;
+    ss << "(";
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      ss << " " << data[i * dimension + d] << " ";
+    }
+    ss << ")";
+    return ss.str();
+  }
+  //
+  const TAtomic* at_for_metric(size_t j) const { return data.data() + j * dimension; }
+  //
+  TAtomic* at_for_change(size_t j) { return data.data() + j * dimension; }
+
+  void replace_with(size_t j, const TAtomic* const datapoint)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      data[j * dimension + d] = *(datapoint + d);
+    }
+  }
+
+  bool equals(size_t i, const TAtomic* const datapoint) const
+  {
+    double abs_sum = 0.;
+    double sum_abs = 0.;
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      abs_sum += std::abs(data[i * dimension + d] - *(datapoint + d));
+      sum_abs += std::abs(data[i * dimension + d]) + std::abs(*(datapoint + d));
+    }
+
+    double relative_change = (abs_sum / sum_abs);
+    return relative_change < 1e-7;
+  }
+
+  void set_sum_abs(size_t i, double& sum_abs)
+  {
+    sum_abs = 0;
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      sum_abs += std::abs(data[i * dimension + d]);
+    }
+  }
+};
+
+/* VCenterData with cached squared norms, for metric "l2c". The sums in rf_sum_data
+ * are never used in distance calculations, so add and subtract do not update the norm (which
+ * would double their cost), they only mark it as stale. set_as_scaled, which sets the
+ * refinement centers, recomputes it. */
+template <typename TAtomic>
+class NormedVCenterData
+{
+
+  public:
+  using Sample = NormedDenseSample<TAtomic>;
+
+  private:
+  VCenterData<TAtomic> vcenters;
+  /* negative if stale */
+  std::vector<double> sq_norms;
+
+  public:
+  NormedVCenterData(size_t dimension) : vcenters(dimension) {}
+
+  void add(size_t i, const Sample& datapoint)
+  {
+    vcenters.add(i, datapoint.values);
+    sq_norms[i] = -1.;
+  }
+
+  void subtract(size_t i, const Sample& datapoint)
+  {
+    vcenters.subtract(i, datapoint.values);
+    sq_norms[i] = -1.;
+  }
+
+  void set_to_zero(size_t i)
+  {
+    vcenters.set_to_zero(i);
+    sq_norms[i] = 0;
+  }
+
+  void set_as_scaled(size_t i, const Sample& datapoint, double alpha)
+  {
+    vcenters.set_as_scaled(i, datapoint.values, alpha);
+    sq_norms[i] = get_sq_norm(vcenters.at_for_metric(i), vcenters.dimension);
+  }
+
+  void append_zero()
+  {
+    vcenters.append_zero();
+    sq_norms.push_back(0);
+  }
+
+  void set_zero(size_t i)
+  {
+    vcenters.set_zero(i);
+    sq_norms[i] = 0;
+  }
+
+  std::string string_for_sample(size_t i) { return vcenters.string_for_sample(i); }
+
+  Sample at_for_metric(size_t j) const
+  {
+    const TAtomic* values = vcenters.at_for_metric(j);
+    return {values, sq_norms[j] < 0 ? get_sq_norm(values, vcenters.dimension) : sq_norms[j]};
+  }
+
+  /* only used to set centers with a FMinimiser, which is never the case for l2. */
+  TAtomic* at_for_change(size_t)
+  {
+    throw zentas::zentas_error("NormedVCenterData cannot CURRENTLY return at_for_change");
+  }
+
+  void replace_with(size_t j, const Sample& datapoint)
+  {
+    vcenters.replace_with(j, datapoint.values);
+    sq_norms[j] = datapoint.sq_norm;
+  }
+
+  bool equals(size_t i, const Sample& datapoint) const
+  {
+    return vcenters.equals(i, datapoint.values);
+  }
+
+  void set_sum_abs(size_t i, double& sum_abs) { vcenters.set_sum_abs(i, sum_abs); }
+};
+
+/* Refinement (k-means) is not supported with reduced precision storage, the centers would
+ * need to be in full precision. */
+template <typename TCode>
+class QuantisedRefinementCenterData
+{
+
+  public:
+  using Sample = QuantisedDenseSample<TCode>;
+
+  private:
+  static zentas::zentas_error no_refinement_error()
+  {
+    return zentas::zentas_error(
+      "refinement is not possible with reduced precision storage (fp16, bf16, int8)");
+  }
+
+  public:
+  QuantisedRefinementCenterData(size_t dimension) { (void)dimension; }
+
+  void add(size_t, const Sample&) { throw no_refinement_error(); }
+
+  void subtract(size_t, const Sample&) { throw no_refinement_error(); }
+
+  void set_to_zero(size_t) { throw no_refinement_error(); }
+
+  void set_as_scaled(size_t, const Sample&, double) { throw no_refinement_error(); }
+
+  void append_zero() { throw no_refinement_error(); }
+
+  void set_zero(size_t) { throw no_refinement_error(); }
+
+  std::string string_for_sample(size_t) { throw no_refinement_error(); }
+
+  Sample at_for_metric(size_t) const { throw no_refinement_error(); }
+
+  TCode* at_for_change(size_t) { throw no_refinement_error(); }
+
+  void replace_with(size_t, const Sample&) { throw no_refinement_error(); }
+
+  bool equals(size_t, const Sample&) const { throw no_refinement_error(); }
+
+  void set_sum_abs(size_t, double&) { throw no_refinement_error(); }
+};
+
+template <typename TDataIn>
+class VData
+{
+
+  // does this imply default move constructor copy constructor are generated?
+  public:
+  VData() = default;
+
+  public:
+  using AtomicType           = typename TDataIn::AtomicType;
+  using RefinementCenterData = VCenterData<AtomicType>;
+  using ClusterStore         = ClusterValueStore<AtomicType>;
+
+  public:
+  typedef TDataIn DataIn;
+
+  // how to make sure that the returned pointer is not used after this object is deleted?
+  // ConstLengthInitBundle self_as_tdatain;
+  ConstLengthInitBundle<AtomicType> get_as_datain_ib() { return {ndata, dimension, data.data()}; }
+
+  private:
+  size_t                     ndata;
+  size_t                     dimension;
+  SegmentStorage<AtomicType> data;
+
+  public:
+  VData(const DataIn& datain, bool as_empty) : ndata(0), dimension(datain.dimension)
+  {
+    if (as_empty == false)
+    {
+      throw zentas::zentas_error("Currently, there is no implementation for constructing VData "
+                                 "from DenseVectorDataUnrootedIn with data, due to the lack of "
+                                 "any apparent need");
+    }
+  }
+
+  static ClusterStore get_cluster_store(size_t K, const DataIn& datain)
+  {
+    return {K, datain.dimension};
+  }
+
+  void set_cluster_store(ClusterStore& store, size_t k) { data.set_store(store.values, k); }
+
+  size_t get_ndata() const { return ndata; }
+
+  void append(const AtomicType* const datapoint)
+  {
+    ndata += 1;
+    data.append(datapoint, dimension);
+  }
+
+  void reserve(size_t n) { data.reserve(n * dimension); }
+
+  size_t get_n_bytes_reallocated() const { return data.get_n_bytes_reallocated(); }
+
+  //
+  const AtomicType* at_for_metric(size_t j) const { return data.data() + j * dimension; }
+  //
+  const AtomicType* at_for_move(size_t j) const { return data.data() + j * dimension; }
+
+  void remove_last()
+  {
+    if (ndata == 0)
+    {
+      throw zentas::zentas_error("Request for remove_last, but ndata == 0");
+    }
+    ndata -= 1;
+    data.remove_last(dimension);
+  }
+
+  void replace_with(size_t j, const AtomicType* const datapoint)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      data[j * dimension + d] = *(datapoint + d);
+    }
+  }
+
+  std::string string_for_sample(size_t i)
+  {
+    std::stringstream ss;
+    ss << "(";
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      ss << " " << data[i * dimension + d] << " ";
+    }
+    ss << ")";
+    return ss.str();
+  }
+
+  std::string get_string()
+  {
+    std::stringstream ss;
+    for (size_t i = 0; i < ndata; ++i)
+    {
+      ss << string_for_sample(i);
+    }
+
+    return ss.str();
+  }
+};
+
+/* VData with cached squared norms, for metric "l2c". TDataIn is a
+ * NormedDenseVectorDataUnrootedIn. */
+template <typename TDataIn>
+class NormedVData
+{
+
+  public:
+  NormedVData() = default;
+
+  public:
+  using AtomicType           = typename TDataIn::AtomicType;
+  using Sample               = typename TDataIn::Sample;
+  using RefinementCenterData = NormedVCenterData<AtomicType>;
+  typedef TDataIn DataIn;
+
+  /* the values, and the squared norms, of all clusters */
+  class ClusterStore
+  {
+    public:
+    typename VData<TDataIn>::ClusterStore values;
+    ClusterValueStore<double>             sq_norms;
+
+    void reserve(const std::vector<size_t>& capacities)
+    {
+      values.reserve(capacities);
+      sq_norms.reserve(capacities);
+    }
+
+    void swap_clusters(size_t k1, size_t k2)
+    {
+      values.swap_clusters(k1, k2);
+      sq_norms.swap_clusters(k1, k2);
+    }
+
+    size_t get_n_bytes_reallocated() const
+    {
+      return values.get_n_bytes_reallocated() + sq_norms.get_n_bytes_reallocated();
+    }
+  };
+
+  ConstLengthInitBundle<AtomicType> get_as_datain_ib() { return vdata.get_as_datain_ib(); }
+
+  private:
+  VData<TDataIn>         vdata;
+  SegmentStorage<double> sq_norms;
+
+  public:
+  NormedVData(const DataIn& datain, bool as_empty) : vdata(datain, as_empty) {}
+
+  static ClusterStore get_cluster_store(size_t K, const DataIn& datain)
+  {
+    return {VData<TDataIn>::get_cluster_store(K, datain), {K, 1}};
+  }
+
+  void set_cluster_store(ClusterStore& store, size_t k)
+  {
+    vdata.set_cluster_store(store.values, k);
+    sq_norms.set_store(store.sq_norms.values, k);
+  }
+
+  size_t get_ndata() const { return vdata.get_ndata(); }
+
+  void append(const Sample& s)
+  {
+    vdata.append(s.values);
+    sq_norms.append(&s.sq_norm, 1);
+  }
+
+  void reserve(size_t n)
+  {
+    vdata.reserve(n);
+    sq_norms.reserve(n);
+  }
+
+  size_t get_n_bytes_reallocated() const
+  {
+    return vdata.get_n_bytes_reallocated() + sq_norms.get_n_bytes_reallocated();
+  }
+
+  Sample at_for_metric(size_t j) const { return {vdata.at_for_metric(j), sq_norms[j]}; }
+
+  Sample at_for_move(size_t j) const { return {vdata.at_for_move(j), sq_norms[j]}; }
+
+  void remove_last()
+  {
+    vdata.remove_last();
+    sq_norms.remove_last(1);
+  }
+
+  void replace_with(size_t j, const Sample& s)
+  {
+    vdata.replace_with(j, s.values);
+    sq_norms[j] = s.sq_norm;
+  }
+
+  std::string string_for_sample(size_t i) { return vdata.string_for_sample(i); }
+
+  std::string get_string() { return vdata.get_string(); }
+};
+
+/* VData with reduced precision storage : each cluster holds the codes of its samples, which
+ * are 2 (fp16, bf16) or 4 (int8) times smaller than floats. TDataIn is a
+ * QuantisedDenseVectorDataUnrootedIn, which owns the quantisation. */
+template <typename TDataIn>
+class QuantisedVData
+{
+
+  public:
+  QuantisedVData() = default;
+
+  public:
+  using AtomicType           = typename TDataIn::AtomicType;
+  using CodeType             = typename TDataIn::CodeType;
+  using Sample               = typename TDataIn::Sample;
+  using RefinementCenterData = QuantisedRefinementCenterData<CodeType>;
+  using ClusterStore         = ClusterValueStore<CodeType>;
+  typedef TDataIn DataIn;
+
+  QuantisedInitBundle<CodeType> get_as_datain_ib()
+  {
+    return {ndata, dimension, codes.data(), *quantisation};
+  }
+
+  private:
+  size_t                   ndata;
+  size_t                   dimension;
+  SegmentStorage<CodeType> codes;
+  const DenseQuantisation* quantisation;
+
+  public:
+  QuantisedVData(const DataIn& datain, bool as_empty)
+    : ndata(0), dimension(datain.dimension), quantisation(&datain.quantisation)
+  {
+    if (as_empty == false)
+    {
+      throw zentas::zentas_error("Currently, there is no implementation for constructing "
+                                 "QuantisedVData with data, due to the lack of any apparent need");
+    }
+  }
+
+  static ClusterStore get_cluster_store(size_t K, const DataIn& datain)
+  {
+    return {K, datain.dimension};
+  }
+
+  void set_cluster_store(ClusterStore& store, size_t k) { codes.set_store(store.values, k); }
+
+  size_t get_ndata() const { return ndata; }
+
+  void append(const Sample& s)
+  {
+    ndata += 1;
+    codes.append(s.codes, dimension);
+  }
+
+  void reserve(size_t n) { codes.reserve(n * dimension); }
+
+  size_t get_n_bytes_reallocated() const { return codes.get_n_bytes_reallocated(); }
+
+  Sample at_for_metric(size_t j) const
+  {
+    return {codes.data() + j * dimension, quantisation->scales.data()};
+  }
+
+  Sample at_for_move(size_t j) const { return at_for_metric(j); }
+
+  void remove_last()
+  {
+    if (ndata == 0)
+    {
+      throw zentas::zentas_error("Request for remove_last, but ndata == 0");
+    }
+    ndata -= 1;
+    codes.remove_last(dimension);
+  }
+
+  void replace_with(size_t j, const Sample& s)
+  {
+    std::copy(s.codes, s.codes + dimension, codes.data() + j * dimension);
+  }
+
+  std::string string_for_sample(size_t i)
+  {
+    std::stringstream ss;
+    ss << "(";
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      ss << " "
+         << quantisation->offsets[d] + quantisation->scales[d] * widen(codes[i * dimension + d])
+         << " ";
+    }
+    ss << ")";
+    return ss.str();
+  }
+
+  std::string get_string()
+  {
+    std::stringstream ss;
+    for (size_t i = 0; i < ndata; ++i)
+    {
+      ss << string_for_sample(i);
+    }
+
+    return ss.str();
+  }
+};
+
+/* Samples of variable length, for the unrooted data of a cluster. The samples are in slots of
+ * one arena, in the order in which they were placed, and offsets is the table of where the
+ * slots start. A sample which does not fit in its slot is placed in a new slot at the end of
+ * the arena (a bump). A slot at the end of the arena is released on remove_last. When under
+ * half of the arena is samples, it is compacted. So there is no padding to the longest sample
+ * (and the samples of a cluster are close), at an amortised O(1) cost per value moved. */
+template <typename T>
+class VariableLengthArena
+{
+
+  private:
+  std::vector<T>      data;
+  std::vector<size_t> offsets;
+  std::vector<size_t> sizes;
+  std::vector<size_t> capacities;
+  /* the sum of sizes */
+  size_t n_values            = 0;
+  size_t n_bytes_reallocated = 0;
+
+  void compact_if_sparse()
+  {
+    if (data.size() > 2 * n_values)
+    {
+      n_bytes_reallocated += n_values * sizeof(T);
+      std::vector<T> compacted;
+      compacted.reserve(n_values);
+      for (size_t j = 0; j < offsets.size(); ++j)
+      {
+        compacted.insert(compacted.end(), get(j), get(j) + sizes[j]);
+        offsets[j]    = compacted.size() - sizes[j];
+        capacities[j] = sizes[j];
+      }
+      data.swap(compacted);
+    }
+  }
+
+  public:
+  const T* get(size_t j) const { return data.data() + offsets[j]; }
+
+  size_t get_size(size_t j) const { return sizes[j]; }
+
+  size_t get_n_bytes_reallocated() const { return n_bytes_reallocated; }
+
+  /* room for n_slots slots (in the offsets table, the values grow geometrically) */
+  void reserve(size_t n_slots)
+  {
+    offsets.reserve(n_slots);
+    sizes.reserve(n_slots);
+    capacities.reserve(n_slots);
+  }
+
+  /* values may be of this arena */
+  void append(const T* values, size_t size)
+  {
+    n_bytes_reallocated += get_reallocation_bytes(offsets, offsets.size() + 1) * 3;
+    offsets.push_back(data.size());
+    n_bytes_reallocated += get_reallocation_bytes(data, data.size() + size);
+    data.insert(data.end(), values, values + size);
+    sizes.push_back(size);
+    capacities.push_back(size);
+    n_values += size;
+  }
+
+  /* values may be of this arena, but not of slot j unless they are all of slot j */
+  void replace_with(size_t j, const T* values, size_t size)
   {
-    throw zentas::zentas_error("SparseRefinementCenterData cannot CURRENTLY string_for_sample");
+    n_values += size;
+    n_values -= sizes[j];
+    if (size <= capacities[j])
+    {
+      if (values != get(j))
+      {
+        std::copy(values, values + size, data.begin() + offsets[j]);
+      }
+    }
+    else
+    {
+      offsets[j] = data.size();
+      n_bytes_reallocated += get_reallocation_bytes(data, data.size() + size);
+      data.insert(data.end(), values, values + size);
+      capacities[j] = size;
+    }
+    sizes[j] = size;
+    compact_if_sparse();
   }
 
-  void set_sum_abs(size_t i, double& sum_abs)
+  void remove_last()
   {
-    sum_abs = 0;
-    for (auto iter = cdata[i].cbegin(); iter != cdata[i].cend(); ++iter)
+    n_values -= sizes.back();
+    if (offsets.back() + capacities.back() == data.size())
     {
-      sum_abs += std::abs(iter->second);
+      data.resize(offsets.back());
     }
+    offsets.pop_back();
+    sizes.pop_back();
+    capacities.pop_back();
+    compact_if_sparse();
   }
 };
 
-template <typename TAtomic>
-class VCenterData
+/* The StringProfiles of the samples of an SData (or PackedSData), laid out as those of the
+ * DataIn. If the DataIn has no profiles, nothing is stored. */
+class StringProfiles
 {
 
+  private:
+  bool                          is_active = false;
+  bool                          is_dense  = false;
+  VariableLengthArena<uint16_t> profile_keys;
+  VariableLengthArena<uint16_t> profile_counts;
+  std::vector<uint16_t>         profile_n_symbols;
+  size_t                        n_bytes_reallocated = 0;
+
   public:
-  size_t               ndata;
-  size_t               dimension;
-  std::vector<TAtomic> data;
+  StringProfiles() = default;
 
-  VCenterData(size_t dimension_) : ndata(0), dimension(dimension_) {}
+  StringProfiles(bool is_active_, bool is_dense_) : is_active(is_active_), is_dense(is_dense_) {}
 
-  void add(size_t i, const TAtomic* const datapoint)
+  void append(const StringProfile& profile)
   {
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_active == false)
     {
-      data[i * dimension + d] += *(datapoint + d);
+      return;
     }
-  }
-
-  void subtract(size_t i, const TAtomic* const datapoint)
-  {
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_dense == false)
     {
-      data[i * dimension + d] -= *(datapoint + d);
+      profile_keys.append(profile.keys, profile.n_keys);
     }
+    profile_counts.append(profile.counts, profile.n_keys);
+    n_bytes_reallocated +=
+      get_reallocation_bytes(profile_n_symbols, profile_n_symbols.size() + 1);
+    profile_n_symbols.push_back(static_cast<uint16_t>(profile.n_symbols));
   }
 
-  void set_to_zero(size_t i)
+  void reserve(size_t n)
   {
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_active == false)
     {
-      data[i * dimension + d] = 0;
+      return;
     }
-  }
-
-  void set_as_scaled(size_t i, const TAtomic* const datapoint, double alpha)
-  {
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_dense == false)
     {
-      data[i * dimension + d] = *(datapoint + d) * static_cast<TAtomic>(alpha);
+      profile_keys.reserve(n);
     }
+    profile_counts.reserve(n);
+    profile_n_symbols.reserve(n);
   }
 
-  void append_zero()
+  size_t get_n_bytes_reallocated() const
   {
-    data.resize((ndata + 1) * dimension, 0);
-    ++ndata;
+    return profile_keys.get_n_bytes_reallocated() + profile_counts.get_n_bytes_reallocated() +
+           n_bytes_reallocated;
   }
 
-  void set_zero(size_t i)
+  void replace_with(size_t j, const StringProfile& profile)
   {
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_active == false)
     {
-      data[i * dimension + d] = 0;
+      return;
     }
-  }
-
-  std::string string_for_sample(size_t i)
-  {
-    std::stringstream ss;
-    ss << "(";
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_dense == false)
     {
-      ss << " " << data[i * dimension + d] << " ";
+      profile_keys.replace_with(j, profile.keys, profile.n_keys);
     }
-    ss << ")";
-    return ss.str();
+    profile_counts.replace_with(j, profile.counts, profile.n_keys);
+    profile_n_symbols[j] = static_cast<uint16_t>(profile.n_symbols);
   }
-  //
-  const TAtomic* at_for_metric(size_t j) const { return data.data() + j * dimension; }
-  //
-  TAtomic* at_for_change(size_t j) { return data.data() + j * dimension; }
 
-  void replace_with(size_t j, const TAtomic* const datapoint)
+  StringProfile get(size_t j) const
   {
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_active == false)
     {
-      data[j * dimension + d] = *(datapoint + d);
+      return StringProfile();
     }
+    return StringProfile(profile_n_symbols[j],
+                         profile_counts.get_size(j),
+                         is_dense ? nullptr : profile_keys.get(j),
+                         profile_counts.get(j));
   }
 
-  bool equals(size_t i, const TAtomic* const datapoint) const
+  void remove_last()
   {
-    double abs_sum = 0.;
-    double sum_abs = 0.;
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_active == false)
     {
-      abs_sum += std::abs(data[i * dimension + d] - *(datapoint + d));
-      sum_abs += std::abs(data[i * dimension + d]) + std::abs(*(datapoint + d));
+      return;
     }
-
-    double relative_change = (abs_sum / sum_abs);
-    return relative_change < 1e-7;
-  }
-
-  void set_sum_abs(size_t i, double& sum_abs)
-  {
-    sum_abs = 0;
-    for (size_t d = 0; d < dimension; ++d)
+    if (is_dense == false)
     {
-      sum_abs += std::abs(data[i * dimension + d]);
+      profile_keys.remove_last();
     }
+    profile_counts.remove_last();
+    profile_n_symbols.pop_back();
   }
 };
 
-template <typename TDataIn>
-class VData
+template <typename TSDataIn>
+class SData
 {
 
-  // does this imply default move constructor copy constructor are generated?
-  public:
-  VData() = default;
-
   public:
-  using AtomicType           = typename TDataIn::AtomicType;
-  using RefinementCenterData = VCenterData<AtomicType>;
+  SData() = default;
 
   public:
-  typedef TDataIn DataIn;
-
-  // how to make sure that the returned pointer is not used after this object is deleted?
-  // ConstLengthInitBundle self_as_tdatain;
-  ConstLengthInitBundle<AtomicType> get_as_datain_ib() { return {ndata, dimension, data.data()}; }
+  using Sample       = typename TSDataIn::Sample;
+  using AtomicType   = typename TSDataIn::AtomicType;
+  using ClusterStore = NoClusterStore;
+  typedef TSDataIn DataIn;
 
   private:
-  size_t                  ndata;
-  size_t                  dimension;
-  std::vector<AtomicType> data;
+  size_t                          ndata;
+  VariableLengthArena<AtomicType> values;
+  StringProfiles                  profiles;
 
   public:
-  VData(const DataIn& datain, bool as_empty) : ndata(0), dimension(datain.dimension)
+  SData(const DataIn& datain, bool as_empty)
+    : ndata(0), profiles(datain.has_profiles(), datain.has_dense_profiles())
   {
     if (as_empty == false)
     {
-      throw zentas::zentas_error("Currently, there is no implementation for constructing VData "
-                                 "from DenseVectorDataUnrootedIn with data, due to the lack of "
-                                 "any apparent need");
+      throw zentas::zentas_error("Currently, there is no implementation for constructing SData "
+                                 "from SDataIn with data, due to the lack of any apparent need");
     }
   }
 
+  static ClusterStore get_cluster_store(size_t, const DataIn&) { return {}; }
+
+  void set_cluster_store(ClusterStore&, size_t) {}
+
   size_t get_ndata() const { return ndata; }
 
-  void append(const AtomicType* const datapoint)
+  void append(const Sample& s)
   {
     ndata += 1;
-    data.insert(data.end(), datapoint, datapoint + dimension);
+    values.append(s.values, s.size);
+    profiles.append(s.profile);
   }
 
-  //
-  const AtomicType* at_for_metric(size_t j) const { return data.data() + j * dimension; }
-  //
-  const AtomicType* at_for_move(size_t j) const { return data.data() + j * dimension; }
+  void reserve(size_t n)
+  {
+    values.reserve(n);
+    profiles.reserve(n);
+  }
+
+  size_t get_n_bytes_reallocated() const
+  {
+    return values.get_n_bytes_reallocated() + profiles.get_n_bytes_reallocated();
+  }
+
+  const Sample at_for_metric(size_t j) const
+  {
+    return Sample(values.get_size(j), values.get(j), profiles.get(j));
+  }
+
+  const Sample at_for_move(size_t j) const { return at_for_metric(j); }
 
   void remove_last()
   {
@@ -301,89 +1034,113 @@ class VData
       throw zentas::zentas_error("Request for remove_last, but ndata == 0");
     }
     ndata -= 1;
-    data.resize(ndata * dimension);
+    values.remove_last();
+    profiles.remove_last();
   }
 
-  void replace_with(size_t j, const AtomicType* const datapoint)
+  void replace_with(size_t j, const Sample& s)
   {
-    for (size_t d = 0; d < dimension; ++d)
-    {
-      data[j * dimension + d] = *(datapoint + d);
-    }
+    values.replace_with(j, s.values, s.size);
+    profiles.replace_with(j, s.profile);
   }
 
   std::string string_for_sample(size_t i)
   {
     std::stringstream ss;
-    ss << "(";
-    for (size_t d = 0; d < dimension; ++d)
+
+    ss << "{";
+    for (size_t d = 0; d < values.get_size(i); ++d)
     {
-      ss << " " << data[i * dimension + d] << " ";
+      /* the values of time series are separated, the characters of strings are not */
+      ss << (d > 0 && std::is_floating_point<AtomicType>::value ? " " : "") << values.get(i)[d];
     }
-    ss << ")";
+    ss << "}";
     return ss.str();
   }
 
   std::string get_string()
   {
     std::stringstream ss;
-    for (size_t i = 0; i < ndata; ++i)
+    for (size_t j = 0; j < ndata; ++j)
     {
-      ss << string_for_sample(i);
+      ss << string_for_sample(j) << " ";
     }
-
     return ss.str();
   }
 };
 
+/* SData for packed sequences (TSDataIn is a PackedStringDataUnrootedIn) */
 template <typename TSDataIn>
-class SData
+class PackedSData
 {
 
   public:
-  SData() = default;
+  PackedSData() = default;
 
   public:
-  using Sample     = typename TSDataIn::Sample;
-  using AtomicType = typename TSDataIn::AtomicType;
+  using Sample       = typename TSDataIn::Sample;
+  using AtomicType   = typename TSDataIn::AtomicType;
+  using ClusterStore = NoClusterStore;
   typedef TSDataIn DataIn;
 
   private:
-  size_t                  ndata;
-  size_t                  dimension;
-  std::vector<AtomicType> data;
-  std::vector<size_t>     sizes;
+  size_t                        ndata;
+  size_t                        field_width;
+  const AtomicType*             symbols;
+  VariableLengthArena<uint64_t> words;
+  std::vector<size_t>           sizes;
+  StringProfiles                profiles;
+  size_t                        n_bytes_reallocated = 0;
 
   public:
-  SData(const DataIn& datain, bool as_empty) : ndata(0), dimension(datain.get_max_size())
+  PackedSData(const DataIn& datain, bool as_empty)
+    : ndata(0),
+      field_width(datain.get_field_width()),
+      symbols(datain.get_symbols()),
+      profiles(datain.has_profiles(), datain.has_dense_profiles())
   {
     if (as_empty == false)
     {
-      throw zentas::zentas_error("Currently, there is no implementation for constructing SData "
-                                 "from SDataIn with data, due to the lack of any apparent need");
+      throw zentas::zentas_error("Currently, there is no implementation for constructing "
+                                 "PackedSData with data, due to the lack of any apparent need");
     }
   }
 
+  static ClusterStore get_cluster_store(size_t, const DataIn&) { return {}; }
+
+  void set_cluster_store(ClusterStore&, size_t) {}
+
   size_t get_ndata() const { return ndata; }
 
   void append(const Sample& s)
   {
     ndata += 1;
-    data.insert(data.end(), s.values, s.values + s.size);
-    data.resize(ndata * dimension);
+    words.append(s.words, s.get_n_words());
+    n_bytes_reallocated += get_reallocation_bytes(sizes, sizes.size() + 1);
     sizes.push_back(s.size);
+    profiles.append(s.profile);
   }
 
-  const Sample at_for_metric(size_t j) const
+  void reserve(size_t n)
+  {
+    words.reserve(n);
+    sizes.reserve(n);
+    profiles.reserve(n);
+  }
+
+  size_t get_n_bytes_reallocated() const
   {
-    return Sample(sizes[j], data.data() + j * dimension);
+    return words.get_n_bytes_reallocated() + profiles.get_n_bytes_reallocated() +
+           n_bytes_reallocated;
   }
 
-  const Sample at_for_move(size_t j) const
+  const Sample at_for_metric(size_t j) const
   {
-    return Sample(sizes[j], data.data() + j * dimension);
+    return Sample(sizes[j], words.get(j), field_width, symbols, profiles.get(j));
   }
 
+  const Sample at_for_move(size_t j) const { return at_for_metric(j); }
+
   void remove_last()
   {
     if (ndata == 0)
@@ -391,31 +1148,19 @@ class SData
       throw zentas::zentas_error("Request for remove_last, but ndata == 0");
     }
     ndata -= 1;
-    data.resize(ndata * dimension);
-    sizes.resize(ndata);
+    words.remove_last();
+    sizes.pop_back();
+    profiles.remove_last();
   }
 
   void replace_with(size_t j, const Sample& s)
   {
-    for (size_t d = 0; d < s.size; ++d)
-    {
-      data[j * dimension + d] = *(s.values + d);
-    }
+    words.replace_with(j, s.words, s.get_n_words());
     sizes[j] = s.size;
+    profiles.replace_with(j, s.profile);
   }
 
-  std::string string_for_sample(size_t i)
-  {
-    std::stringstream ss;
-
-    ss << "{";
-    for (size_t d = 0; d < sizes[i]; ++d)
-    {
-      ss << data[i * dimension + d];
-    }
-    ss << "}";
-    return ss.str();
-  }
+  std::string string_for_sample(size_t i) { return "{" + at_for_metric(i).str() + "}"; }
 
   std::string get_string()
   {
@@ -440,6 +1185,38 @@ class SparseVectorData
   using DataIn               = TSDataIn;
   using RefinementCenterData = SparseRefinementCenterData<AtomicType>;
 
+  /* the values, indices, sizes and squared norms of all clusters */
+  class ClusterStore
+  {
+    public:
+    ClusterValueStore<AtomicType> data;
+    ClusterValueStore<size_t>     indices_s;
+    ClusterValueStore<size_t>     sizes;
+    ClusterValueStore<double>     sq_norms;
+
+    void reserve(const std::vector<size_t>& capacities)
+    {
+      data.reserve(capacities);
+      indices_s.reserve(capacities);
+      sizes.reserve(capacities);
+      sq_norms.reserve(capacities);
+    }
+
+    void swap_clusters(size_t k1, size_t k2)
+    {
+      data.swap_clusters(k1, k2);
+      indices_s.swap_clusters(k1, k2);
+      sizes.swap_clusters(k1, k2);
+      sq_norms.swap_clusters(k1, k2);
+    }
+
+    size_t get_n_bytes_reallocated() const
+    {
+      return data.get_n_bytes_reallocated() + indices_s.get_n_bytes_reallocated() +
+             sizes.get_n_bytes_reallocated() + sq_norms.get_n_bytes_reallocated();
+    }
+  };
+
   // how to make sure that the returned pointer is not used after this object is deleted?
   SparseVectorDataInitBundle<AtomicType> get_as_datain_ib()
   {
@@ -450,9 +1227,10 @@ class SparseVectorData
   size_t ndata;
   size_t dimension;  // note that this dimension is the max non-sparsity, NOT the true vector-space
                      // dimension.
-  std::vector<AtomicType> data;
-  std::vector<size_t>     indices_s;
-  std::vector<size_t>     sizes;
+  SegmentStorage<AtomicType> data;
+  SegmentStorage<size_t>     indices_s;
+  SegmentStorage<size_t>     sizes;
+  SegmentStorage<double>     sq_norms;
 
   public:
   SparseVectorData(const DataIn& datain, bool as_empty)
@@ -465,28 +1243,54 @@ class SparseVectorData
     }
   }
 
+  static ClusterStore get_cluster_store(size_t K, const DataIn& datain)
+  {
+    return {{K, datain.get_max_size()}, {K, datain.get_max_size()}, {K, 1}, {K, 1}};
+  }
+
+  void set_cluster_store(ClusterStore& store, size_t k)
+  {
+    data.set_store(store.data.values, k);
+    indices_s.set_store(store.indices_s.values, k);
+    sizes.set_store(store.sizes.values, k);
+    sq_norms.set_store(store.sq_norms.values, k);
+  }
+
   size_t get_ndata() const { return ndata; }
 
   void append(const SparseVectorSample<AtomicType>& s)
   {
     ndata += 1;
-    data.insert(data.end(), s.values, s.values + s.size);
-    data.resize(ndata * dimension);
-    indices_s.insert(indices_s.end(), s.indices, s.indices + s.size);
-    indices_s.resize(ndata * dimension);
-    sizes.push_back(s.size);
+    data.append(s.values, s.size, dimension);
+    indices_s.append(s.indices, s.size, dimension);
+    sizes.append(&s.size, 1);
+    sq_norms.append(&s.sq_norm, 1);
+  }
+
+  void reserve(size_t n)
+  {
+    data.reserve(n * dimension);
+    indices_s.reserve(n * dimension);
+    sizes.reserve(n);
+    sq_norms.reserve(n);
+  }
+
+  size_t get_n_bytes_reallocated() const
+  {
+    return data.get_n_bytes_reallocated() + indices_s.get_n_bytes_reallocated() +
+           sizes.get_n_bytes_reallocated() + sq_norms.get_n_bytes_reallocated();
   }
 
   SparseVectorSample<AtomicType> at_for_metric(size_t j) const
   {
     return SparseVectorSample<AtomicType>(
-      sizes[j], data.data() + j * dimension, indices_s.data() + j * dimension);
+      sizes[j], data.data() + j * dimension, indices_s.data() + j * dimension, sq_norms[j]);
   }
 
   SparseVectorSample<AtomicType> at_for_move(size_t j) const
   {
     return SparseVectorSample<AtomicType>(
-      sizes[j], data.data() + j * dimension, indices_s.data() + j * dimension);
+      sizes[j], data.data() + j * dimension, indices_s.data() + j * dimension, sq_norms[j]);
   }
 
   void remove_last()
@@ -496,9 +1300,10 @@ class SparseVectorData
       throw zentas::zentas_error("Request for remove_last, but ndata == 0");
     }
     ndata -= 1;
-    data.resize(ndata * dimension);
-    indices_s.resize(ndata * dimension);
-    sizes.resize(ndata);
+    data.remove_last(dimension);
+    indices_s.remove_last(dimension);
+    sizes.remove_last(1);
+    sq_norms.remove_last(1);
   }
 
   void replace_with(size_t j, const SparseVectorSample<AtomicType>& s)
@@ -508,7 +1313,8 @@ class SparseVectorData
       data[j * dimension + d]      = *(s.values + d);
       indices_s[j * dimension + d] = *(s.indices + d);
     }
-    sizes[j] = s.size;
+    sizes[j]    = s.size;
+    sq_norms[j] = s.sq_norm;
   }
 
   std::string string_for_sample(size_t i)
@@ -549,11 +1355,13 @@ class BaseDataRooted
   public:
   typedef TDataIn DataIn;
 
+  using ClusterStore = ClusterValueStore<size_t>;
+
   protected:
-  size_t              ndata;
-  size_t              dimension;
-  std::vector<size_t> IDs;
-  const TDataIn*      ptr_datain;
+  size_t                 ndata;
+  size_t                 dimension;
+  SegmentStorage<size_t> IDs;
+  const TDataIn*         ptr_datain;
 
   public:
   BaseDataRooted(const DataIn& datain, bool as_empty)
@@ -567,13 +1375,21 @@ class BaseDataRooted
     }
   }
 
+  static ClusterStore get_cluster_store(size_t K, const DataIn&) { return {K, 1}; }
+
+  void set_cluster_store(ClusterStore& store, size_t k) { IDs.set_store(store.values, k); }
+
   size_t get_ndata() const { return ndata; }
   void append(size_t i)
   {
     ndata += 1;
-    IDs.push_back(i);
+    IDs.append(&i, 1);
   }
 
+  void reserve(size_t n) { IDs.reserve(n); }
+
+  size_t get_n_bytes_reallocated() const { return IDs.get_n_bytes_reallocated(); }
+
   size_t at_for_move(size_t j) const { return IDs[j]; }
   void                      remove_last()
   {
@@ -582,10 +1398,20 @@ class BaseDataRooted
       throw zentas::zentas_error("Request for remove_last, but ndata == 0");
     }
     ndata -= 1;
-    IDs.resize(ndata);
+    IDs.remove_last(1);
   }
   void replace_with(size_t j, size_t i) { IDs[j] = i; }
 
+  /* The input has been reordered into datain : the sample which was at i is at old_to_new[i] */
+  void set_reordered(const DataIn& datain, const std::vector<size_t>& old_to_new)
+  {
+    ptr_datain = &datain;
+    for (size_t j = 0; j < ndata; ++j)
+    {
+      IDs[j] = old_to_new[IDs[j]];
+    }
+  }
+
   std::string string_for_sample(size_t i)
   {
     (void)i;
@@ -626,6 +1452,75 @@ class VDataRooted : public BaseDataRooted<TDataIn>
   const AtomicType* at_for_metric(size_t j) const { return ptr_datain->data + IDs[j] * dimension; }
 };
 
+/* VDataRooted with cached squared norms (which are in the NormedDenseVectorDataRootedIn) */
+template <typename TDataIn>
+class NormedVDataRooted : public BaseDataRooted<TDataIn>
+{
+
+  public:
+  NormedVDataRooted() = default;
+
+  public:
+  using AtomicType = typename TDataIn::AtomicType;
+  typedef NormedVCenterData<AtomicType> RefinementCenterData;
+
+  ConstLengthInitBundle<AtomicType> get_as_datain_ib()
+  {
+    throw zentas::zentas_error("the function get_as_datain_ib needs to be implemented for rooted "
+                               "(dense) data (data needs to be made from indices) ");
+  }
+
+  using BaseDataRooted<TDataIn>::ptr_datain;
+  using BaseDataRooted<TDataIn>::IDs;
+
+  public:
+  using Sample = typename TDataIn::Sample;
+
+  typedef TDataIn DataIn;
+
+  NormedVDataRooted(const DataIn& datain, bool as_empty)
+    : BaseDataRooted<TDataIn>(datain, as_empty)
+  {
+  }
+
+  Sample at_for_metric(size_t j) const { return ptr_datain->at_for_metric(IDs[j]); }
+};
+
+/* VDataRooted with reduced precision storage (the codes are in the
+ * QuantisedDenseVectorDataRootedIn) */
+template <typename TDataIn>
+class QuantisedVDataRooted : public BaseDataRooted<TDataIn>
+{
+
+  public:
+  QuantisedVDataRooted() = default;
+
+  public:
+  using AtomicType = typename TDataIn::AtomicType;
+  typedef QuantisedRefinementCenterData<typename TDataIn::CodeType> RefinementCenterData;
+
+  QuantisedInitBundle<typename TDataIn::CodeType> get_as_datain_ib()
+  {
+    throw zentas::zentas_error("the function get_as_datain_ib needs to be implemented for rooted "
+                               "(dense) data (data needs to be made from indices) ");
+  }
+
+  using BaseDataRooted<TDataIn>::ptr_datain;
+  using BaseDataRooted<TDataIn>::IDs;
+
+  public:
+  using Sample = typename TDataIn::Sample;
+
+  typedef TDataIn DataIn;
+
+  QuantisedVDataRooted(const DataIn& datain, bool as_empty)
+    : BaseDataRooted<TDataIn>(datain, as_empty)
+  {
+  }
+
+  Sample at_for_metric(size_t j) const { return ptr_datain->at_for_metric(IDs[j]); }
+};
+
 template <typename TDataIn>
 class SDataRooted : public BaseDataRooted<TDataIn>
 {
@@ -644,10 +1539,7 @@ class SDataRooted : public BaseDataRooted<TDataIn>
 
   public:
   SDataRooted(const DataIn& datain, bool as_empty) : BaseDataRooted<TDataIn>(datain, as_empty) {}
-  const Sample at_for_metric(size_t j) const
-  {
-    return Sample(ptr_datain->get_size(IDs[j]), ptr_datain->get_data(IDs[j]));
-  }
+  const Sample at_for_metric(size_t j) const { return ptr_datain->at_for_metric(IDs[j]); }
 };
 
 template <typename TDataIn>
@@ -684,7 +1576,8 @@ class SparseVectorDataRooted : public BaseDataRooted<TDataIn>
   {
     return SparseVectorSample<AtomicType>(ptr_datain->get_size(IDs[j]),
                                           ptr_datain->get_data(IDs[j]),
-                                          ptr_datain->get_indices_s(IDs[j]));
+                                          ptr_datain->get_indices_s(IDs[j]),
+                                          ptr_datain->get_sq_norm(IDs[j]));
   }
 };
 
@@ -6,12 +6,16 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <sstream>
+#include <thread>
 #include <vector>
+#include <zentas/lpkernels.hpp>
+#include <zentas/quantise.hpp>
 #include <zentas/zentaserror.hpp>
 // TODO rename this file.
 #include <zentas/sparsevectorrfcenter.hpp>
@@ -33,13 +37,92 @@ class TDataIn{
 namespace nszen
 {
 
+/* The symbol histogram and bigram profile of a sequence, for lower bounds on Levenshtein
+ * distances. A symbol is keyed by its rank r in the alphabet of the data, of n_ranks symbols,
+ * and a bigram (r, r') by n_ranks + r n_ranks + r'. keys[0, n_symbols) are the distinct
+ * symbols, and keys[n_symbols, n_keys) the distinct bigrams, both sorted. counts are the
+ * numbers of occurrences. Dense profiles (of small alphabets) have no keys (keys is nullptr) :
+ * counts are then of all n_keys = n_ranks + n_ranks^2 keys, of which n_symbols = n_ranks are
+ * the symbols. n_symbols is 0 if there is no profile. */
+struct StringProfile
+{
+  public:
+  size_t          n_symbols;
+  size_t          n_keys;
+  const uint16_t* keys;
+  const uint16_t* counts;
+  StringProfile(size_t n_symbols_, size_t n_keys_, const uint16_t* keys_, const uint16_t* counts_)
+    : n_symbols(n_symbols_), n_keys(n_keys_), keys(keys_), counts(counts_)
+  {
+  }
+  StringProfile() : n_symbols(0), n_keys(0), keys(nullptr), counts(nullptr) {}
+};
+
+/* profile keys are 16-bit, so that n_ranks + n_ranks^2 < 2^16 */
+constexpr size_t max_profile_n_ranks = 255;
+/* profile counts are 16-bit, so only sequences of at most this length have profiles */
+constexpr size_t max_profile_size = std::numeric_limits<uint16_t>::max();
+
+/* append the profile of ranks[0, size), dense or not, to keys and counts, returning the number
+ * of distinct symbols (n_ranks if dense). size is at most max_profile_size. */
+inline size_t append_string_profile(const uint16_t* const  ranks,
+                                    size_t                 size,
+                                    size_t                 n_ranks,
+                                    bool                   dense,
+                                    std::vector<uint16_t>& keys,
+                                    std::vector<uint16_t>& counts)
+{
+  if (dense)
+  {
+    size_t n_counts_before = counts.size();
+    counts.resize(n_counts_before + n_ranks + n_ranks * n_ranks, 0);
+    uint16_t* const dense_counts = counts.data() + n_counts_before;
+    for (size_t i = 0; i < size; ++i)
+    {
+      ++dense_counts[ranks[i]];
+    }
+    for (size_t i = 0; i + 1 < size; ++i)
+    {
+      ++dense_counts[n_ranks + ranks[i] * n_ranks + ranks[i + 1]];
+    }
+    return n_ranks;
+  }
+
+  /* the keys of the symbols are smaller than those of the bigrams, so sorting all of the keys
+   * puts the symbols first */
+  std::vector<uint16_t> occurrences(ranks, ranks + size);
+  for (size_t i = 0; i + 1 < size; ++i)
+  {
+    occurrences.push_back(static_cast<uint16_t>(n_ranks + ranks[i] * n_ranks + ranks[i + 1]));
+  }
+  std::sort(occurrences.begin(), occurrences.end());
+  size_t n_keys_before = keys.size();
+  size_t n_symbols     = 0;
+  for (auto& x : occurrences)
+  {
+    if (keys.size() == n_keys_before || keys.back() != x)
+    {
+      keys.push_back(x);
+      counts.push_back(0);
+      n_symbols += x < n_ranks;
+    }
+    ++counts.back();
+  }
+  return n_symbols;
+}
+
 template <typename TAtomic>
 struct VariableLengthSample
 {
   public:
   size_t               size;
   const TAtomic* const values;
+  StringProfile        profile;
   VariableLengthSample(size_t sz, const TAtomic* const vals) : size(sz), values(vals) {}
+  VariableLengthSample(size_t sz, const TAtomic* const vals, const StringProfile& prof)
+    : size(sz), values(vals), profile(prof)
+  {
+  }
   std::string str() const
   {
     std::stringstream ss;
@@ -51,6 +134,66 @@ struct VariableLengthSample
   }
 };
 
+/* the number of 64-bit words for size fields of field_width bits, a field never straddling two
+ * words */
+inline size_t get_n_packed_words(size_t size, size_t field_width)
+{
+  size_t fields_per_word = 64 / field_width;
+  return (size + fields_per_word - 1) / fields_per_word;
+}
+
+/* A sequence of which each value is stored as a code of field_width (2 or 4) bits, packed into
+ * 64-bit words. The value of code c is symbols[c]. */
+template <typename TAtomic>
+struct PackedSequenceSample
+{
+  public:
+  size_t               size;
+  const uint64_t*      words;
+  size_t               field_width;
+  const TAtomic*       symbols;
+  StringProfile        profile;
+  PackedSequenceSample(size_t               sz,
+                       const uint64_t*      wds,
+                       size_t               fw,
+                       const TAtomic* const syms,
+                       const StringProfile& prof)
+    : size(sz), words(wds), field_width(fw), symbols(syms), profile(prof)
+  {
+  }
+
+  size_t get_n_words() const { return get_n_packed_words(size, field_width); }
+
+  /* values[0, size) are set to the values of the sequence */
+  void unpack(TAtomic* const values) const
+  {
+    size_t   fields_per_word = 64 / field_width;
+    uint64_t mask            = (uint64_t(1) << field_width) - 1;
+    uint64_t word;
+    for (size_t w = 0, d = 0; d < size; ++w)
+    {
+      word = words[w];
+      for (size_t f = 0; f < fields_per_word && d < size; ++f, ++d)
+      {
+        values[d] = symbols[word & mask];
+        word >>= field_width;
+      }
+    }
+  }
+
+  std::string str() const
+  {
+    std::vector<TAtomic> values(size);
+    unpack(values.data());
+    std::stringstream ss;
+    for (auto& x : values)
+    {
+      ss << x;
+    }
+    return ss.str();
+  }
+};
+
 template <typename TAtomic>
 struct VariableLengthInitBundle
 {
@@ -58,8 +201,13 @@ struct VariableLengthInitBundle
   size_t               ndata;
   const size_t* const  sizes;
   const TAtomic* const data;
-  VariableLengthInitBundle(size_t ndata_, const size_t* const sizes_, const TAtomic* const data_)
-    : ndata(ndata_), sizes(sizes_), data(data_)
+  /* whether string data has StringProfiles, see BaseStringDataIn */
+  bool with_profiles;
+  VariableLengthInitBundle(size_t               ndata_,
+                           const size_t* const  sizes_,
+                           const TAtomic* const data_,
+                           bool                 with_profiles_ = false)
+    : ndata(ndata_), sizes(sizes_), data(data_), with_profiles(with_profiles_)
   {
   }
 };
@@ -91,6 +239,27 @@ struct SparseVectorDataInitBundle : public VariableLengthInitBundle<TAtomic>
   }
 };
 
+/* f(p) for p in [0, n), in nthreads contiguous ranges of p */
+template <class TFunction>
+void parallel_for(size_t n, size_t nthreads, TFunction f)
+{
+  std::vector<std::thread> threads;
+  for (size_t ti = 0; ti < nthreads; ++ti)
+  {
+    threads.emplace_back([ti, n, nthreads, &f]() {
+      for (size_t p = (ti * n) / nthreads; p < ((ti + 1) * n) / nthreads; ++p)
+      {
+        f(p);
+      }
+    });
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+}
+
 template <typename TAtomic>
 struct BaseDataIn
 {
@@ -143,6 +312,30 @@ struct BaseConstLengthDataIn : public BaseDataIn<TAtomic>
     return BaseConstLengthDataIn::data + BaseConstLengthDataIn::dimension * i;
   }
 
+  /* samples order[0], order[1], ... copied into values, from which the reordered input is
+   * constructed (see SkeletonClusterer::reorder_rooted_data). sizes and indices are unused. */
+  ConstLengthInitBundle<TAtomic> get_reordered_ib(const std::vector<size_t>& order,
+                                                  size_t                     nthreads,
+                                                  std::vector<TAtomic>&      values,
+                                                  std::vector<size_t>&       sizes,
+                                                  std::vector<size_t>&       indices) const
+  {
+    (void)sizes;
+    (void)indices;
+    if (BaseConstLengthDataIn::data == nullptr)
+    {
+      throw zentas::zentas_error("cannot reorder input which has no (full precision) data");
+    }
+    size_t dimension = BaseConstLengthDataIn::dimension;
+    values.resize(order.size() * dimension);
+    parallel_for(order.size(), nthreads, [this, &order, &values, dimension](size_t p) {
+      std::copy(at_for_metric(order[p]),
+                at_for_metric(order[p]) + dimension,
+                values.data() + p * dimension);
+    });
+    return {order.size(), dimension, values.data()};
+  }
+
   BaseConstLengthDataIn() = default;
 };
 
@@ -175,6 +368,193 @@ struct DenseVectorDataRootedIn : public BaseConstLengthDataIn<TAtomic>
   DenseVectorDataRootedIn() = default;
 };
 
+/* For l2 with cached squared norms (metric "l2c"), where
+ * ||a - b||^2 = ||a||^2 + ||b||^2 - 2 a.b  */
+template <typename TAtomic>
+struct NormedDenseSample
+{
+  public:
+  const TAtomic* values;
+  double         sq_norm;
+};
+
+/* computed with the same kernel as the dot products in TLpDistance, so that the distance
+ * between a vector and itself is exactly zero */
+template <typename TAtomic>
+double get_sq_norm(const TAtomic* const values, size_t dimension)
+{
+  return lpkernels::get_dense_dot_kernel<TAtomic>()(values, values, dimension);
+}
+
+/* as get_sq_norm, for sparse vectors */
+template <typename TAtomic>
+double get_sparse_sq_norm(const TAtomic* const values, const size_t* const indices, size_t size)
+{
+  return lpkernels::get_sparse_dot_kernel<TAtomic>()(values, indices, size, values, indices, size);
+}
+
+template <typename TAtomic>
+std::vector<double> get_sq_norms(const BaseConstLengthDataIn<TAtomic>& datain)
+{
+  std::vector<double> sq_norms(datain.ndata);
+  for (size_t i = 0; i < datain.ndata; ++i)
+  {
+    sq_norms[i] = get_sq_norm(datain.at_for_metric(i), datain.dimension);
+  }
+  return sq_norms;
+}
+
+template <typename TAtomic>
+struct NormedDenseVectorDataUnrootedIn : public DenseVectorDataUnrootedIn<TAtomic>
+{
+  public:
+  using Sample = NormedDenseSample<TAtomic>;
+  std::vector<double> sq_norms;
+
+  NormedDenseVectorDataUnrootedIn(const ConstLengthInitBundle<TAtomic>& ib)
+    : DenseVectorDataUnrootedIn<TAtomic>(ib), sq_norms(get_sq_norms(*this))
+  {
+  }
+
+  Sample at_for_metric(size_t i) const
+  {
+    return {DenseVectorDataUnrootedIn<TAtomic>::at_for_metric(i), sq_norms[i]};
+  }
+
+  Sample at_for_move(size_t i) const { return at_for_metric(i); }
+
+  NormedDenseVectorDataUnrootedIn() = default;
+};
+
+template <typename TAtomic>
+struct NormedDenseVectorDataRootedIn : public DenseVectorDataRootedIn<TAtomic>
+{
+  public:
+  using Sample = NormedDenseSample<TAtomic>;
+  std::vector<double> sq_norms;
+
+  NormedDenseVectorDataRootedIn(const ConstLengthInitBundle<TAtomic>& ib)
+    : DenseVectorDataRootedIn<TAtomic>(ib), sq_norms(get_sq_norms(*this))
+  {
+  }
+
+  Sample at_for_metric(size_t i) const
+  {
+    return {DenseVectorDataRootedIn<TAtomic>::at_for_metric(i), sq_norms[i]};
+  }
+
+  NormedDenseVectorDataRootedIn() = default;
+};
+
+/* For reduced precision storage (vzentas storage "fp16", "bf16", "int8"). The scales are
+ * carried with the codes, as the distance needs them. See quantise.hpp */
+template <typename TCode>
+struct QuantisedDenseSample
+{
+  public:
+  const TCode* codes;
+  const float* scales;
+};
+
+/* codes which are already quantised, as for the centers in perform_subclustering */
+template <typename TCode>
+struct QuantisedInitBundle
+{
+  public:
+  size_t                   ndata;
+  size_t                   dimension;
+  const TCode* const       codes;
+  const DenseQuantisation& quantisation;
+  QuantisedInitBundle(size_t                   ndata_,
+                      size_t                   dimension_,
+                      const TCode* const       codes_,
+                      const DenseQuantisation& quantisation_)
+    : ndata(ndata_), dimension(dimension_), codes(codes_), quantisation(quantisation_)
+  {
+  }
+};
+
+/* TAtomic is the type of the full precision input, which is not used after construction
+ * (data is a nullptr when constructed from a QuantisedInitBundle). */
+template <typename TAtomic, typename TCode>
+struct QuantisedDenseVectorDataIn : public BaseConstLengthDataIn<TAtomic>
+{
+  public:
+  using Sample   = QuantisedDenseSample<TCode>;
+  using CodeType = TCode;
+  DenseQuantisation  quantisation;
+  std::vector<TCode> codes;
+
+  QuantisedDenseVectorDataIn(const ConstLengthInitBundle<TAtomic>& ib)
+    : BaseConstLengthDataIn<TAtomic>(ib)
+  {
+    set_dense_quantisation(ib.ndata, ib.dimension, ib.data, quantisation, codes);
+  }
+
+  QuantisedDenseVectorDataIn(const QuantisedInitBundle<TCode>& ib)
+    : quantisation(ib.quantisation), codes(ib.codes, ib.codes + ib.ndata * ib.dimension)
+  {
+    BaseDataIn<TAtomic>::ndata     = ib.ndata;
+    BaseDataIn<TAtomic>::dimension = ib.dimension;
+    BaseDataIn<TAtomic>::data      = nullptr;
+  }
+
+  Sample at_for_metric(size_t i) const
+  {
+    return {codes.data() + i * BaseDataIn<TAtomic>::dimension, quantisation.scales.data()};
+  }
+
+  virtual std::string string_for_sample(size_t i) const override
+  {
+    std::stringstream ss;
+    ss << "(";
+    for (size_t d = 0; d < BaseDataIn<TAtomic>::dimension; ++d)
+    {
+      ss << " "
+         << quantisation.offsets[d] +
+              quantisation.scales[d] * widen(codes[i * BaseDataIn<TAtomic>::dimension + d])
+         << " ";
+    }
+    ss << ")";
+    return ss.str();
+  }
+
+  QuantisedDenseVectorDataIn() = default;
+};
+
+template <typename TAtomic, typename TCode>
+struct QuantisedDenseVectorDataUnrootedIn : public QuantisedDenseVectorDataIn<TAtomic, TCode>
+{
+  public:
+  template <class TInitBundle>
+  QuantisedDenseVectorDataUnrootedIn(const TInitBundle& ib)
+    : QuantisedDenseVectorDataIn<TAtomic, TCode>(ib)
+  {
+  }
+
+  QuantisedDenseSample<TCode> at_for_move(size_t i) const
+  {
+    return QuantisedDenseVectorDataIn<TAtomic, TCode>::at_for_metric(i);
+  }
+
+  QuantisedDenseVectorDataUnrootedIn() = default;
+};
+
+template <typename TAtomic, typename TCode>
+struct QuantisedDenseVectorDataRootedIn : public QuantisedDenseVectorDataIn<TAtomic, TCode>
+{
+  public:
+  template <class TInitBundle>
+  QuantisedDenseVectorDataRootedIn(const TInitBundle& ib)
+    : QuantisedDenseVectorDataIn<TAtomic, TCode>(ib)
+  {
+  }
+
+  size_t at_for_move(size_t i) const { return i; }
+
+  QuantisedDenseVectorDataRootedIn() = default;
+};
+
 /* The basis for string and sparse vector input data  */
 template <typename TAtomic>
 class BaseVarLengthDataIn : public BaseDataIn<TAtomic>
@@ -224,6 +604,45 @@ class BaseVarLengthDataIn : public BaseDataIn<TAtomic>
 
   const TAtomic* get_data(size_t i) const { return BaseDataIn<TAtomic>::data + c_sizes[i]; }
 
+  /* as BaseConstLengthDataIn::get_reordered_ib, with the sizes of the reordered samples in
+   * sizes. indices are unused. */
+  VariableLengthInitBundle<TAtomic> get_reordered_ib(const std::vector<size_t>& order,
+                                                     size_t                     nthreads,
+                                                     std::vector<TAtomic>&      values,
+                                                     std::vector<size_t>&       reordered_sizes,
+                                                     std::vector<size_t>&       indices) const
+  {
+    (void)indices;
+    std::vector<size_t> reordered_c_sizes;
+    set_reordered(order, nthreads, values, reordered_sizes, reordered_c_sizes);
+    return {order.size(), reordered_sizes.data(), values.data()};
+  }
+
+  protected:
+  void set_reordered(const std::vector<size_t>& order,
+                     size_t                     nthreads,
+                     std::vector<TAtomic>&      values,
+                     std::vector<size_t>&       reordered_sizes,
+                     std::vector<size_t>&       reordered_c_sizes) const
+  {
+    reordered_sizes.resize(order.size());
+    reordered_c_sizes.assign(order.size() + 1, 0);
+    for (size_t p = 0; p < order.size(); ++p)
+    {
+      reordered_sizes[p]       = sizes[order[p]];
+      reordered_c_sizes[p + 1] = reordered_c_sizes[p] + reordered_sizes[p];
+    }
+
+    values.resize(reordered_c_sizes.back());
+    parallel_for(order.size(), nthreads, [this, &order, &values, &reordered_c_sizes](size_t p) {
+      std::copy(get_data(order[p]),
+                get_data(order[p]) + sizes[order[p]],
+                values.data() + reordered_c_sizes[p]);
+    });
+  }
+
+  public:
+
   virtual std::string string_for_sample(size_t i) const
   {
     std::stringstream ss;
@@ -261,13 +680,103 @@ class BaseStringDataIn : public BaseVarLengthDataIn<TAtomic>
   public:
   using Sample = VariableLengthSample<TAtomic>;
 
+  protected:
+  /* The profiles are only built if ib.with_profiles, and the alphabet has at most
+   * max_profile_n_ranks symbols. They are dense if a dense profile is no larger than a sparse
+   * profile of a sequence of the mean size can be. The profile of sample i is at c_profiles[i]
+   * in profile_keys (unless dense) and profile_counts. */
+  bool                  with_profiles  = false;
+  bool                  dense_profiles = false;
+  std::vector<uint16_t> profile_keys;
+  std::vector<uint16_t> profile_counts;
+  std::vector<size_t>   c_profiles;
+  std::vector<uint16_t> profile_n_symbols;
+
+  void set_profiles(const VariableLengthInitBundle<TAtomic>& ib)
+  {
+    const size_t* const  c_sizes = BaseVarLengthDataIn<TAtomic>::c_sizes;
+    std::vector<TAtomic> alphabet(ib.data, ib.data + c_sizes[ib.ndata]);
+    std::sort(alphabet.begin(), alphabet.end());
+    alphabet.resize(std::unique(alphabet.begin(), alphabet.end()) - alphabet.begin());
+    size_t n_ranks = alphabet.size();
+    if (n_ranks > max_profile_n_ranks)
+    {
+      return;
+    }
+
+    /* the size of a dense profile, and the largest size of a sparse one of the mean size */
+    double mean_size     = BaseVarLengthDataIn<TAtomic>::mean_size;
+    double n_dense_bytes = 2. * static_cast<double>(n_ranks + n_ranks * n_ranks);
+    double n_sparse_bytes =
+      4. * (std::min<double>(mean_size, n_ranks) +
+            std::min<double>(std::max(mean_size - 1, 0.), n_ranks * n_ranks));
+
+    with_profiles  = true;
+    dense_profiles = n_dense_bytes <= n_sparse_bytes;
+    c_profiles.assign(ib.ndata + 1, 0);
+    profile_n_symbols.assign(ib.ndata, 0);
+    std::vector<uint16_t> ranks;
+    for (size_t i = 0; i < ib.ndata; ++i)
+    {
+      if (ib.sizes[i] <= max_profile_size)
+      {
+        ranks.resize(ib.sizes[i]);
+        for (size_t d = 0; d < ib.sizes[i]; ++d)
+        {
+          ranks[d] = static_cast<uint16_t>(
+            std::lower_bound(alphabet.begin(), alphabet.end(), ib.data[c_sizes[i] + d]) -
+            alphabet.begin());
+        }
+        profile_n_symbols[i] = static_cast<uint16_t>(append_string_profile(
+          ranks.data(), ib.sizes[i], n_ranks, dense_profiles, profile_keys, profile_counts));
+      }
+      c_profiles[i + 1] = profile_counts.size();
+    }
+  }
+
+  public:
   BaseStringDataIn(const VariableLengthInitBundle<TAtomic>& ib) : BaseVarLengthDataIn<TAtomic>(ib)
   {
+    if (ib.with_profiles)
+    {
+      set_profiles(ib);
+    }
+  }
+
+  bool has_profiles() const { return with_profiles; }
+
+  bool has_dense_profiles() const { return dense_profiles; }
+
+  StringProfile get_profile(size_t i) const
+  {
+    if (with_profiles == false)
+    {
+      return StringProfile();
+    }
+    return StringProfile(profile_n_symbols[i],
+                         c_profiles[i + 1] - c_profiles[i],
+                         dense_profiles ? nullptr : profile_keys.data() + c_profiles[i],
+                         profile_counts.data() + c_profiles[i]);
   }
+
+  /* as BaseVarLengthDataIn::get_reordered_ib, with profiles if there are */
+  VariableLengthInitBundle<TAtomic> get_reordered_ib(const std::vector<size_t>& order,
+                                                     size_t                     nthreads,
+                                                     std::vector<TAtomic>&      values,
+                                                     std::vector<size_t>&       reordered_sizes,
+                                                     std::vector<size_t>&       indices) const
+  {
+    VariableLengthInitBundle<TAtomic> ib = BaseVarLengthDataIn<TAtomic>::get_reordered_ib(
+      order, nthreads, values, reordered_sizes, indices);
+    ib.with_profiles = with_profiles;
+    return ib;
+  }
+
   const Sample at_for_metric(size_t i) const
   {
     return Sample(BaseVarLengthDataIn<TAtomic>::sizes[i],
-                  BaseDataIn<TAtomic>::data + BaseVarLengthDataIn<TAtomic>::c_sizes[i]);
+                  BaseDataIn<TAtomic>::data + BaseVarLengthDataIn<TAtomic>::c_sizes[i],
+                  get_profile(i));
   }
 
   BaseStringDataIn() = default;
@@ -278,15 +787,13 @@ class StringDataUnrootedIn : public BaseStringDataIn<TAtomic>
 {
 
   public:
+  /* there is no unrooted_viability_test, as SData is not padded to the longest sequence */
   StringDataUnrootedIn(const VariableLengthInitBundle<TAtomic>& ib) : BaseStringDataIn<TAtomic>(ib)
   {
-    BaseVarLengthDataIn<TAtomic>::unrooted_viability_test();
   }
   const VariableLengthSample<TAtomic> at_for_move(size_t i) const
   {
-    return VariableLengthSample<TAtomic>(BaseVarLengthDataIn<TAtomic>::sizes[i],
-                                         BaseDataIn<TAtomic>::data +
-                                           BaseVarLengthDataIn<TAtomic>::c_sizes[i]);
+    return BaseStringDataIn<TAtomic>::at_for_metric(i);
   }
 
   StringDataUnrootedIn() = default;
@@ -305,6 +812,178 @@ class StringDataRootedIn : public BaseStringDataIn<TAtomic>
   StringDataRootedIn() = default;
 };
 
+/* Sequences of at most 16 distinct values, such as nucleotides (ACGT, 2 bits per value) or
+ * nucleotides with the IUPAC ambiguity codes (4 bits per value), stored packed. The codes of
+ * the values are their ranks amongst the distinct values. There are no profiles, whatever
+ * ib.with_profiles : the dense profile of a nucleotide sequence is 40 bytes (of the IUPAC
+ * codes, 544 bytes), the packed values of 160 (of 1088) nucleotides. */
+template <typename TAtomic>
+class BasePackedStringDataIn : public BaseStringDataIn<TAtomic>
+{
+
+  public:
+  using Sample = PackedSequenceSample<TAtomic>;
+  using BaseVarLengthDataIn<TAtomic>::sizes;
+  using BaseVarLengthDataIn<TAtomic>::c_sizes;
+
+  protected:
+  std::vector<TAtomic>  symbols;
+  size_t                field_width;
+  std::vector<uint64_t> packed;
+  std::vector<size_t>   c_words;
+
+  public:
+  BasePackedStringDataIn(const VariableLengthInitBundle<TAtomic>& ib)
+    : BaseStringDataIn<TAtomic>(VariableLengthInitBundle<TAtomic>(ib.ndata, ib.sizes, ib.data)),
+      c_words(ib.ndata + 1, 0)
+  {
+    symbols.assign(ib.data, ib.data + c_sizes[ib.ndata]);
+    std::sort(symbols.begin(), symbols.end());
+    symbols.resize(std::unique(symbols.begin(), symbols.end()) - symbols.begin());
+    if (symbols.size() > 16)
+    {
+      throw zentas::zentas_error("packed storage of sequences is for at most 16 distinct values "
+                                 "(nucleotides, with or without the IUPAC codes), but there are " +
+                                 std::to_string(symbols.size()));
+    }
+    field_width = symbols.size() <= 4 ? 2 : 4;
+
+    for (size_t i = 0; i < ib.ndata; ++i)
+    {
+      c_words[i + 1] = c_words[i] + get_n_packed_words(sizes[i], field_width);
+    }
+    packed.assign(c_words[ib.ndata], 0);
+
+    size_t   fields_per_word = 64 / field_width;
+    uint64_t code;
+    for (size_t i = 0; i < ib.ndata; ++i)
+    {
+      for (size_t d = 0; d < sizes[i]; ++d)
+      {
+        code = std::lower_bound(symbols.begin(), symbols.end(), ib.data[c_sizes[i] + d]) -
+               symbols.begin();
+        packed[c_words[i] + d / fields_per_word] |= code << (field_width * (d % fields_per_word));
+      }
+    }
+  }
+
+  size_t get_field_width() const { return field_width; }
+
+  const TAtomic* get_symbols() const { return symbols.data(); }
+
+  const Sample at_for_metric(size_t i) const
+  {
+    return Sample(sizes[i],
+                  packed.data() + c_words[i],
+                  field_width,
+                  symbols.data(),
+                  BaseStringDataIn<TAtomic>::get_profile(i));
+  }
+
+  BasePackedStringDataIn() = default;
+};
+
+template <typename TAtomic>
+class PackedStringDataUnrootedIn : public BasePackedStringDataIn<TAtomic>
+{
+
+  public:
+  PackedStringDataUnrootedIn(const VariableLengthInitBundle<TAtomic>& ib)
+    : BasePackedStringDataIn<TAtomic>(ib)
+  {
+  }
+  const PackedSequenceSample<TAtomic> at_for_move(size_t i) const
+  {
+    return BasePackedStringDataIn<TAtomic>::at_for_metric(i);
+  }
+
+  PackedStringDataUnrootedIn() = default;
+};
+
+template <typename TAtomic>
+class PackedStringDataRootedIn : public BasePackedStringDataIn<TAtomic>
+{
+
+  public:
+  PackedStringDataRootedIn(const VariableLengthInitBundle<TAtomic>& ib)
+    : BasePackedStringDataIn<TAtomic>(ib)
+  {
+  }
+  size_t at_for_move(size_t i) const { return i; }
+
+  PackedStringDataRootedIn() = default;
+};
+
+/* Real-valued time series of variable length, for the dtw metric */
+template <typename TAtomic>
+class BaseTimeSeriesDataIn : public BaseVarLengthDataIn<TAtomic>
+{
+
+  public:
+  using Sample = VariableLengthSample<TAtomic>;
+
+  BaseTimeSeriesDataIn(const VariableLengthInitBundle<TAtomic>& ib)
+    : BaseVarLengthDataIn<TAtomic>(ib)
+  {
+  }
+
+  /* time series have no StringProfiles */
+  bool has_profiles() const { return false; }
+
+  bool has_dense_profiles() const { return false; }
+
+  const Sample at_for_metric(size_t i) const
+  {
+    return Sample(BaseVarLengthDataIn<TAtomic>::sizes[i],
+                  BaseVarLengthDataIn<TAtomic>::get_data(i));
+  }
+
+  virtual std::string string_for_sample(size_t i) const override
+  {
+    std::stringstream ss;
+    ss << "{";
+    for (size_t d = 0; d < BaseVarLengthDataIn<TAtomic>::sizes[i]; ++d)
+    {
+      ss << (d == 0 ? "" : " ") << BaseVarLengthDataIn<TAtomic>::get_data(i)[d];
+    }
+    ss << "}";
+    return ss.str();
+  }
+
+  BaseTimeSeriesDataIn() = default;
+};
+
+template <typename TAtomic>
+class TimeSeriesDataUnrootedIn : public BaseTimeSeriesDataIn<TAtomic>
+{
+
+  public:
+  TimeSeriesDataUnrootedIn(const VariableLengthInitBundle<TAtomic>& ib)
+    : BaseTimeSeriesDataIn<TAtomic>(ib)
+  {
+  }
+  const VariableLengthSample<TAtomic> at_for_move(size_t i) const
+  {
+    return BaseTimeSeriesDataIn<TAtomic>::at_for_metric(i);
+  }
+
+  TimeSeriesDataUnrootedIn() = default;
+};
+
+template <typename TAtomic>
+class TimeSeriesDataRootedIn : public BaseTimeSeriesDataIn<TAtomic>
+{
+
+  public:
+  TimeSeriesDataRootedIn(const VariableLengthInitBundle<TAtomic>& ib)
+    : BaseTimeSeriesDataIn<TAtomic>(ib)
+  {
+  }
+  size_t at_for_move(size_t i) const { return i; }
+
+  TimeSeriesDataRootedIn() = default;
+};
+
 /* For sparse vector data */
 template <typename TAtomic>
 class SparseVectorDataInBase : public BaseVarLengthDataIn<TAtomic>
@@ -315,7 +994,8 @@ class SparseVectorDataInBase : public BaseVarLengthDataIn<TAtomic>
   using BaseVarLengthDataIn<TAtomic>::c_sizes;
 
   protected:
-  const size_t* indices_s;
+  const size_t*       indices_s;
+  std::vector<double> sq_norms;
 
   public:
   virtual std::string string_for_sample(size_t i) const
@@ -332,8 +1012,16 @@ class SparseVectorDataInBase : public BaseVarLengthDataIn<TAtomic>
   }
 
   SparseVectorDataInBase(const SparseVectorDataInitBundle<TAtomic>& ib)
-    : BaseVarLengthDataIn<TAtomic>(ib.ndata, ib.sizes, ib.data), indices_s(ib.indices_s)
+    : BaseVarLengthDataIn<TAtomic>(ib.ndata, ib.sizes, ib.data),
+      indices_s(ib.indices_s),
+      sq_norms(ib.ndata)
   {
+    for (size_t i = 0; i < ib.ndata; ++i)
+    {
+      sq_norms[i] = get_sparse_sq_norm(BaseVarLengthDataIn<TAtomic>::get_data(i),
+                                       get_indices_s(i),
+                                       BaseVarLengthDataIn<TAtomic>::get_size(i));
+    }
   }
 
   const size_t* get_indices_s(size_t i) const
@@ -341,12 +1029,35 @@ class SparseVectorDataInBase : public BaseVarLengthDataIn<TAtomic>
     return indices_s + BaseVarLengthDataIn<TAtomic>::c_sizes[i];
   }
 
+  double get_sq_norm(size_t i) const { return sq_norms[i]; }
+
+  /* as BaseVarLengthDataIn::get_reordered_ib, with the reordered indices in indices */
+  SparseVectorDataInitBundle<TAtomic> get_reordered_ib(const std::vector<size_t>& order,
+                                                       size_t                     nthreads,
+                                                       std::vector<TAtomic>&      values,
+                                                       std::vector<size_t>&       reordered_sizes,
+                                                       std::vector<size_t>&       indices) const
+  {
+    std::vector<size_t> reordered_c_sizes;
+    BaseVarLengthDataIn<TAtomic>::set_reordered(
+      order, nthreads, values, reordered_sizes, reordered_c_sizes);
+
+    indices.resize(reordered_c_sizes.back());
+    parallel_for(order.size(), nthreads, [this, &order, &indices, &reordered_c_sizes](size_t p) {
+      std::copy(get_indices_s(order[p]),
+                get_indices_s(order[p]) + BaseVarLengthDataIn<TAtomic>::get_size(order[p]),
+                indices.data() + reordered_c_sizes[p]);
+    });
+    return {order.size(), reordered_sizes.data(), values.data(), indices.data()};
+  }
+
   const SparseVectorSample<TAtomic> at_for_metric(size_t i) const
   {
     return SparseVectorSample<TAtomic>(BaseVarLengthDataIn<TAtomic>::sizes[i],
                                        BaseDataIn<TAtomic>::data +
                                          BaseVarLengthDataIn<TAtomic>::c_sizes[i],
-                                       indices_s + BaseVarLengthDataIn<TAtomic>::c_sizes[i]);
+                                       indices_s + BaseVarLengthDataIn<TAtomic>::c_sizes[i],
+                                       sq_norms[i]);
   }
 
   SparseVectorDataInBase() = default;
@@ -368,7 +1079,8 @@ class SparseVectorDataUnrootedIn : public SparseVectorDataInBase<TAtomic>
     return SparseVectorSample<TAtomic>(
       BaseVarLengthDataIn<TAtomic>::sizes[i],
       BaseDataIn<TAtomic>::data + BaseVarLengthDataIn<TAtomic>::c_sizes[i],
-      SparseVectorDataInBase<TAtomic>::indices_s + BaseVarLengthDataIn<TAtomic>::c_sizes[i]);
+      SparseVectorDataInBase<TAtomic>::indices_s + BaseVarLengthDataIn<TAtomic>::c_sizes[i],
+      SparseVectorDataInBase<TAtomic>::sq_norms[i]);
   }
 
   SparseVectorDataUnrootedIn() = default;
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -57,7 +58,9 @@ void vzentas(size_t              ndata,
              std::string         rf_alg,
              size_t              rf_max_rounds,
              double              rf_max_time,
-             bool                do_balance_labels);
+             bool                do_balance_labels,
+             std::string         storage,
+             size_t              reorder_interval);
 
 // sparse vectors
 template <typename T>
@@ -92,9 +95,12 @@ void sparse_vector_zentas(size_t              ndata,
                           std::string         rf_alg,
                           size_t              rf_max_rounds,
                           double              rf_max_time,
-                          bool                do_balance_labels);
+                          bool                do_balance_labels,
+                          size_t              reorder_interval);
 
-// sequences, defined for T in {char, int}
+// sequences, defined for T in {char, int}. with_profiles to bound levenshtein distances from
+// the symbol and bigram counts of the sequences, of which the memory pays off for long sequences.
+// There are no profiles with storage "packed", as they would take more memory than the values.
 template <typename T>
 void szentas(size_t              ndata,
              const size_t* const sizes,
@@ -128,7 +134,71 @@ void szentas(size_t              ndata,
              const double* const c_switches_arr,
              double              critical_radius,
              double              exponent_coeff,
-             bool                do_balance_labels);
+             bool                do_balance_labels,
+             size_t              distance_cache_size,
+             std::string         storage,
+             bool                with_profiles);
+
+// packed binary vectors, n_bits per sample in (n_bits + 63) / 64 words, with the hamming metric
+void bvzentas(size_t                ndata,
+              size_t                n_bits,
+              const uint64_t* const ptr_datain,
+              size_t                K,
+              const size_t* const   indices_init,
+              std::string           initialisation_method,
+              std::string           algorithm,
+              size_t                level,
+              size_t                max_proposals,
+              bool                  capture_output,
+              std::string&          text,
+              size_t                seed,
+              double                max_time,
+              double                min_mE,
+              double                max_itok,
+              size_t* const         indices_final,
+              size_t* const         labels,
+              size_t                nthreads,
+              size_t                max_rounds,
+              bool                  patient,
+              std::string           energy,
+              bool                  with_tests,
+              bool                  rooted,
+              size_t                distance_cache_size,
+              double                critical_radius,
+              double                exponent_coeff,
+              bool                  do_balance_labels);
+
+// time series (float or double), with the dtw metric. A Sakoe-Chiba band of width window.
+template <typename T>
+void tszentas(size_t              ndata,
+              const size_t* const sizes,
+              const T* const      ptr_datain,
+              size_t              K,
+              const size_t* const indices_init,
+              std::string         initialisation_method,
+              std::string         algorithm,
+              size_t              level,
+              size_t              max_proposals,
+              bool                capture_output,
+              std::string&        text,
+              size_t              seed,
+              double              max_time,
+              double              min_mE,
+              double              max_itok,
+              size_t* const       indices_final,
+              size_t* const       labels,
+              std::string         metric,
+              size_t              nthreads,
+              size_t              max_rounds,
+              bool                patient,
+              std::string         energy,
+              bool                with_tests,
+              bool                rooted,
+              size_t              window,
+              size_t              distance_cache_size,
+              double              critical_radius,
+              double              exponent_coeff,
+              bool                do_balance_labels);
 
 // strings, from txt file (for fasta files or ordinary text files)
 void textfilezentas(std::vector<std::string> filenames,
@@ -154,7 +224,104 @@ void textfilezentas(std::vector<std::string> filenames,
                     double                   critical_radius,
                     double                   exponent_coeff,
                     std::string              initialisation_method,
-                    bool                     do_balance_labels);
+                    bool                     do_balance_labels,
+                    size_t                   distance_cache_size,
+                    std::string              storage,
+                    bool                     with_profiles);
+
+// dense vectors, from a .npy file of shape (ndata, dimension) and dtype float32 or float64. The
+// file is memory mapped, and clustered rooted without being copied.
+void npyvzentas(std::string         filename,
+                size_t              K,
+                const size_t* const indices_init,
+                std::string         initialisation_method,
+                std::string         algorithm,
+                size_t              level,
+                size_t              max_proposals,
+                bool                capture_output,
+                std::string&        text,
+                size_t              seed,
+                double              max_time,
+                double              min_mE,
+                double              max_itok,
+                size_t* const       indices_final,
+                size_t* const       labels,
+                std::string         metric,
+                size_t              nthreads,
+                size_t              max_rounds,
+                bool                patient,
+                std::string         energy,
+                bool                with_tests,
+                double              critical_radius,
+                double              exponent_coeff,
+                size_t              reorder_interval,
+                bool                do_balance_labels);
+
+// sparse vectors, from .npy files of sizes (uint64), values (float32 or float64) and indices
+// (uint64), memory mapped as in npyvzentas
+void npysparse_vector_zentas(std::string         sizes_filename,
+                             std::string         values_filename,
+                             std::string         indices_filename,
+                             size_t              K,
+                             const size_t* const indices_init,
+                             std::string         initialisation_method,
+                             std::string         algorithm,
+                             size_t              level,
+                             size_t              max_proposals,
+                             bool                capture_output,
+                             std::string&        text,
+                             size_t              seed,
+                             double              max_time,
+                             double              min_mE,
+                             double              max_itok,
+                             size_t* const       indices_final,
+                             size_t* const       labels,
+                             std::string         metric,
+                             size_t              nthreads,
+                             size_t              max_rounds,
+                             bool                patient,
+                             std::string         energy,
+                             bool                with_tests,
+                             double              critical_radius,
+                             double              exponent_coeff,
+                             size_t              reorder_interval,
+                             bool                do_balance_labels);
+
+// sequences, from .npy files of sizes (uint64) and values (int8, bytes S1 or int32), memory
+// mapped as in npyvzentas, with no string profiles. The hamming metric packs the sequences
+// into memory, at 1 to 8 bits per int8 or S1 value (1 to 32 per int32 value).
+void npyszentas(std::string         sizes_filename,
+                std::string         values_filename,
+                size_t              K,
+                const size_t* const indices_init,
+                std::string         initialisation_method,
+                std::string         algorithm,
+                size_t              level,
+                size_t              max_proposals,
+                bool                capture_output,
+                std::string&        text,
+                size_t              seed,
+                double              max_time,
+                double              min_mE,
+                double              max_itok,
+                size_t* const       indices_final,
+                size_t* const       labels,
+                std::string         metric,
+                size_t              nthreads,
+                size_t              max_rounds,
+                bool                patient,
+                std::string         energy,
+                bool                with_tests,
+                bool                with_cost_matrices,
+                size_t              dict_size,
+                double              c_indel,
+                double              c_switch,
+                const double* const c_indel_arr,
+                const double* const c_switches_arr,
+                size_t              distance_cache_size,
+                double              critical_radius,
+                double              exponent_coeff,
+                bool                do_balance_labels);
 
 }  // namespace nszen
 
@@ -24,6 +24,8 @@ std::string get_python_txt_seq_string();
 std::string get_python_seq_string();
 std::string get_python_spa_string();
 std::string get_python_den_string();
+std::string get_python_bvec_string();
+std::string get_python_tseries_string();
 }
 
 #endif
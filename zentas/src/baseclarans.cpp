@@ -258,7 +258,7 @@ double BaseClarans::get_delta_hat_l3(
             {
               if (get_d1(k1, j) + get_d2(k1, j) <= dist_k_j2)
               {
-                ndet_sum_delta_i[ki] += energy_margins[k1][j];
+                ndet_sum_delta_i[ki] += energy_margins(k1, j);
               }
               else
               {
@@ -269,7 +269,7 @@ double BaseClarans::get_delta_hat_l3(
                 }
                 else
                 {
-                  ndet_sum_delta_i[ki] += energy_margins[k1][j];
+                  ndet_sum_delta_i[ki] += energy_margins(k1, j);
                 }
               }
             }
@@ -506,7 +506,7 @@ double BaseClarans::get_delta_E_hoeffding_l3(
               ++ndet_n_non_zero[ki];
               if (get_d1(k1, j) + get_d2(k1, j) <= dist_k_j2)
               {
-                ndet_sum_delta_i[ki] += energy_margins[k1][j];
+                ndet_sum_delta_i[ki] += energy_margins(k1, j);
               }
               else
               {
@@ -517,7 +517,7 @@ double BaseClarans::get_delta_E_hoeffding_l3(
                 }
                 else
                 {
-                  ndet_sum_delta_i[ki] += energy_margins[k1][j];
+                  ndet_sum_delta_i[ki] += energy_margins(k1, j);
                 }
               }
             }
@@ -828,17 +828,23 @@ void BaseClarans::update_k_to_sample_info_l2(size_t              j_a,
                                              const double* const dists_centers_old_k_to,
                                              const double* const cc)
 {
-  double adistance;
   size_t a1;
   size_t a2;
   double d1;
   double d2;
+
+  /* all samples of k_to are against the same center, so in one batch */
+  for (size_t j = j_a; j < j_z; ++j)
+  {
+    k_to_thresholds[j] = dists_centers_old_k_to[k_to] + get_d1(k_to, j);
+  }
+  set_center_sample_distances(
+    k_to, k_to, j_a, j_z, k_to_thresholds.data() + j_a, k_to_distances.data() + j_a);
+
   for (size_t j = j_a; j < j_z; ++j)
   {
-    set_center_sample_distance(
-      k_to, k_to, j, dists_centers_old_k_to[k_to] + get_d1(k_to, j), adistance);
     a1 = k_to;
-    d1 = adistance;
+    d1 = k_to_distances[j];
     a2 = get_a2(k_to, j);
     d2 = get_d2(k_to, j);
     set_nearest_12_warmstart(k_to, j, a1, a2, d1, d2, cc);
@@ -996,7 +1002,7 @@ BaseClarans::get_delta_E_k1_l12(size_t k1, size_t k2, size_t j2, double dist_k1_
           /* the proposed center (k2, j2) is defos at least as far as the second nearest */
           if (get_d1(k1, j) + get_d2(k1, j) <= dist_k1_j2)
           {
-            thread_delta_E_k1[ti] += energy_margins[k1][j];
+            thread_delta_E_k1[ti] += energy_margins(k1, j);
           }
           else
           {
@@ -1004,7 +1010,7 @@ BaseClarans::get_delta_E_k1_l12(size_t k1, size_t k2, size_t j2, double dist_k1_
             /* nearest excluding k1 is not (k2, j2) */
             if (adistance > get_d2(k1, j))
             {
-              thread_delta_E_k1[ti] += energy_margins[k1][j];
+              thread_delta_E_k1[ti] += energy_margins(k1, j);
             }
 
             /* nearest excluding k1 is (k2, j2) */
@@ -1130,14 +1136,11 @@ std::string BaseClarans::get_round_summary()
 void BaseClarans::reset_second_nearest_info(
   size_t k, size_t j, size_t k_second_nearest, double d_second_nearest, double e_second_nearest)
 {
-  if (nearest_2_infos[k][j].a_x != k_second_nearest ||
-      nearest_2_infos[k][j].d_x != d_second_nearest)
+  if (get_a2(k, j) != k_second_nearest || get_d2(k, j) != get_as_stored(d_second_nearest))
   {
     signal_cluster_change(k);
   }
-  nearest_2_infos[k][j].a_x = k_second_nearest;
-  nearest_2_infos[k][j].d_x = d_second_nearest;
-  nearest_2_infos[k][j].e_x = e_second_nearest;
+  nearest_2_infos.reset(k, j, k_second_nearest, d_second_nearest, e_second_nearest);
 }
 
 void BaseClarans::set_proposal(size_t& k1, size_t& k2, size_t& j2)
@@ -1197,12 +1200,12 @@ void BaseClarans::custom_ndata_test()
 
   for (size_t k = 0; k < K; ++k)
   {
-    if (energy_margins[k].size() != get_ndata(k))
+    if (energy_margins.size(k) != get_ndata(k))
     {
       mowri << "k = " << k << zentas::Endl;
-      mowri << "size of energy_margins[k] " << energy_margins[k].size() << zentas::Endl;
+      mowri << "size of energy_margins[k] " << energy_margins.size(k) << zentas::Endl;
       mowri << "size of cluster_datas[k] " << get_ndata(k) << zentas::Endl;
-      mowri << "size of nearest_2_infos[k] " << nearest_2_infos[k].size() << zentas::Endl;
+      mowri << "size of nearest_2_infos[k] " << nearest_2_infos.size(k) << zentas::Endl;
 
       throw zentas::zentas_error("custom ndata test failed");
     }
@@ -1225,10 +1228,10 @@ void BaseClarans::clarans_statistics_test()
     {
       for (size_t j = 0; j < get_ndata(k); ++j)
       {
-        M = std::max(M, energy_margins[k][j]);
-        M_star += (nearest_2_infos[k][j].e_x - get_e1(k, j));
+        M = std::max(M, get_e2(k, j) - get_e1(k, j));
+        M_star += (get_e2(k, j) - get_e1(k, j));
         R1 = std::max(R1, get_d1(k, j));
-        R2 = std::max(R2, nearest_2_infos[k][j].d_x);
+        R2 = std::max(R2, get_d2(k, j));
       }
       m      = M / static_cast<double>(get_ndata(k));
       m_star = M_star / static_cast<double>(get_ndata(k));
@@ -1258,8 +1261,7 @@ void BaseClarans::custom_cluster_statistics_test() { clarans_statistics_test();
 
 void BaseClarans::increment_custom_cluster_statistics(size_t k, size_t j)
 {
-  cluster_statistics[k].increment(
-    get_d1(k, j), get_e1(k, j), nearest_2_infos[k][j].d_x, nearest_2_infos[k][j].e_x);
+  cluster_statistics[k].increment(get_d1(k, j), get_e1(k, j), get_d2(k, j), get_e2(k, j));
 
   // if (nearest_2_infos[k][j].e_x - get_e1(k,j) != energy_margins[k][j]){
   // throw zentas::zentas_error("internal problem detected with energy margin");
@@ -1303,7 +1305,7 @@ void BaseClarans::set_second_nearest(size_t              k_first_nearest,
 
 void BaseClarans::refresh_energy_margins(size_t k, size_t j)
 {
-  energy_margins[k][j] = get_e2(k, j) - get_e1(k, j);
+  energy_margins(k, j) = static_cast<InfoFloat>(get_e2(k, j) - get_e1(k, j));
 }
 
 void BaseClarans::center_center_info_test_l1(
@@ -1420,9 +1422,10 @@ void BaseClarans::put_nearest_2_infos_margin_in_cluster_final(size_t k_first_nea
                                                               double e_second_nearest)
 {
 
-  nearest_2_infos[k_first_nearest].emplace_back(
-    k_second_nearest, d_second_nearest, e_second_nearest);
-  energy_margins[k_first_nearest].push_back(e_second_nearest - get_e1_tail(k_first_nearest));
+  nearest_2_infos.append(k_first_nearest, k_second_nearest, d_second_nearest, e_second_nearest);
+  energy_margins.append(
+    k_first_nearest,
+    static_cast<InfoFloat>(get_as_stored(e_second_nearest) - get_e1_tail(k_first_nearest)));
 }
 
 void BaseClarans::put_nearest_2_infos_margin_in_cluster_post_kmeanspp(size_t k1,
@@ -1462,31 +1465,31 @@ void BaseClarans::reset_sample_nearest_2_infos_margin(size_t              k,
 
   reset_second_nearest_info(k, j, k_second_nearest, d_second_nearest, e_second_nearest);
 
-  energy_margins[k][j] = e_second_nearest - get_e1(k, j);
+  refresh_energy_margins(k, j);
 }
 
 void BaseClarans::nearest_2_infos_margin_append(size_t k_new, size_t k, size_t j)
 {
-  nearest_2_infos[k_new].push_back(nearest_2_infos[k][j]);
-  energy_margins[k_new].push_back(energy_margins[k][j]);
+  nearest_2_infos.append_from(k_new, k, j);
+  energy_margins.append(k_new, energy_margins(k, j));
 }
 
 void BaseClarans::nearest_2_infos_margin_replace_with_last(size_t k, size_t j)
 {
-  nearest_2_infos[k][j] = *(nearest_2_infos[k].end() - 1);
-  energy_margins[k][j]  = energy_margins[k].back();
+  nearest_2_infos.replace_with_last(k, j);
+  energy_margins.replace_with_last(k, j);
 }
 
 void BaseClarans::nearest_2_infos_margin_replace_with(size_t k1, size_t j1, size_t k2, size_t j2)
 {
-  nearest_2_infos[k1][j1] = nearest_2_infos[k2][j2];
-  energy_margins[k1][j1]  = energy_margins[k2][j2];
+  nearest_2_infos.replace_with(k1, j1, k2, j2);
+  energy_margins(k1, j1) = energy_margins(k2, j2);
 }
 
 void BaseClarans::nearest_2_infos_margin_remove_last(size_t k)
 {
-  nearest_2_infos[k].pop_back();
-  energy_margins[k].pop_back();
+  nearest_2_infos.remove_last(k);
+  energy_margins.remove_last(k);
 }
 
 void BaseClarans::nearest_2_infos_margin_test()
@@ -1521,7 +1524,7 @@ void BaseClarans::nearest_2_infos_margin_test()
       // throw zentas::zentas_error("k_second_nearest != k_second_nearest");
       //}
 
-      if (d_second_nearest != nearest_2_infos[k][j].d_x)
+      if (get_as_stored(d_second_nearest) != get_d2(k, j))
       {
 
         std::stringstream errm;
@@ -1531,31 +1534,32 @@ void BaseClarans::nearest_2_infos_margin_test()
         errm << "j=" << j << "\n";
         errm << "the " << j << "'th sample in cluster " << k << " is " << string_for_sample(k, j)
              << "\n";
-        errm << "cluster size is " << nearest_2_infos[k].size() << "\n";
+        errm << "cluster size is " << nearest_2_infos.size(k) << "\n";
         errm << std::setprecision(20);
         errm << "get_a1(k,j)=" << get_a1(k, j) << "\n";
         errm << "just computed second nearest center index: " << k_second_nearest << "\n";
         errm << "the " << k_second_nearest
              << "'th center is: " << string_for_center(k_second_nearest) << "\n";
         errm << "just computed distance to this center is: " << d_second_nearest << "\n";
-        errm << "the recorded second nearest center index: " << nearest_2_infos[k][j].a_x << "\n";
-        errm << "the " << nearest_2_infos[k][j].a_x << "'th center is "
-             << string_for_center(nearest_2_infos[k][j].a_x) << "\n";
-        errm << "the recorded distance to this center is " << nearest_2_infos[k][j].d_x << "\n";
+        errm << "the recorded second nearest center index: " << get_a2(k, j) << "\n";
+        errm << "the " << get_a2(k, j) << "'th center is " << string_for_center(get_a2(k, j))
+             << "\n";
+        errm << "the recorded distance to this center is " << get_d2(k, j) << "\n";
 
         throw zentas::zentas_error(errm.str());
       }
 
-      if (e_second_nearest != nearest_2_infos[k][j].e_x)
+      if (get_as_stored(e_second_nearest) != get_e2(k, j) &&
+          get_as_stored(f_energy(get_d2(k, j))) != get_e2(k, j))
       {
         throw zentas::zentas_error("e_second_nearest != e_second_nearest");
       }
 
-      double m_v = nearest_2_infos[k][j].e_x - get_e1(k, j);
-      if (m_v != energy_margins[k][j])
+      double m_v = get_e2(k, j) - get_e1(k, j);
+      if (get_as_stored(m_v) != energy_margins(k, j))
       {
         mowri << "\nk : " << k << " \t j : " << j << zentas::Endl;
-        mowri << "\nm_v : " << m_v << " \t energy_margins[k][j] : " << energy_margins[k][j]
+        mowri << "\nm_v : " << m_v << " \t energy_margins[k][j] : " << energy_margins(k, j)
               << zentas::Endl;
         throw zentas::zentas_error("m_v != energy_margin");
       }
@@ -1592,12 +1596,12 @@ void BaseClarans::basic_clarans_update_sample_info()
             reset_second_nearest_info(k, j, get_a1(k, j), get_d1(k, j), get_e1(k, j));
             reset_nearest_info(k, j, k_to, adistance, f_energy(adistance));
 
-            energy_margins[k][j] = get_e2(k, j) - get_e1(k, j);
+            refresh_energy_margins(k, j);
           }
           else if (adistance < get_d2(k, j))
           {
             reset_second_nearest_info(k, j, k_to, adistance, f_energy(adistance));
-            energy_margins[k][j] = get_e2(k, j) - get_e1(k, j);
+            refresh_energy_margins(k, j);
           }
         }
       }
@@ -1624,7 +1628,7 @@ double BaseClarans::get_delta_E_l0(size_t k1, size_t k2, size_t j2)
     }
     else
     {
-      delta_E += energy_margins[k1][j];
+      delta_E += energy_margins(k1, j);
     }
   }
 
@@ -1742,6 +1746,9 @@ void BaseClarans::update_sample_info_l23(const double* const dists_centers_old_k
     }
   }
 
+  k_to_thresholds.resize(get_ndata(k_to));
+  k_to_distances.resize(get_ndata(k_to));
+
   std::vector<std::thread> threads;
 
   for (size_t ti = 0; ti < get_nthreads(); ++ti)
@@ -1902,9 +1909,20 @@ void BaseClarans::custom_initialise_refinement() { base_clarans_custom_initialis
 
 void BaseClarans::custom_rf_clear_initmem()
 {
-  energy_margins.resize(0);
-  nearest_2_infos.resize(0);
+  energy_margins.clear();
+  nearest_2_infos.clear();
   cluster_statistics.resize(0);
   // TODO level 3 clear cc
 }
+
+void BaseClarans::custom_reserve(const std::vector<size_t>& capacities)
+{
+  nearest_2_infos.reserve(capacities);
+  energy_margins.reserve(capacities);
+}
+
+size_t BaseClarans::get_custom_n_bytes_reallocated()
+{
+  return nearest_2_infos.get_n_bytes_reallocated() + energy_margins.get_n_bytes_reallocated();
+}
 }
@@ -17,7 +17,8 @@ void scrutinize_input_1(const EnergyInitialiser& energy_initialiser,
                         size_t                   K,
                         std::string              algorithm,
                         size_t                   level,
-                        size_t                   ndata)
+                        size_t                   ndata,
+                        bool                     satisfies_triangle_inequality)
 {
 
   if (energy_initialiser.get_critical_radius() <= 0 && energy.compare("squarepotential") == 0)
@@ -57,6 +58,12 @@ void scrutinize_input_1(const EnergyInitialiser& energy_initialiser,
   std::map<std::string, std::vector<size_t>> alg_levs = {
     {{"voronoi", {0}}, {"clarans", {0, 1, 2, 3}}}};
 
+  /* levels 1, 2 and 3 of clarans eliminate clusters and samples with the triangle inequality */
+  if (satisfies_triangle_inequality == false)
+  {
+    alg_levs["clarans"] = {0};
+  }
+
   /* checking for (algorithm, level) compatibility */
   bool algorithm_level_ok = false;
 
@@ -103,6 +110,10 @@ void scrutinize_input_1(const EnergyInitialiser& energy_initialiser,
       }
       errm << "}\n";
     }
+    if (satisfies_triangle_inequality == false)
+    {
+      errm << "(with this metric, which does not satisfy the triangle inequality).\n";
+    }
 
     throw zentas::zentas_error(errm.str());
   }
@@ -0,0 +1,169 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <zentas/distancecache.hpp>
+#include <zentas/zentaserror.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace nszen
+{
+
+constexpr size_t DistanceCache::n_shards;
+constexpr size_t DistanceCache::bucket_size;
+constexpr double DistanceCache::always_valid;
+
+namespace
+{
+/* the finaliser of splitmix64 */
+uint64_t get_mixed(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+}
+
+DistanceCache::DistanceCache(size_t capacity, size_t ndata_)
+  : ndata(ndata_), n_buckets_per_shard(capacity / (n_shards * bucket_size)), shards(n_shards)
+{
+  if (capacity > 0 && n_buckets_per_shard == 0)
+  {
+    std::stringstream errm;
+    errm << "distance_cache_size should be 0 (no cache) or at least " << n_shards * bucket_size
+         << ", not " << capacity;
+    throw zentas::zentas_error(errm.str());
+  }
+
+  if (is_active() && ndata > std::numeric_limits<uint32_t>::max())
+  {
+    throw zentas::zentas_error("the distance cache is not supported with more than 2^32 samples");
+  }
+
+  for (auto& shard : shards)
+  {
+    shard.entries.resize(n_buckets_per_shard * bucket_size);
+  }
+}
+
+uint64_t DistanceCache::get_key(size_t i1, size_t i2) const
+{
+  if (i1 > i2)
+  {
+    std::swap(i1, i2);
+  }
+  /* + 1, as 0 is an empty entry */
+  return static_cast<uint64_t>(i1) * ndata + i2 + 1;
+}
+
+DistanceCache::Shard& DistanceCache::get_shard(uint64_t key)
+{
+  return shards[get_mixed(key) % n_shards];
+}
+
+DistanceCache::Entry* DistanceCache::get_bucket(Shard& shard, uint64_t key) const
+{
+  return shard.entries.data() + ((get_mixed(key) / n_shards) % n_buckets_per_shard) * bucket_size;
+}
+
+bool DistanceCache::get(size_t i1, size_t i2, double threshold, double& distance)
+{
+  uint64_t                    key   = get_key(i1, i2);
+  Shard&                      shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  ++shard.n_queries;
+  Entry* bucket = get_bucket(shard, key);
+  for (size_t b = 0; b < bucket_size; ++b)
+  {
+    if (bucket[b].key == key && threshold <= bucket[b].valid_below)
+    {
+      distance = bucket[b].distance;
+      ++shard.n_hits;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DistanceCache::put(size_t i1, size_t i2, double threshold, double distance)
+{
+  uint64_t                    key         = get_key(i1, i2);
+  double                      valid_below = distance < threshold ? always_valid : threshold;
+  Shard&                      shard       = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Entry*                      bucket = get_bucket(shard, key);
+
+  /* the entry with this key, else an empty entry, else the entry which is valid for the fewest
+   * thresholds */
+  Entry* target = nullptr;
+  for (size_t b = 0; b < bucket_size && target == nullptr; ++b)
+  {
+    if (bucket[b].key == key)
+    {
+      target = bucket + b;
+    }
+  }
+  if (target == nullptr)
+  {
+    /* so that ties do not always evict the same entry */
+    target = bucket + key % bucket_size;
+    for (size_t b = 0; b < bucket_size; ++b)
+    {
+      if (target->key != 0 &&
+          (bucket[b].key == 0 || bucket[b].valid_below < target->valid_below))
+      {
+        target = bucket + b;
+      }
+    }
+  }
+
+  if (target->key != key || valid_below > target->valid_below)
+  {
+    target->key         = key;
+    target->distance    = distance;
+    target->valid_below = valid_below;
+  }
+}
+
+size_t DistanceCache::get_n_queries()
+{
+  size_t n_queries = 0;
+  for (auto& shard : shards)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    n_queries += shard.n_queries;
+  }
+  return n_queries;
+}
+
+size_t DistanceCache::get_n_hits()
+{
+  size_t n_hits = 0;
+  for (auto& shard : shards)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    n_hits += shard.n_hits;
+  }
+  return n_hits;
+}
+
+std::string DistanceCache::get_summary_string()
+{
+  if (!is_active())
+  {
+    return "";
+  }
+  std::stringstream ss;
+  size_t            n_queries = get_n_queries();
+  ss << "hits=" << std::fixed << std::setprecision(3)
+     << (n_queries == 0 ? 0. : static_cast<double>(get_n_hits()) / n_queries);
+  std::string st_hits = ss.str();
+  st_hits.resize(5 + 8, ' ');
+  return st_hits;
+}
+}
@@ -0,0 +1,386 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <zentas/dtw.hpp>
+#include <zentas/zentaserror.hpp>
+
+namespace nszen
+{
+
+DTWInitializer::DTWInitializer(size_t window_) : window(window_) {}
+
+DTWInitializer::DTWInitializer() : DTWInitializer(0) {}
+
+/* The envelope of values (of length size) with radius window : upper[i] and lower[i] are the
+ * max and min of values in [i - window, i + window], for i in [0, n_out). Lemire's streaming
+ * min-max (2006), O(size + n_out) : upper_indices and lower_indices are the monotone deques,
+ * with room for size indices. It requires n_out <= size + window. */
+template <typename TAtomic>
+void set_envelope(const TAtomic* const values,
+                  size_t               size,
+                  size_t               window,
+                  size_t               n_out,
+                  double* const        upper,
+                  double* const        lower,
+                  size_t* const        upper_indices,
+                  size_t* const        lower_indices)
+{
+  size_t upper_head = 0;
+  size_t upper_tail = 0;
+  size_t lower_head = 0;
+  size_t lower_tail = 0;
+  size_t o;
+  for (size_t i = 0; i < n_out + window; ++i)
+  {
+    if (i < size)
+    {
+      while (upper_tail > upper_head && values[upper_indices[upper_tail - 1]] <= values[i])
+      {
+        --upper_tail;
+      }
+      upper_indices[upper_tail++] = i;
+      while (lower_tail > lower_head && values[lower_indices[lower_tail - 1]] >= values[i])
+      {
+        --lower_tail;
+      }
+      lower_indices[lower_tail++] = i;
+    }
+
+    if (i >= window)
+    {
+      o = i - window;
+      while (upper_indices[upper_head] + window < o)
+      {
+        ++upper_head;
+      }
+      while (lower_indices[lower_head] + window < o)
+      {
+        ++lower_head;
+      }
+      upper[o] = static_cast<double>(values[upper_indices[upper_head]]);
+      lower[o] = static_cast<double>(values[lower_indices[lower_head]]);
+    }
+  }
+}
+
+/* LB_Keogh (Keogh 2002) : x[i] is matched to a value in the envelope [lower[i], upper[i]] of
+ * the other series, and the bound is the sum of the squared distances to the envelopes. These
+ * are put in contributions. Returns as soon as the sum reaches threshold. */
+template <typename TAtomic>
+double get_keogh_bound(const TAtomic* const x,
+                       size_t               size,
+                       const double* const  upper,
+                       const double* const  lower,
+                       double               threshold,
+                       double* const        contributions)
+{
+  double bound = 0;
+  double v;
+  for (size_t i = 0; i < size; ++i)
+  {
+    v                = static_cast<double>(x[i]);
+    contributions[i] = v > upper[i] ? (v - upper[i]) * (v - upper[i])
+                                    : v < lower[i] ? (lower[i] - v) * (lower[i] - v) : 0;
+    bound += contributions[i];
+    if (bound >= threshold)
+    {
+      break;
+    }
+  }
+  return bound;
+}
+
+/* The buffers and counters of one thread of DTWMetric_X, claimed as the Levenshtein slots
+ * are (see levenshtein.cpp). */
+class DTWSlot
+{
+  public:
+  std::atomic<bool> busy{false};
+
+  size_t ncalcs            = 0;
+  size_t n_cells_visited   = 0;
+  size_t n_cells_visitable = 0;
+
+  std::vector<double> upper;
+  std::vector<double> lower;
+  std::vector<size_t> upper_indices;
+  std::vector<size_t> lower_indices;
+  std::vector<double> contributions_x;
+  std::vector<double> contributions_y;
+  /* remaining[i] is the sum of the contributions of rows i, i + 1, ... of the DP */
+  std::vector<double> remaining;
+  std::vector<double> D_prev;
+  std::vector<double> D_acti;
+
+  /* keep the busy flags and counters of neighbouring slots off each others' cache lines */
+  char padding[64];
+};
+
+template <typename TSDataIn>
+class DTWMetric_X
+{
+
+  private:
+  size_t                                window;
+  size_t                                max_size;
+  size_t                                nthreads;
+  std::vector<std::unique_ptr<DTWSlot>> v_slots;
+
+  DTWSlot& acquire_slot()
+  {
+    static thread_local size_t slot_hint =
+      std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    size_t slot_i = slot_hint % nthreads;
+    while (v_slots[slot_i]->busy.exchange(true, std::memory_order_acquire) == true)
+    {
+      ++slot_i;
+      slot_i %= nthreads;
+    }
+    slot_hint = slot_i;
+
+    DTWSlot& slot = *v_slots[slot_i];
+    if (slot.D_acti.size() < max_size)
+    {
+      for (auto v : {&slot.upper,
+                     &slot.lower,
+                     &slot.contributions_x,
+                     &slot.contributions_y,
+                     &slot.D_prev,
+                     &slot.D_acti})
+      {
+        v->resize(max_size);
+      }
+      slot.remaining.resize(max_size + 1);
+      slot.upper_indices.resize(max_size);
+      slot.lower_indices.resize(max_size);
+    }
+    return slot;
+  }
+
+  void release_slot(DTWSlot& slot) { slot.busy.store(false, std::memory_order_release); }
+
+  using TAtomic = typename TSDataIn::AtomicType;
+
+  /* the banded DP of rows x and columns y. Abandoned when the smallest cell of a row, plus the
+   * LB_Keogh contributions of the rows below it, reaches threshold. */
+  double get_dp_distance(const TAtomic* const x,
+                         size_t               n,
+                         const TAtomic* const y,
+                         size_t               m,
+                         size_t               band,
+                         double               threshold,
+                         DTWSlot&             slot,
+                         size_t&              n_cells_visited_local) const
+  {
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    double*          D_prev   = slot.D_prev.data();
+    double*          D_acti   = slot.D_acti.data();
+    size_t           prev_end = 0;
+    size_t           j_begin;
+    size_t           j_end;
+    double           row_min;
+    double           best;
+    double           difference;
+    for (size_t i = 0; i < n; ++i)
+    {
+      j_begin = i > band ? i - band : 0;
+      j_end   = std::min(m, i + band + 1);
+      row_min = infinity;
+      for (size_t j = j_begin; j < j_end; ++j)
+      {
+        if (i == 0)
+        {
+          best = j == 0 ? 0 : D_acti[j - 1];
+        }
+        else
+        {
+          best = j < prev_end ? D_prev[j] : infinity;
+          if (j > j_begin)
+          {
+            best = std::min(best, D_acti[j - 1]);
+          }
+          if (j > 0 && j - 1 < prev_end)
+          {
+            best = std::min(best, D_prev[j - 1]);
+          }
+        }
+        difference = static_cast<double>(x[i]) - static_cast<double>(y[j]);
+        D_acti[j]  = best + difference * difference;
+        row_min    = std::min(row_min, D_acti[j]);
+      }
+      n_cells_visited_local += j_end - j_begin;
+
+      if (row_min + slot.remaining[i + 1] >= threshold)
+      {
+        return row_min + slot.remaining[i + 1];
+      }
+      prev_end = j_end;
+      std::swap(D_prev, D_acti);
+    }
+    return D_prev[m - 1];
+  }
+
+  public:
+  typedef typename TSDataIn::Sample Sample;
+  typedef DTWInitializer            Initializer;
+
+  DTWMetric_X(const TSDataIn& datain, size_t nthreads_, const DTWInitializer& di)
+    : window(di.window), max_size(datain.get_max_size()), nthreads(nthreads_)
+  {
+    for (size_t ti = 0; ti < nthreads; ++ti)
+    {
+      v_slots.emplace_back(new DTWSlot);
+    }
+  }
+
+  void set_distance(const Sample& a, const Sample& b, double threshold, double& distance)
+  {
+    if (a.size == 0 || b.size == 0)
+    {
+      throw zentas::zentas_error("dtw is not defined for empty time series");
+    }
+
+    const TAtomic* x    = a.values;
+    const TAtomic* y    = b.values;
+    size_t         n    = a.size;
+    size_t         m    = b.size;
+    size_t         band = std::max(window, std::max(n, m) - std::min(n, m));
+
+    /* the bounds and the DP are in squared units */
+    double sq_threshold = threshold * threshold;
+    double sq_distance;
+    size_t n_cells_visited_local = 0;
+
+    DTWSlot& slot = acquire_slot();
+
+    /* LB_Kim : the first and last points are matched (distinct cells unless a length is 1) */
+    double first = static_cast<double>(x[0]) - static_cast<double>(y[0]);
+    double last  = static_cast<double>(x[n - 1]) - static_cast<double>(y[m - 1]);
+    sq_distance  = n > 1 && m > 1 ? first * first + last * last
+                                  : std::max(first * first, last * last);
+
+    if (sq_distance < sq_threshold)
+    {
+      /* LB_Keogh, both ways round. The DP has as rows the series with the larger bound. */
+      set_envelope(y,
+                   m,
+                   band,
+                   n,
+                   slot.upper.data(),
+                   slot.lower.data(),
+                   slot.upper_indices.data(),
+                   slot.lower_indices.data());
+      double bound_x = get_keogh_bound(
+        x, n, slot.upper.data(), slot.lower.data(), sq_threshold, slot.contributions_x.data());
+
+      double bound_y = 0;
+      if (bound_x < sq_threshold)
+      {
+        set_envelope(x,
+                     n,
+                     band,
+                     m,
+                     slot.upper.data(),
+                     slot.lower.data(),
+                     slot.upper_indices.data(),
+                     slot.lower_indices.data());
+        bound_y = get_keogh_bound(
+          y, m, slot.upper.data(), slot.lower.data(), sq_threshold, slot.contributions_y.data());
+      }
+
+      sq_distance = std::max(sq_distance, std::max(bound_x, bound_y));
+      if (sq_distance < sq_threshold)
+      {
+        if (bound_y > bound_x)
+        {
+          std::swap(x, y);
+          std::swap(n, m);
+          std::swap(slot.contributions_x, slot.contributions_y);
+        }
+        slot.remaining[n] = 0;
+        for (size_t i = n; i-- > 0;)
+        {
+          slot.remaining[i] = slot.remaining[i + 1] + slot.contributions_x[i];
+        }
+        sq_distance =
+          get_dp_distance(x, n, y, m, band, sq_threshold, slot, n_cells_visited_local);
+      }
+    }
+
+    ++slot.ncalcs;
+    slot.n_cells_visitable += n * std::min(m, 2 * band + 1);
+    slot.n_cells_visited += n_cells_visited_local;
+    release_slot(slot);
+
+    /* as with Levenshtein, so that the order of a and b (and of the sums) does not matter */
+    distance = static_cast<double>(static_cast<float>(std::sqrt(sq_distance)));
+  }
+
+  size_t get_ncalcs() const
+  {
+    size_t ncalcs = 0;
+    for (auto& slot : v_slots)
+    {
+      ncalcs += slot->ncalcs;
+    }
+    return ncalcs;
+  }
+
+  /* the cells of the DP visited, relative to the cells in the band */
+  double get_rel_calccosts() const
+  {
+    size_t n_cells_visited   = 0;
+    size_t n_cells_visitable = 0;
+    for (auto& slot : v_slots)
+    {
+      n_cells_visited += slot->n_cells_visited;
+      n_cells_visitable += slot->n_cells_visitable;
+    }
+    return static_cast<double>(n_cells_visited) /
+           static_cast<double>(std::max<size_t>(1, n_cells_visitable));
+  }
+};
+
+template <typename TSDataIn>
+DTWMetric<TSDataIn>::DTWMetric(const TSDataIn& datain, size_t nthreads, const DTWInitializer& di)
+{
+  dtwm.reset(new DTWMetric_X<TSDataIn>(datain, nthreads, di));
+}
+
+template <typename TSDataIn>
+void DTWMetric<TSDataIn>::set_distance(const Sample& a,
+                                       const Sample& b,
+                                       double        threshold,
+                                       double&       distance)
+{
+  dtwm->set_distance(a, b, threshold, distance);
+}
+
+template <typename TSDataIn>
+size_t DTWMetric<TSDataIn>::get_ncalcs()
+{
+  return dtwm->get_ncalcs();
+}
+
+template <typename TSDataIn>
+double DTWMetric<TSDataIn>::get_rel_calccosts()
+{
+  return dtwm->get_rel_calccosts();
+}
+
+template <typename TSDataIn>
+DTWMetric<TSDataIn>::~DTWMetric() = default;
+
+template class DTWMetric<nszen::TimeSeriesDataUnrootedIn<float>>;
+template class DTWMetric<nszen::TimeSeriesDataUnrootedIn<double>>;
+template class DTWMetric<nszen::TimeSeriesDataRootedIn<float>>;
+template class DTWMetric<nszen::TimeSeriesDataRootedIn<double>>;
+}
@@ -1,7 +1,10 @@
 // Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
 // Written by James Newling <jnewling@idiap.ch>
 
+#include <sstream>
 #include <zentas/energyinit.hpp>
+#include <zentas/tenergyfunc.hpp>
+#include <zentas/zentaserror.hpp>
 
 namespace nszen
 {
@@ -15,4 +18,54 @@ EnergyInitialiser::EnergyInitialiser(double cr, double ec)
 double EnergyInitialiser::get_critical_radius() const { return critical_radius; }
 
 double EnergyInitialiser::get_exponent_coeff() const { return exponent_coeff; }
+
+std::function<double(double)> get_f_energy(const std::string&       energy,
+                                           const EnergyInitialiser& energy_initialiser)
+{
+  if (energy.compare("identity") == 0)
+  {
+    return nszen::Identity();
+  }
+
+  else if (energy.compare("quadratic") == 0)
+  {
+    return nszen::Quadratic();
+  }
+
+  else if (energy.compare("cubic") == 0)
+  {
+    return nszen::Cubic();
+  }
+
+  else if (energy.compare("squarepotential") == 0)
+  {
+    return nszen::SquarePotential(energy_initialiser.get_critical_radius());
+  }
+
+  else if (energy.compare("log") == 0)
+  {
+    return nszen::Log();
+  }
+
+  else if (energy.compare("exp") == 0)
+  {
+    return nszen::Exponential(energy_initialiser.get_exponent_coeff());
+  }
+
+  else if (energy.compare("sqrt") == 0)
+  {
+    return nszen::SquareRoot();
+  }
+
+  else
+  {
+    std::stringstream errmss;
+    errmss << "Unrecognised energy function, `" << energy << "'. ";
+    if (energy == "linear")
+    {
+      errmss << "Perhaps instead of `linear' you meant `identity'?";
+    }
+    throw zentas::zentas_error(errmss.str());
+  }
+}
 }
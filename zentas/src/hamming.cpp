@@ -0,0 +1,277 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <zentas/hamming.hpp>
+#include <zentas/zentaserror.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ZENTAS_HAMMING_X86
+/* gcc 12 has spurious -W(maybe-)uninitialized warnings in avx512fintrin.h */
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+#include <immintrin.h>
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+#define ZENTAS_TARGET_POPCNT __attribute__((target("popcnt")))
+#define ZENTAS_TARGET_AVX512_POPCNT __attribute__((target("avx512f,avx512vpopcntdq")))
+#endif
+
+namespace nszen
+{
+
+HammingInitializer::HammingInitializer(size_t field_width_, size_t n_fields_)
+  : field_width(field_width_), n_fields(n_fields_)
+{
+}
+
+HammingInitializer::HammingInitializer() : HammingInitializer(1, 0) {}
+
+namespace hamming
+{
+
+/* the lowest bit of each field */
+template <size_t W>
+constexpr uint64_t get_low_bits()
+{
+  return ~uint64_t(0) / ((W == 64 ? ~uint64_t(0) : (uint64_t(1) << W) - 1));
+}
+
+/* x is the xor of two words. The lowest bit of each field is set to the or of the bits of the
+ * field, the other bits are cleared. */
+template <size_t W>
+inline uint64_t get_field_mismatches(uint64_t x)
+{
+  for (size_t shift = W / 2; shift > 0; shift /= 2)
+  {
+    x |= x >> shift;
+  }
+  return x & get_low_bits<W>();
+}
+
+/* without a target popcnt, __builtin_popcountll is a call to a portable bit trick. */
+template <size_t W>
+inline size_t scalar_count(const uint64_t* a, const uint64_t* b, size_t w_begin, size_t w_end)
+{
+  size_t count = 0;
+  for (size_t w = w_begin; w < w_end; ++w)
+  {
+    count += __builtin_popcountll(get_field_mismatches<W>(a[w] ^ b[w]));
+  }
+  return count;
+}
+
+template <size_t W>
+inline size_t scalar_hamming(
+  const uint64_t* a, const uint64_t* b, size_t n_words, size_t threshold, size_t& n_visited)
+{
+  size_t distance = 0;
+  size_t w_end;
+  for (size_t w = 0; w < n_words; w = w_end)
+  {
+    w_end = std::min(w + block_size, n_words);
+    distance += scalar_count<W>(a, b, w, w_end);
+    if (distance > threshold)
+    {
+      n_visited = w_end;
+      return distance;
+    }
+  }
+  n_visited = n_words;
+  return distance;
+}
+
+template <size_t W>
+size_t portable_hamming(
+  const uint64_t* a, const uint64_t* b, size_t n_words, size_t threshold, size_t& n_visited)
+{
+  return scalar_hamming<W>(a, b, n_words, threshold, n_visited);
+}
+
+#ifdef ZENTAS_HAMMING_X86
+
+template <size_t W>
+ZENTAS_TARGET_POPCNT size_t popcnt_hamming(
+  const uint64_t* a, const uint64_t* b, size_t n_words, size_t threshold, size_t& n_visited)
+{
+  return scalar_hamming<W>(a, b, n_words, threshold, n_visited);
+}
+
+/* 8 words per register, 2 registers per block. The last (partial) registers are masked loads,
+ * so there is no scalar tail. */
+template <size_t W>
+ZENTAS_TARGET_AVX512_POPCNT size_t avx512_hamming(
+  const uint64_t* a, const uint64_t* b, size_t n_words, size_t threshold, size_t& n_visited)
+{
+  const __m512i low_bits = _mm512_set1_epi64(static_cast<long long>(get_low_bits<W>()));
+  __m512i       acc      = _mm512_setzero_si512();
+  __m512i       x;
+  __mmask8      mask;
+  size_t        w_end;
+  for (size_t w = 0; w < n_words; w = w_end)
+  {
+    w_end = std::min(w + block_size, n_words);
+    for (size_t r = w; r < w_end; r += 8)
+    {
+      mask = static_cast<__mmask8>(w_end - r >= 8 ? 0xff : (1u << (w_end - r)) - 1);
+      x    = _mm512_xor_si512(_mm512_maskz_loadu_epi64(mask, a + r),
+                           _mm512_maskz_loadu_epi64(mask, b + r));
+      for (size_t shift = W / 2; shift > 0; shift /= 2)
+      {
+        x = _mm512_or_si512(x, _mm512_srli_epi64(x, static_cast<unsigned>(shift)));
+      }
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_and_si512(x, low_bits)));
+    }
+    if (static_cast<size_t>(_mm512_reduce_add_epi64(acc)) > threshold)
+    {
+      n_visited = w_end;
+      return static_cast<size_t>(_mm512_reduce_add_epi64(acc));
+    }
+  }
+  n_visited = n_words;
+  return static_cast<size_t>(_mm512_reduce_add_epi64(acc));
+}
+
+#endif
+
+enum class Isa
+{
+  avx512vpopcntdq,
+  popcnt,
+  portable
+};
+
+Isa detect_isa()
+{
+#ifdef ZENTAS_HAMMING_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq"))
+  {
+    return Isa::avx512vpopcntdq;
+  }
+  if (__builtin_cpu_supports("popcnt"))
+  {
+    return Isa::popcnt;
+  }
+#endif
+  return Isa::portable;
+}
+
+Isa get_isa()
+{
+  static const Isa isa = detect_isa();
+  return isa;
+}
+
+std::string get_hamming_isa()
+{
+  switch (get_isa())
+  {
+  case Isa::avx512vpopcntdq: return "avx512vpopcntdq";
+  case Isa::popcnt: return "popcnt";
+  default: return "portable";
+  }
+}
+
+template <size_t W>
+HammingKernel get_hamming_kernel()
+{
+#ifdef ZENTAS_HAMMING_X86
+  if (get_isa() == Isa::avx512vpopcntdq)
+  {
+    return avx512_hamming<W>;
+  }
+  if (get_isa() == Isa::popcnt)
+  {
+    return popcnt_hamming<W>;
+  }
+#endif
+  return portable_hamming<W>;
+}
+
+HammingKernel get_hamming_kernel(size_t field_width)
+{
+  switch (field_width)
+  {
+  case 1: return get_hamming_kernel<1>();
+  case 2: return get_hamming_kernel<2>();
+  case 4: return get_hamming_kernel<4>();
+  case 8: return get_hamming_kernel<8>();
+  case 16: return get_hamming_kernel<16>();
+  case 32: return get_hamming_kernel<32>();
+  default:
+    throw zentas::zentas_error("the field width of the hamming metric should be one of 1, 2, "
+                               "4, 8, 16 and 32, not " +
+                               std::to_string(field_width));
+  }
+}
+
+template <typename TAtomic>
+void set_packed_sequences(size_t                 ndata,
+                          const size_t* const    sizes,
+                          const TAtomic* const   data,
+                          std::vector<uint64_t>& packed,
+                          size_t&                field_width,
+                          size_t&                n_words)
+{
+  size_t size = ndata == 0 ? 0 : sizes[0];
+  for (size_t i = 0; i < ndata; ++i)
+  {
+    if (sizes[i] != size)
+    {
+      std::stringstream errm;
+      errm << "the hamming metric requires sequences of equal length, but sequence 0 is of "
+              "length "
+           << size << " and sequence " << i << " is of length " << sizes[i];
+      throw zentas::zentas_error(errm.str());
+    }
+  }
+
+  std::vector<TAtomic> symbols(data, data + ndata * size);
+  std::sort(symbols.begin(), symbols.end());
+  symbols.resize(std::unique(symbols.begin(), symbols.end()) - symbols.begin());
+
+  field_width = 1;
+  while ((uint64_t(1) << field_width) < symbols.size())
+  {
+    field_width *= 2;
+  }
+
+  size_t fields_per_word = 64 / field_width;
+  n_words                = (size + fields_per_word - 1) / fields_per_word;
+  packed.assign(ndata * n_words, 0);
+
+  uint64_t code;
+  for (size_t i = 0; i < ndata; ++i)
+  {
+    for (size_t d = 0; d < size; ++d)
+    {
+      code = std::lower_bound(symbols.begin(), symbols.end(), data[i * size + d]) -
+             symbols.begin();
+      packed[i * n_words + d / fields_per_word] |= code
+                                                   << (field_width * (d % fields_per_word));
+    }
+  }
+}
+
+template void set_packed_sequences(size_t,
+                                   const size_t* const,
+                                   const char* const,
+                                   std::vector<uint64_t>&,
+                                   size_t&,
+                                   size_t&);
+
+template void set_packed_sequences(size_t,
+                                   const size_t* const,
+                                   const int* const,
+                                   std::vector<uint64_t>&,
+                                   size_t&,
+                                   size_t&);
+}
+}
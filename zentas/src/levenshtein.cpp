@@ -1,17 +1,25 @@
 // Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
 // Written by James Newling <jnewling@idiap.ch>
 
+#include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
-#include <mutex>
-#include <random>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include <zentas/levenshtein.hpp>
 #include <zentas/zentaserror.hpp>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ZENTAS_LEVENSHTEIN_X86
+#include <immintrin.h>
+#define ZENTAS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 namespace nszen
 {
 
@@ -160,16 +168,18 @@ LevenshteinInitializer::LevenshteinInitializer()
 {
 }
 
+/* the costs are double, or int32_t for the integer DP (see get_integer_cost_unit) */
+template <typename TCost>
 class MultiIndel
 {
   private:
-  const double* values;
+  const TCost* values;
 
   public:
-  MultiIndel(const double* const vs) : values(vs) {}
+  MultiIndel(const TCost* const vs) : values(vs) {}
   MultiIndel() {}
 
-  double operator()(size_t i) const { return values[i]; }
+  TCost operator()(size_t i) const { return values[i]; }
 };
 
 /* dict_size x dict_size switch costs for Levenshtein */
@@ -185,46 +195,86 @@ class MultiSwitch
   double operator()(size_t i, size_t j) const { return values[i * dict_size + j]; }
 };
 
+template <typename TCost>
 class ConstIndel
 {
   private:
-  double value;
+  TCost value;
 
   public:
-  ConstIndel(double val) : value(val) {}
+  ConstIndel(TCost val) : value(val) {}
   ConstIndel() {}
 
-  double operator()(size_t) const { return value; }
+  TCost operator()(size_t) const { return value; }
 };
 
+template <typename TCost>
 class ConstSwitch
 {
   private:
-  double value;
+  TCost value;
 
   public:
-  ConstSwitch(double v) : value(v) {}
+  ConstSwitch(TCost v) : value(v) {}
+  ConstSwitch() {}
 
-  double operator()(int i, int j) const { return value * (i != j); }
+  TCost operator()(int i, int j) const { return value * (i != j); }
 };
 
-/* Random comment. The use of min_c_indel might not be the optimal strategy in Levenshtein */
-template <class TSample, class TIndelCost, class TSwitchCost>
+/* The largest unit of which all costs are integer multiples, among the smallest positive cost
+ * divided by 1, 2, ..., 64 (so that costs such as 0.5 and 1.5, or 0.2 and 0.3, have units).
+ * Returns 0 if there is no such unit, or if a cost is more than max_units units. */
+double get_integer_cost_unit(const std::vector<double>& costs, double max_units)
+{
+  double min_cost = std::numeric_limits<double>::max();
+  for (auto& c : costs)
+  {
+    if (c > 0)
+    {
+      min_cost = std::min(min_cost, c);
+    }
+  }
+  if (min_cost == std::numeric_limits<double>::max())
+  {
+    return 0;
+  }
+
+  for (int k = 1; k <= 64; ++k)
+  {
+    double unit     = min_cost / k;
+    bool   is_multi = true;
+    for (auto& c : costs)
+    {
+      double units = c / unit;
+      is_multi     = is_multi && units <= max_units &&
+                 std::abs(units - std::round(units)) <= 1e-9 * std::max(1., units);
+    }
+    if (is_multi)
+    {
+      return unit;
+    }
+  }
+  return 0;
+}
+
+/* Random comment. The use of min_c_indel might not be the optimal strategy in Levenshtein.
+ * TCell is double, or int32_t when the costs are in integer units. */
+template <class TSample, typename TCell, class TIndelCost, class TSwitchCost>
 void set_levenshtein_distance(const TSample&    v_vertical,
                               const TSample&    v_horizontal,
-                              double            threshold,
+                              TCell             threshold,
                               size_t            dict_size,
                               const TIndelCost  f_c_indel,
-                              double            min_c_indel,
-                              double            max_c_indel,
+                              TCell             min_c_indel,
+                              TCell             max_c_indel,
                               const TSwitchCost f_c_switch,
-                              double*           A_prev,
-                              double*           A_acti,
+                              TCell*            A_prev,
+                              TCell*            A_acti,
                               int               nrows,
                               int               ncols,
                               // size_t&           n_cells_visited_local,
-                              int&    n_cells_visited_local,
-                              double& distance)
+                              int&   n_cells_visited_local,
+                              TCell& distance)
 {
 
   (void)dict_size;
@@ -236,7 +286,7 @@ void set_levenshtein_distance(const TSample&    v_vertical,
                                "set_levenshtein_distnance, ie shorter sequence first");
   }
 
-  threshold = std::min(threshold, max_c_indel * (nrows + ncols));
+  threshold = std::min<TCell>(threshold, max_c_indel * (nrows + ncols));
   if (min_c_indel * length_difference >= threshold)
   {
     distance = threshold;
@@ -246,7 +296,9 @@ void set_levenshtein_distance(const TSample&    v_vertical,
   {
     int j_start;
     int j_end;
-    int half_width = std::min(ncols - 1, static_cast<int>(std::floor(threshold / min_c_indel)));
+    int half_width = std::min(
+      ncols - 1,
+      static_cast<int>(std::floor(static_cast<double>(threshold) / min_c_indel)));
     int width      = 3 + 2 * half_width;
     std::fill(A_prev, A_prev + width, threshold);
     std::fill(A_acti, A_acti + width, threshold);
@@ -256,9 +308,9 @@ void set_levenshtein_distance(const TSample&    v_vertical,
     {
       A_acti[j] = A_acti[j - 1] + f_c_indel(v_horizontal.values[j - 2 - half_width]);
     }
-    int    row          = 0;
-    int    column       = 0;
-    double min_distance = 0;
+    int   row          = 0;
+    int   column       = 0;
+    TCell min_distance = 0;
     while (row < nrows && min_distance < threshold)
     {
 
@@ -292,50 +344,764 @@ void set_levenshtein_distance(const TSample&    v_vertical,
   }
 }
 
+/* Bit-parallel Levenshtein (Myers 1999, in the global distance form of Hyyro 2001), for when
+ * the indel and switch costs are all the same. The pattern (the shorter sequence) runs down the
+ * columns in blocks of 64 rows. Pv and Mv are the +1 and -1 vertical differences of a column,
+ * and a column is processed per block with a few word operations, instead of cell by cell. */
+
+/* The distinct values of a pattern, and the index of a value among them (size() if not in it) */
+template <typename TAtomic>
+class PatternSymbols
+{
+  private:
+  std::vector<TAtomic> symbols;
+
+  public:
+  void set(const TAtomic* const values, size_t size)
+  {
+    symbols.assign(values, values + size);
+    std::sort(symbols.begin(), symbols.end());
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+  }
+
+  size_t size() const { return symbols.size(); }
+
+  size_t get_index(TAtomic x) const
+  {
+    auto it = std::lower_bound(symbols.begin(), symbols.end(), x);
+    return (it != symbols.end() && *it == x) ? static_cast<size_t>(it - symbols.begin())
+                                              : symbols.size();
+  }
+
+  /* clear before the next set */
+  void clear() {}
+};
+
+/* for char, a look-up table (storing index + 1) in place of the binary search */
+template <>
+class PatternSymbols<char>
+{
+  private:
+  std::vector<char>   symbols;
+  std::vector<size_t> table = std::vector<size_t>(256, 0);
+
+  static size_t slot(char x) { return static_cast<unsigned char>(x); }
+
+  public:
+  void set(const char* const values, size_t size)
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      if (table[slot(values[i])] == 0)
+      {
+        symbols.push_back(values[i]);
+        table[slot(values[i])] = symbols.size();
+      }
+    }
+  }
+
+  size_t size() const { return symbols.size(); }
+
+  size_t get_index(char x) const
+  {
+    return table[slot(x)] == 0 ? symbols.size() : table[slot(x)] - 1;
+  }
+
+  void clear()
+  {
+    for (auto& x : symbols)
+    {
+      table[slot(x)] = 0;
+    }
+    symbols.clear();
+  }
+};
+
+/* per thread memory for set_bit_parallel_levenshtein_distance */
+template <typename TAtomic>
+class BitParallelWorkspace
+{
+  public:
+  PatternSymbols<TAtomic> symbols;
+  /* peq[nblocks*s + b] : the rows of block b where the pattern is symbol s */
+  std::vector<uint64_t> peq;
+  std::vector<uint64_t> pv;
+  std::vector<uint64_t> mv;
+  /* the distance at the last row of each block */
+  std::vector<int> scores;
+};
+
+/* advance block (Pv, Mv) by one column. h_in is the horizontal difference entering the top of
+ * the block, the horizontal difference leaving the row last_bit is returned. */
+inline int advance_bit_parallel_block(
+  uint64_t& pv, uint64_t& mv, uint64_t eq, int h_in, uint64_t last_bit)
+{
+  uint64_t xv = eq | mv;
+  if (h_in < 0)
+  {
+    eq |= 1;
+  }
+  uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+  uint64_t ph = mv | ~(xh | pv);
+  uint64_t mh = pv & xh;
+
+  int h_out = 0;
+  if (ph & last_bit)
+  {
+    h_out = 1;
+  }
+  else if (mh & last_bit)
+  {
+    h_out = -1;
+  }
+
+  ph <<= 1;
+  mh <<= 1;
+  if (h_in < 0)
+  {
+    mh |= 1;
+  }
+  else if (h_in > 0)
+  {
+    ph |= 1;
+  }
+
+  pv = mh | ~(xv | ph);
+  mv = ph & xv;
+  return h_out;
+}
+
+/* unit cost Levenshtein distance between the shorter v_vertical (nrows) and v_horizontal
+ * (ncols), stopping as soon as it is certain to be at least threshold, in which case distance is
+ * threshold. The bits above the last row of the final block are junk, but as bits only affect
+ * higher bits, they never reach the rows which are read. */
+template <typename TSample, typename TAtomic>
+void set_bit_parallel_levenshtein_distance(const TSample&                 v_vertical,
+                                           const TSample&                 v_horizontal,
+                                           int                            threshold,
+                                           BitParallelWorkspace<TAtomic>& ws,
+                                           int                            nrows,
+                                           int                            ncols,
+                                           int&                           n_cells_visited_local,
+                                           int&                           distance)
+{
+
+  if (ncols - nrows >= threshold)
+  {
+    distance = threshold;
+    return;
+  }
+
+  size_t nblocks = static_cast<size_t>((nrows + 63) / 64);
+
+  ws.symbols.set(v_vertical.values, static_cast<size_t>(nrows));
+  size_t n_symbols = ws.symbols.size();
+
+  /* the final row of peq (for symbols not in the pattern) is zero */
+  ws.peq.resize(std::max(ws.peq.size(), nblocks * (n_symbols + 1)));
+  std::fill(ws.peq.begin(), ws.peq.begin() + nblocks * (n_symbols + 1), 0);
+  for (int i = 0; i < nrows; ++i)
+  {
+    ws.peq[nblocks * ws.symbols.get_index(v_vertical.values[i]) + i / 64] |= uint64_t(1)
+                                                                             << (i % 64);
+  }
+
+  uint64_t last_bit = uint64_t(1) << ((nrows - 1) % 64);
+
+  int column = 0;
+  int lower_bound;
+  int offset;
+
+  /* The path to D[nrows][ncols] passes through row i of a column at a cost of at least
+   * D[i][column] + |(nrows - i) - (ncols - column)|. Within a block, D[i][column] is at least
+   * the score at the bottom of the block less the rows between, and at least the score at the
+   * bottom of the previous block (or D[0][column] = column) less the rows between. */
+
+  /* a single block, kept in registers */
+  if (nblocks == 1)
+  {
+    uint64_t pv    = ~uint64_t(0);
+    uint64_t mv    = 0;
+    int      score = nrows;
+    do
+    {
+      score += advance_bit_parallel_block(
+        pv, mv, ws.peq[ws.symbols.get_index(v_horizontal.values[column])], 1, last_bit);
+      ++column;
+      offset      = nrows - ncols + column;
+      lower_bound = std::min(column + std::abs(offset),
+                             std::max(score - nrows + 1 + std::abs(offset - 1), ncols - nrows));
+    } while (column < ncols && lower_bound < threshold);
+    ws.scores.assign(1, score);
+  }
+
+  else
+  {
+    ws.pv.assign(nblocks, ~uint64_t(0));
+    ws.mv.assign(nblocks, 0);
+    ws.scores.resize(nblocks);
+    for (size_t b = 0; b < nblocks; ++b)
+    {
+      ws.scores[b] = std::min(nrows, 64 * static_cast<int>(b + 1));
+    }
+
+    int h;
+    int top;
+    int bottom;
+    do
+    {
+      const uint64_t* eq =
+        ws.peq.data() + nblocks * ws.symbols.get_index(v_horizontal.values[column]);
+      ++column;
+
+      /* D[0][column] = column, so +1 enters the top block */
+      h = 1;
+      for (size_t b = 0; b + 1 < nblocks; ++b)
+      {
+        h = advance_bit_parallel_block(ws.pv[b], ws.mv[b], eq[b], h, uint64_t(1) << 63);
+        ws.scores[b] += h;
+      }
+      ws.scores[nblocks - 1] += advance_bit_parallel_block(
+        ws.pv[nblocks - 1], ws.mv[nblocks - 1], eq[nblocks - 1], h, last_bit);
+
+      offset      = nrows - ncols + column;
+      lower_bound = column + std::abs(offset);
+      for (size_t b = 0; b < nblocks; ++b)
+      {
+        top    = 64 * static_cast<int>(b) + 1;
+        bottom = std::min(nrows, top + 63);
+        lower_bound =
+          std::min(lower_bound,
+                   std::max(ws.scores[b] - bottom + top + std::abs(offset - top),
+                            (b == 0 ? column : ws.scores[b - 1]) + top - 1 - bottom +
+                              std::abs(offset - bottom)));
+      }
+    } while (column < ncols && lower_bound < threshold);
+  }
+
+  n_cells_visited_local += nrows * column;
+  distance = column == ncols ? std::min(threshold, ws.scores[nblocks - 1]) : threshold;
+  ws.symbols.clear();
+}
+
+/* Levenshtein with matrices of costs, by anti-diagonals. The cells of an anti-diagonal
+ * (row + column = d) depend only on the previous two anti-diagonals, so they can be computed
+ * independently of each other, 4 at a time with avx2. Anti-diagonals are stored by row. The
+ * switch costs are gathered from the dict_size x dict_size matrix, at the offsets
+ * dict_size * vertical symbol + horizontal symbol. The horizontal sequence is stored in reverse,
+ * so that its symbols (and indel costs) are contiguous along an anti-diagonal. */
+template <typename TCell>
+class AntiDiagonalWorkspace
+{
+  public:
+  /* dict_size * symbol, per row */
+  std::vector<int> vertical_offsets;
+  /* symbol, per column, last column first */
+  std::vector<int>   horizontal_reversed;
+  std::vector<TCell> vertical_indel;
+  std::vector<TCell> horizontal_indel_reversed;
+  /* three anti-diagonals, each indexed by row + 1 */
+  std::vector<TCell> diagonals;
+};
+
+/* The cells of rows [r_start, r_end) of anti-diagonal d, where 0 < r_start and r_end <= d.
+ * The minimum over the cells is returned. The operations per cell are those of
+ * set_levenshtein_distance, so the distances are identical. */
+template <typename TCell>
+TCell set_anti_diagonal_cells_scalar(const AntiDiagonalWorkspace<TCell>& ws,
+                                     const TCell* const                  c_switch_arr,
+                                     int                                 ncols,
+                                     int                                 d,
+                                     int                                 r_start,
+                                     int                                 r_end,
+                                     const TCell* const                  diag_prev_prev,
+                                     const TCell* const                  diag_prev,
+                                     TCell* const                        diag_acti,
+                                     TCell                               min_distance)
+{
+  int h;
+  for (int r = r_start; r < r_end; ++r)
+  {
+    h            = ncols - d + r;
+    diag_acti[r] = std::min(
+      std::min(ws.horizontal_indel_reversed[h] + diag_prev[r],
+               ws.vertical_indel[r - 1] + diag_prev[r - 1]),
+      diag_prev_prev[r - 1] +
+        c_switch_arr[ws.vertical_offsets[r - 1] + ws.horizontal_reversed[h]]);
+    min_distance = std::min(min_distance, diag_acti[r]);
+  }
+  return min_distance;
+}
+
+#ifdef ZENTAS_LEVENSHTEIN_X86
+ZENTAS_TARGET_AVX2
+double set_anti_diagonal_cells_avx2(const AntiDiagonalWorkspace<double>& ws,
+                                    const double* const                  c_switch_arr,
+                                    int                                  ncols,
+                                    int                                  d,
+                                    int                                  r_start,
+                                    int                                  r_end,
+                                    const double* const                  diag_prev_prev,
+                                    const double* const                  diag_prev,
+                                    double* const                        diag_acti,
+                                    double                               min_distance)
+{
+  __m256d v_min = _mm256_set1_pd(min_distance);
+  int     r     = r_start;
+  int     h;
+  __m128i switch_offsets;
+  __m256d cells;
+  /* the masked gather, as the unmasked one leaves gcc warning of an uninitialised source */
+  const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  for (; r + 4 <= r_end; r += 4)
+  {
+    h              = ncols - d + r;
+    switch_offsets = _mm_add_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(ws.vertical_offsets.data() + r - 1)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(ws.horizontal_reversed.data() + h)));
+
+    cells = _mm256_min_pd(
+      _mm256_min_pd(_mm256_add_pd(_mm256_loadu_pd(ws.horizontal_indel_reversed.data() + h),
+                                  _mm256_loadu_pd(diag_prev + r)),
+                    _mm256_add_pd(_mm256_loadu_pd(ws.vertical_indel.data() + r - 1),
+                                  _mm256_loadu_pd(diag_prev + r - 1))),
+      _mm256_add_pd(_mm256_loadu_pd(diag_prev_prev + r - 1),
+                    _mm256_mask_i32gather_pd(
+                      _mm256_setzero_pd(), c_switch_arr, switch_offsets, all_lanes, 8)));
+
+    _mm256_storeu_pd(diag_acti + r, cells);
+    v_min = _mm256_min_pd(v_min, cells);
+  }
+
+  double mins[4];
+  _mm256_storeu_pd(mins, v_min);
+  min_distance = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+
+  /* the tail, here rather than in set_anti_diagonal_cells_scalar to avoid mixing avx and sse */
+  for (; r < r_end; ++r)
+  {
+    h            = ncols - d + r;
+    diag_acti[r] = std::min(
+      std::min(ws.horizontal_indel_reversed[h] + diag_prev[r],
+               ws.vertical_indel[r - 1] + diag_prev[r - 1]),
+      diag_prev_prev[r - 1] +
+        c_switch_arr[ws.vertical_offsets[r - 1] + ws.horizontal_reversed[h]]);
+    min_distance = std::min(min_distance, diag_acti[r]);
+  }
+  return min_distance;
+}
+
+/* as above, with integer cells, 8 at a time */
+ZENTAS_TARGET_AVX2
+int32_t set_anti_diagonal_cells_avx2(const AntiDiagonalWorkspace<int32_t>& ws,
+                                     const int32_t* const                  c_switch_arr,
+                                     int                                   ncols,
+                                     int                                   d,
+                                     int                                   r_start,
+                                     int                                   r_end,
+                                     const int32_t* const                  diag_prev_prev,
+                                     const int32_t* const                  diag_prev,
+                                     int32_t* const                        diag_acti,
+                                     int32_t                               min_distance)
+{
+  __m256i v_min = _mm256_set1_epi32(min_distance);
+  int     r     = r_start;
+  int     h;
+  __m256i switch_offsets;
+  __m256i cells;
+  const __m256i all_lanes = _mm256_set1_epi32(-1);
+  for (; r + 8 <= r_end; r += 8)
+  {
+    h              = ncols - d + r;
+    switch_offsets = _mm256_add_epi32(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ws.vertical_offsets.data() + r - 1)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ws.horizontal_reversed.data() + h)));
+
+    cells = _mm256_min_epi32(
+      _mm256_min_epi32(
+        _mm256_add_epi32(
+          _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(ws.horizontal_indel_reversed.data() + h)),
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(diag_prev + r))),
+        _mm256_add_epi32(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ws.vertical_indel.data() + r - 1)),
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(diag_prev + r - 1)))),
+      _mm256_add_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(diag_prev_prev + r - 1)),
+        _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+                                    reinterpret_cast<const int*>(c_switch_arr),
+                                    switch_offsets,
+                                    all_lanes,
+                                    4)));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(diag_acti + r), cells);
+    v_min = _mm256_min_epi32(v_min, cells);
+  }
+
+  int32_t mins[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), v_min);
+  min_distance = *std::min_element(mins, mins + 8);
+
+  for (; r < r_end; ++r)
+  {
+    h            = ncols - d + r;
+    diag_acti[r] = std::min(
+      std::min(ws.horizontal_indel_reversed[h] + diag_prev[r],
+               ws.vertical_indel[r - 1] + diag_prev[r - 1]),
+      diag_prev_prev[r - 1] +
+        c_switch_arr[ws.vertical_offsets[r - 1] + ws.horizontal_reversed[h]]);
+    min_distance = std::min(min_distance, diag_acti[r]);
+  }
+  return min_distance;
+}
+#endif
+
+template <typename TCell>
+using AntiDiagonalCellsKernel = TCell (*)(const AntiDiagonalWorkspace<TCell>&,
+                                          const TCell* const,
+                                          int,
+                                          int,
+                                          int,
+                                          int,
+                                          const TCell* const,
+                                          const TCell* const,
+                                          TCell* const,
+                                          TCell);
+
+template <typename TCell>
+AntiDiagonalCellsKernel<TCell> get_anti_diagonal_cells_kernel()
+{
+#ifdef ZENTAS_LEVENSHTEIN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return set_anti_diagonal_cells_avx2;
+  }
+#endif
+  return set_anti_diagonal_cells_scalar<TCell>;
+}
+
+/* The band is as in set_levenshtein_distance, but is made narrower using the length
+ * difference : a path through (row, column) costs at least
+ * min_c_indel * (|column - row| + |(ncols - column) - (nrows - row)|). Cells outside of the
+ * band are threshold. The computation stops once two consecutive anti-diagonals are entirely
+ * at or above threshold, as every path passes through one of any two consecutive
+ * anti-diagonals. */
+template <typename TSample, typename TCell, class TIndelCost>
+void set_anti_diagonal_levenshtein_distance(const TSample&                       v_vertical,
+                                            const TSample&                       v_horizontal,
+                                            TCell                                threshold,
+                                            size_t                               dict_size,
+                                            const TIndelCost                     f_c_indel,
+                                            TCell                                min_c_indel,
+                                            TCell                                max_c_indel,
+                                            const TCell* const                   c_switch_arr,
+                                            const AntiDiagonalCellsKernel<TCell> kernel,
+                                            AntiDiagonalWorkspace<TCell>&        ws,
+                                            int                                  nrows,
+                                            int                                  ncols,
+                                            int&   n_cells_visited_local,
+                                            TCell& distance)
+{
+
+  int length_difference = ncols - nrows;
+  threshold             = std::min<TCell>(threshold, max_c_indel * (nrows + ncols));
+  if (min_c_indel * length_difference >= threshold)
+  {
+    distance = threshold;
+    return;
+  }
+
+  /* the band, on column - row */
+  double half_width = std::min(static_cast<double>(threshold) / min_c_indel,
+                               static_cast<double>(nrows + ncols));
+  int band_min = static_cast<int>(std::floor((length_difference - half_width) / 2.));
+  int band_max = static_cast<int>(std::ceil((length_difference + half_width) / 2.));
+
+  /* 7 extra entries, so that the avx2 loads of 8 never pass the ends */
+  ws.vertical_offsets.resize(nrows + 7);
+  ws.vertical_indel.resize(nrows + 7);
+  for (int r = 0; r < nrows; ++r)
+  {
+    ws.vertical_offsets[r] = static_cast<int>(dict_size * v_vertical.values[r]);
+    ws.vertical_indel[r]   = f_c_indel(v_vertical.values[r]);
+  }
+  ws.horizontal_reversed.resize(ncols + 7);
+  ws.horizontal_indel_reversed.resize(ncols + 7);
+  for (int c = 0; c < ncols; ++c)
+  {
+    ws.horizontal_reversed[c]       = static_cast<int>(v_horizontal.values[ncols - 1 - c]);
+    ws.horizontal_indel_reversed[c] = f_c_indel(v_horizontal.values[ncols - 1 - c]);
+  }
+
+  int stride = nrows + 10;
+  ws.diagonals.resize(3 * stride);
+  TCell* diag_prev_prev = ws.diagonals.data() + 1;
+  TCell* diag_prev      = diag_prev_prev + stride;
+  TCell* diag_acti      = diag_prev + stride;
+
+  diag_acti[-1] = threshold;
+  diag_acti[0]  = 0;
+  diag_acti[1]  = threshold;
+
+  TCell min_distance_prev = 0;
+  TCell min_distance      = 0;
+  int   r_start;
+  int   r_end;
+  int   d = 0;
+  while (d < nrows + ncols && std::min(min_distance_prev, min_distance) < threshold)
+  {
+    ++d;
+    std::swap(diag_prev_prev, diag_prev);
+    std::swap(diag_prev, diag_acti);
+    min_distance_prev = min_distance;
+    min_distance      = threshold;
+
+    /* rows [r_start, r_end) of the band, where column = d - row */
+    r_start = std::max(std::max(0, d - ncols), (d - band_max + 1) / 2);
+    r_end   = std::min(std::min(nrows, d), (d - band_min) / 2) + 1;
+
+    if (r_start == 0 && r_end > 0)
+    {
+      diag_acti[0] = diag_prev[0] + ws.horizontal_indel_reversed[ncols - d];
+      min_distance = diag_acti[0];
+    }
+    if (r_end == d + 1)
+    {
+      diag_acti[d] = ws.vertical_indel[d - 1] + diag_prev[d - 1];
+      min_distance = std::min(min_distance, diag_acti[d]);
+    }
+    min_distance = kernel(ws,
+                          c_switch_arr,
+                          ncols,
+                          d,
+                          std::max(r_start, 1),
+                          std::min(r_end, d),
+                          diag_prev_prev,
+                          diag_prev,
+                          diag_acti,
+                          min_distance);
+
+    /* the neighbours of the band, read on the next two anti-diagonals */
+    diag_acti[r_start - 1] = threshold;
+    diag_acti[r_end]       = threshold;
+
+    /* as in set_levenshtein_distance, the first row and column are not counted */
+    n_cells_visited_local += std::max(0, std::min(r_end, d) - std::max(r_start, 1));
+  }
+
+  distance = (d == nrows + ncols) ? std::min(threshold, diag_acti[nrows]) : threshold;
+}
+
+/* the total counts by which profile a exceeds profile b, and b exceeds a, over the keys
+ * a.keys[i, i_end) and b.keys[j, j_end). Dense profiles have the same keys, so that the
+ * ranges are the same. */
+inline void set_profile_excesses(const StringProfile& a,
+                                 size_t               i,
+                                 size_t               i_end,
+                                 const StringProfile& b,
+                                 size_t               j,
+                                 size_t               j_end,
+                                 size_t&              excess_a,
+                                 size_t&              excess_b)
+{
+  excess_a = 0;
+  excess_b = 0;
+  int64_t count_diff;
+  if (a.keys == nullptr)
+  {
+    (void)j_end;
+    for (; i < i_end; ++i, ++j)
+    {
+      count_diff = static_cast<int64_t>(a.counts[i]) - static_cast<int64_t>(b.counts[j]);
+      excess_a += static_cast<size_t>(std::max<int64_t>(count_diff, 0));
+      excess_b += static_cast<size_t>(std::max<int64_t>(-count_diff, 0));
+    }
+    return;
+  }
+
+  /* without branches on the keys, which are unpredictable */
+  uint16_t key_a;
+  uint16_t key_b;
+  while (i < i_end && j < j_end)
+  {
+    key_a      = a.keys[i];
+    key_b      = b.keys[j];
+    count_diff = (key_a <= key_b ? static_cast<int64_t>(a.counts[i]) : 0) -
+                 (key_b <= key_a ? static_cast<int64_t>(b.counts[j]) : 0);
+    excess_a += static_cast<size_t>(std::max<int64_t>(count_diff, 0));
+    excess_b += static_cast<size_t>(std::max<int64_t>(-count_diff, 0));
+    i += key_a <= key_b;
+    j += key_b <= key_a;
+  }
+  for (; i < i_end; ++i)
+  {
+    excess_a += a.counts[i];
+  }
+  for (; j < j_end; ++j)
+  {
+    excess_b += b.counts[j];
+  }
+}
+
+/* the profile lower bounds are used when get_dp_work is more than this times the profile sizes */
+constexpr double profile_filter_ratio = 2.;
+
+/* A rough estimate of the work of the DP, in steps of the merge in get_profile_lower_bound, for
+ * a band of max_band columns (around the diagonal). A column of a block of the bit-parallel
+ * kernel (with unit costs), or about 4 cells of the banded DP, are comparable to a step of the
+ * merge. For short words the bit-parallel kernel is faster than the merge. */
+inline double get_dp_work(int nrows, int ncols, double max_band, bool unit_costs)
+{
+  if (unit_costs)
+  {
+    return static_cast<double>(ncols * ((nrows + 63) / 64));
+  }
+  return nrows * std::min<double>(ncols, max_band) / 4.;
+}
+
+/* The profiles of sequences of mean_size have up to 2 mean_size - 1 keys. If the DP of two such
+ * sequences, with no threshold, is not more than profile_filter_ratio times the merge of their
+ * profiles, LevenshteinMetric will (almost) never use them. With unit costs this is so for
+ * sequences shorter than about 500, otherwise for sequences shorter than about 30. */
+bool LevenshteinInitializer::profiles_can_pay_off(double mean_size) const
+{
+  bool unit_costs = dict_size == 0 && c_indel > 0 && c_indel == c_switch;
+  int  size       = static_cast<int>(std::min<double>(mean_size, std::numeric_limits<int>::max()));
+  return get_dp_work(size, size, mean_size, unit_costs) >
+         profile_filter_ratio * 2 * (2 * mean_size - 1);
+}
+
+/* The memory and counters of one thread of LevenshteinMetric_X. A thread claims a slot by
+ * setting busy, first trying the slot it last used. As threads rarely share a slot, this is
+ * almost always one uncontended atomic exchange. The DP rows are allocated on first use. */
+template <typename TAtomic>
+class LevenshteinSlot
+{
+  public:
+  std::atomic<bool> busy{false};
+
+  size_t ncalcs            = 0;
+  size_t n_cells_visited   = 0;
+  size_t n_cells_visitable = 0;
+
+  std::vector<double>            A_acti;
+  std::vector<double>            A_prev;
+  std::vector<int32_t>           int_A_acti;
+  std::vector<int32_t>           int_A_prev;
+  BitParallelWorkspace<TAtomic>  bp_workspace;
+  AntiDiagonalWorkspace<double>  ad_workspace;
+  AntiDiagonalWorkspace<int32_t> int_ad_workspace;
+
+  /* the values of packed samples */
+  std::vector<TAtomic> vertical_values;
+  std::vector<TAtomic> horizontal_values;
+
+  /* keep the busy flags and counters of neighbouring slots off each others' cache lines */
+  char padding[64];
+};
+
+template <typename TAtomic>
+const VariableLengthSample<TAtomic>& get_unpacked(const VariableLengthSample<TAtomic>& v,
+                                                  std::vector<TAtomic>&                values)
+{
+  (void)values;
+  return v;
+}
+
+template <typename TAtomic>
+VariableLengthSample<TAtomic> get_unpacked(const PackedSequenceSample<TAtomic>& v,
+                                           std::vector<TAtomic>&                values)
+{
+  values.resize(v.size);
+  v.unpack(values.data());
+  return VariableLengthSample<TAtomic>(v.size, values.data(), v.profile);
+}
+
 template <typename TSDataIn>
 /* See levenshtein_prototyping for equivalent python version */
 class LevenshteinMetric_X
 {
 
   private:
-  std::vector<size_t> v_ncalcs;
-  const size_t        dict_size;
-  bool                normalised;
-
-  ConstIndel  cv_c_indel;
-  ConstSwitch cv_c_switch;
-  MultiIndel  av_c_indel;
-  MultiSwitch av_c_switch;
-
-  std::vector<size_t>                    v_n_cells_visited;
-  std::vector<size_t>                    v_n_cells_visitable;
-  int                                    max_size;
-  int                                    memory_size;
-  size_t                                 nthreads;
-  std::vector<std::mutex>                v_mutex0;
-  std::mutex                             counter_mutex;
-  std::vector<std::unique_ptr<double[]>> v_up_A_acti;
-  std::vector<double*>                   v_A_acti;
-  std::vector<std::unique_ptr<double[]>> v_up_A_prev;
-  std::vector<double*>                   v_A_prev;
+  const size_t dict_size;
+  bool         normalised;
+
+  ConstIndel<double>  cv_c_indel;
+  ConstSwitch<double> cv_c_switch;
+  MultiIndel<double>  av_c_indel;
+  MultiSwitch         av_c_switch;
+
+  typedef LevenshteinSlot<typename TSDataIn::AtomicType> Slot;
+
+  int                                max_size;
+  int                                memory_size;
+  size_t                             nthreads;
+  std::vector<std::unique_ptr<Slot>> v_slots;
 
   double min_c_indel;
   double max_c_indel;
+  /* the smallest cost of switching to a different symbol */
+  double min_c_switch;
+
+  /* constant indel and switch costs, all the same : the bit-parallel kernel is used */
+  bool unit_costs;
+
+  /* matrices of costs : the anti-diagonal kernel is used */
+  const double*                   c_switch_arr;
+  AntiDiagonalCellsKernel<double> anti_diagonal_kernel;
+
+  /* when the costs are all integer multiples of cost_unit (> 0), the DPs are run in int32_t
+   * cells, in units of cost_unit. Integer adds and mins have lower latency than double ones, and
+   * the anti-diagonal kernel does 8 cells at a time in place of 4. */
+  double                           cost_unit;
+  int32_t                          int_min_c_indel;
+  int32_t                          int_max_c_indel;
+  ConstIndel<int32_t>              int_cv_c_indel;
+  ConstSwitch<int32_t>             int_cv_c_switch;
+  std::vector<int32_t>             int_c_indel_arr;
+  std::vector<int32_t>             int_c_switch_arr;
+  MultiIndel<int32_t>              int_av_c_indel;
+  AntiDiagonalCellsKernel<int32_t> int_anti_diagonal_kernel;
 
   bool test_where_possible;
 
-  protected:
-  std::mt19937_64                         gen;
-  std::uniform_int_distribution<unsigned> dis;
+  /* claim a free slot, starting at the one this thread last claimed */
+  Slot& acquire_slot()
+  {
+    static thread_local size_t slot_hint =
+      std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    size_t slot_i = slot_hint % nthreads;
+    while (v_slots[slot_i]->busy.exchange(true, std::memory_order_acquire) == true)
+    {
+      ++slot_i;
+      slot_i %= nthreads;
+    }
+    slot_hint = slot_i;
+
+    Slot& slot = *v_slots[slot_i];
+    if (cost_unit > 0 && slot.int_A_acti.size() < static_cast<size_t>(memory_size))
+    {
+      slot.int_A_acti.resize(memory_size);
+      slot.int_A_prev.resize(memory_size);
+    }
+    else if (cost_unit == 0 && slot.A_acti.size() < static_cast<size_t>(memory_size))
+    {
+      slot.A_acti.resize(memory_size);
+      slot.A_prev.resize(memory_size);
+    }
+    return slot;
+  }
+
+  void release_slot(Slot& slot) { slot.busy.store(false, std::memory_order_release); }
 
   public:
   typedef typename TSDataIn::Sample Sample;
   typedef LevenshteinInitializer    Initializer;
 
   LevenshteinMetric_X(const TSDataIn& datain, size_t nthreads_, const LevenshteinInitializer& li)
-    : v_ncalcs(nthreads_, 0),
-
-      dict_size(li.dict_size),
+    : dict_size(li.dict_size),
       normalised(li.normalised),
 
       cv_c_indel(li.c_indel),
@@ -343,40 +1109,79 @@ class LevenshteinMetric_X
       av_c_indel(li.c_indel_arr),
       av_c_switch(li.c_switch_arr, dict_size),
 
-      v_n_cells_visited(nthreads_, 0),
-      v_n_cells_visitable(nthreads_, 0),
       max_size(static_cast<int>(datain.get_max_size())),
 
       /* below : making 10*size + 10 makes no difference to performance (speed) */
       memory_size(4 * static_cast<int>(datain.get_max_size()) + 10),
       nthreads(nthreads_),
-      v_mutex0(nthreads_)
+      unit_costs(li.dict_size == 0 && li.c_indel > 0 && li.c_indel == li.c_switch),
+      c_switch_arr(li.c_switch_arr),
+      anti_diagonal_kernel(get_anti_diagonal_cells_kernel<double>()),
+      int_anti_diagonal_kernel(get_anti_diagonal_cells_kernel<int32_t>())
 
   {
     for (size_t ti = 0; ti < nthreads; ++ti)
     {
-      v_up_A_acti.emplace_back(new double[memory_size]);
-      v_A_acti.push_back(v_up_A_acti[ti].get());
-
-      v_up_A_prev.emplace_back(new double[memory_size]);
-      v_A_prev.push_back(v_up_A_prev[ti].get());
+      v_slots.emplace_back(new Slot);
     }
 
     if (dict_size > 0)
     {
-      min_c_indel = std::numeric_limits<double>::max();
-      max_c_indel = 0.;
+      min_c_indel  = std::numeric_limits<double>::max();
+      max_c_indel  = 0.;
+      min_c_switch = std::numeric_limits<double>::max();
       for (size_t w = 0; w < dict_size; ++w)
       {
         min_c_indel = std::min(min_c_indel, av_c_indel(w));
         max_c_indel = std::max(max_c_indel, av_c_indel(w));
+        for (size_t w2 = 0; w2 < dict_size; ++w2)
+        {
+          if (w2 != w)
+          {
+            min_c_switch = std::min(min_c_switch, c_switch_arr[w * dict_size + w2]);
+          }
+        }
       }
     }
 
     else
     {
-      min_c_indel = cv_c_indel(0);
-      max_c_indel = cv_c_indel(0);
+      min_c_indel  = cv_c_indel(0);
+      max_c_indel  = cv_c_indel(0);
+      min_c_switch = li.c_switch;
+    }
+
+    /* cells are at most max_c_indel * (nrows + ncols) + a cost, which must not overflow */
+    std::vector<double> costs;
+    if (dict_size > 0)
+    {
+      costs.assign(li.c_indel_arr, li.c_indel_arr + dict_size);
+      costs.insert(costs.end(), c_switch_arr, c_switch_arr + dict_size * dict_size);
+    }
+    else
+    {
+      costs = {li.c_indel, li.c_switch};
+    }
+    double max_units =
+      static_cast<double>(std::numeric_limits<int32_t>::max()) / (2. * max_size + 2.);
+    cost_unit = unit_costs ? 0 : get_integer_cost_unit(costs, max_units);
+
+    if (cost_unit > 0)
+    {
+      auto to_units = [this](double c) { return static_cast<int32_t>(std::round(c / cost_unit)); };
+      int_min_c_indel = to_units(min_c_indel);
+      int_max_c_indel = to_units(max_c_indel);
+      int_cv_c_indel  = ConstIndel<int32_t>(to_units(li.c_indel));
+      int_cv_c_switch = ConstSwitch<int32_t>(to_units(li.c_switch));
+      for (size_t w = 0; w < dict_size; ++w)
+      {
+        int_c_indel_arr.push_back(to_units(li.c_indel_arr[w]));
+      }
+      for (size_t w = 0; w < dict_size * dict_size; ++w)
+      {
+        int_c_switch_arr.push_back(to_units(c_switch_arr[w]));
+      }
+      int_av_c_indel = MultiIndel<int32_t>(int_c_indel_arr.data());
     }
 
     test_where_possible = false;
@@ -386,6 +1191,40 @@ class LevenshteinMetric_X
     }
   }
 
+  /* see get_dp_work, the band of the banded DP is 2 threshold / min_c_indel + 1 wide */
+  double get_dp_work(int nrows, int ncols, double threshold) const
+  {
+    return nszen::get_dp_work(nrows, ncols, 2 * threshold / min_c_indel + 1, unit_costs);
+  }
+
+  /* Lower bounds from the profiles, O(length). With P symbols in excess in one histogram and N in
+   * the other, each switch corrects at most one of each, and each indel one, so the distance
+   * is at least min(P, N) * min(min_c_switch, 2 min_c_indel) + |P - N| * min_c_indel (where
+   * |P - N| is the length difference). Each switch or indel changes the bigram counts by at
+   * most 4 in total (Ukkonen 1992), so there are at least a quarter as many edits as the
+   * bigram count difference. */
+  double get_profile_lower_bound(const StringProfile& a, const StringProfile& b) const
+  {
+    if (a.n_symbols == 0 || b.n_symbols == 0)
+    {
+      return 0;
+    }
+
+    size_t excess_a;
+    size_t excess_b;
+    set_profile_excesses(a, 0, a.n_symbols, b, 0, b.n_symbols, excess_a, excess_b);
+    double histogram_bound =
+      static_cast<double>(std::min(excess_a, excess_b)) * std::min(min_c_switch, 2 * min_c_indel) +
+      static_cast<double>(std::max(excess_a, excess_b) - std::min(excess_a, excess_b)) *
+        min_c_indel;
+
+    set_profile_excesses(a, a.n_symbols, a.n_keys, b, b.n_symbols, b.n_keys, excess_a, excess_b);
+    double bigram_bound = static_cast<double>((excess_a + excess_b + 3) / 4) *
+                          std::min(min_c_switch, min_c_indel);
+
+    return std::max(histogram_bound, bigram_bound);
+  }
+
   void set_distance_simple_test(const Sample& v_vertical,
                                 const Sample& v_horizontal,
                                 double        threshold,
@@ -429,6 +1268,117 @@ class LevenshteinMetric_X
     }
   }
 
+  /* the DP, once the profile lower bound has failed to exceed threshold */
+  template <typename TSample>
+  void set_dp_distance(const TSample& v_vertical,
+                       const TSample& v_horizontal,
+                       double         threshold,
+                       Slot&          slot,
+                       int            nrows,
+                       int            ncols,
+                       int&           n_cells_visited_local,
+                       double&        distance)
+  {
+    /* unit indel and switch costs, scaled by c_indel */
+    if (unit_costs)
+    {
+      int unit_threshold = static_cast<int>(std::ceil(threshold / max_c_indel));
+      int unit_distance;
+      set_bit_parallel_levenshtein_distance(v_vertical,
+                                            v_horizontal,
+                                            unit_threshold,
+                                            slot.bp_workspace,
+                                            nrows,
+                                            ncols,
+                                            n_cells_visited_local,
+                                            unit_distance);
+      distance = unit_distance < unit_threshold ? max_c_indel * unit_distance : threshold;
+    }
+
+    /* costs in integer units : the same DPs, in int32_t cells */
+    else if (cost_unit > 0)
+    {
+      int32_t int_threshold = static_cast<int32_t>(
+        std::min(std::ceil(threshold / cost_unit),
+                 static_cast<double>(int_max_c_indel) * (nrows + ncols)));
+      int32_t int_distance;
+      if (dict_size == 0)
+      {
+        set_levenshtein_distance(v_vertical,
+                                 v_horizontal,
+                                 int_threshold,
+                                 dict_size,
+                                 int_cv_c_indel,
+                                 int_min_c_indel,
+                                 int_max_c_indel,
+                                 int_cv_c_switch,
+                                 slot.int_A_prev.data(),
+                                 slot.int_A_acti.data(),
+                                 nrows,
+                                 ncols,
+                                 n_cells_visited_local,
+                                 int_distance);
+      }
+      else
+      {
+        set_anti_diagonal_levenshtein_distance(v_vertical,
+                                               v_horizontal,
+                                               int_threshold,
+                                               dict_size,
+                                               int_av_c_indel,
+                                               int_min_c_indel,
+                                               int_max_c_indel,
+                                               int_c_switch_arr.data(),
+                                               int_anti_diagonal_kernel,
+                                               slot.int_ad_workspace,
+                                               nrows,
+                                               ncols,
+                                               n_cells_visited_local,
+                                               int_distance);
+      }
+      /* d < threshold exactly when d (in units) < int_threshold */
+      distance = int_distance < int_threshold ? cost_unit * int_distance : threshold;
+    }
+
+    /* constant indel and switch cost */
+    else if (dict_size == 0)
+    {
+      set_levenshtein_distance(v_vertical,
+                               v_horizontal,
+                               threshold,
+                               dict_size,
+                               cv_c_indel,
+                               min_c_indel,
+                               max_c_indel,
+                               cv_c_switch,
+                               slot.A_prev.data(),
+                               slot.A_acti.data(),
+                               nrows,
+                               ncols,
+                               n_cells_visited_local,
+                               distance);
+    }
+
+    /* matrices of costs */
+    else
+    {
+      set_anti_diagonal_levenshtein_distance(v_vertical,
+                                             v_horizontal,
+                                             threshold,
+                                             dict_size,
+                                             av_c_indel,
+                                             min_c_indel,
+                                             max_c_indel,
+                                             c_switch_arr,
+                                             anti_diagonal_kernel,
+                                             slot.ad_workspace,
+                                             nrows,
+                                             ncols,
+                                             n_cells_visited_local,
+                                             distance);
+    }
+  }
+
   void set_distance_tiffany(const Sample& v_vertical,
                             const Sample& v_horizontal,
                             double        threshold,
@@ -457,19 +1407,6 @@ class LevenshteinMetric_X
     // size_t
     int n_cells_visited_local = 0;
 
-    // get a mutex and keep it
-    size_t mutex_i = dis(gen) % nthreads;
-
-    while (v_mutex0[mutex_i].try_lock() == false)
-    {
-      ++mutex_i;
-      mutex_i %= nthreads;
-    }
-
-    std::lock_guard<std::mutex> lock(v_mutex0[mutex_i], std::adopt_lock);
-    double*                     A_acti = v_A_acti[mutex_i];
-    double*                     A_prev = v_A_prev[mutex_i];
-
     /* do some fast tracking tests */
     if (nrows == 0 || ncols == 0)
     {
@@ -479,43 +1416,35 @@ class LevenshteinMetric_X
 
     else
     {
-      /* constant indel and switch cost */
-      if (dict_size == 0)
+      Slot& slot = acquire_slot();
+      threshold  = std::min(threshold, max_c_indel * (nrows + ncols));
+
+      /* the cheap lower bounds first, if they are cheap compared to the DP */
+      if (get_dp_work(nrows, ncols, threshold) >
+            profile_filter_ratio *
+              static_cast<double>(v_vertical.profile.n_keys + v_horizontal.profile.n_keys) &&
+          get_profile_lower_bound(v_vertical.profile, v_horizontal.profile) >= threshold)
       {
-        set_levenshtein_distance(v_vertical,
-                                 v_horizontal,
-                                 threshold,
-                                 dict_size,
-                                 cv_c_indel,
-                                 min_c_indel,
-                                 max_c_indel,
-                                 cv_c_switch,
-                                 A_prev,
-                                 A_acti,
-                                 nrows,
-                                 ncols,
-                                 n_cells_visited_local,
-                                 distance);
+        distance = threshold;
       }
 
-      /* matrices of costs */
+      /* packed samples are unpacked into the slot, O(length) as compared to the DP */
       else
       {
-        set_levenshtein_distance(v_vertical,
-                                 v_horizontal,
-                                 threshold,
-                                 dict_size,
-                                 av_c_indel,
-                                 min_c_indel,
-                                 max_c_indel,
-                                 av_c_switch,
-                                 A_prev,
-                                 A_acti,
-                                 nrows,
-                                 ncols,
-                                 n_cells_visited_local,
-                                 distance);
+        set_dp_distance(get_unpacked(v_vertical, slot.vertical_values),
+                        get_unpacked(v_horizontal, slot.horizontal_values),
+                        threshold,
+                        slot,
+                        nrows,
+                        ncols,
+                        n_cells_visited_local,
+                        distance);
       }
+
+      ++slot.ncalcs;
+      slot.n_cells_visitable += static_cast<size_t>(nrows * ncols);
+      slot.n_cells_visited += static_cast<size_t>(n_cells_visited_local);
+      release_slot(slot);
     }
 
     if (normalised == true)
@@ -526,19 +1455,15 @@ class LevenshteinMetric_X
         (max_c_indel * static_cast<double>(v_horizontal.size + v_vertical.size) + distance);
     }
 
-    ++v_ncalcs[mutex_i];
-    v_n_cells_visitable[mutex_i] += static_cast<size_t>(nrows * ncols);
-    v_n_cells_visited[mutex_i] += static_cast<size_t>(n_cells_visited_local);
-
     distance = static_cast<double>(static_cast<float>(distance));
   }
 
   size_t get_ncalcs() const
   {
     size_t ncalcs = 0;
-    for (auto& x : v_ncalcs)
+    for (auto& slot : v_slots)
     {
-      ncalcs += x;
+      ncalcs += slot->ncalcs;
     }
     return ncalcs;
   }
@@ -548,15 +1473,15 @@ class LevenshteinMetric_X
 
     /* How well have we done as compared to the O(row*column) algorithm ?*/
     size_t n_cells_visited = 0;
-    for (auto& x : v_n_cells_visited)
+    for (auto& slot : v_slots)
     {
-      n_cells_visited += x;
+      n_cells_visited += slot->n_cells_visited;
     }
 
     size_t n_cells_visitable = 0;
-    for (auto& x : v_n_cells_visitable)
+    for (auto& slot : v_slots)
     {
-      n_cells_visitable += x;
+      n_cells_visitable += slot->n_cells_visitable;
     }
 
     return static_cast<double>(n_cells_visited) / static_cast<double>(n_cells_visitable);
@@ -599,4 +1524,8 @@ template class LevenshteinMetric<nszen::StringDataUnrootedIn<char>>;
 template class LevenshteinMetric<nszen::StringDataUnrootedIn<int>>;
 template class LevenshteinMetric<nszen::StringDataRootedIn<char>>;
 template class LevenshteinMetric<nszen::StringDataRootedIn<int>>;
+template class LevenshteinMetric<nszen::PackedStringDataUnrootedIn<char>>;
+template class LevenshteinMetric<nszen::PackedStringDataUnrootedIn<int>>;
+template class LevenshteinMetric<nszen::PackedStringDataRootedIn<char>>;
+template class LevenshteinMetric<nszen::PackedStringDataRootedIn<int>>;
 }
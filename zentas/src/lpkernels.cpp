@@ -0,0 +1,1161 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <zentas/lpkernels.hpp>
+#include <zentas/zentaserror.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ZENTAS_LPKERNELS_X86
+/* gcc 12 has spurious -W(maybe-)uninitialized warnings in avx512fintrin.h */
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+#include <immintrin.h>
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+#define ZENTAS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define ZENTAS_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace nszen
+{
+namespace lpkernels
+{
+
+/* The norms. The scalar updates are the same as NonZero, AbsDiff, SquareDiff and MaxDiff in
+ * lpmetric.hpp, they are used for the portable kernel and for the tails of the vector kernels.
+ * As in the scalar code, differences are computed in TNumber and accumulated in double. */
+struct L0Norm
+{
+  static constexpr bool is_max = false;
+  static inline void update(double& dist, double diff) { dist += (diff != 0); }
+};
+
+struct L1Norm
+{
+  static constexpr bool is_max = false;
+  static inline void update(double& dist, double diff) { dist += std::abs(diff); }
+};
+
+struct L2Norm
+{
+  static constexpr bool is_max = false;
+  static inline void update(double& dist, double diff) { dist += diff * diff; }
+};
+
+struct LooNorm
+{
+  static constexpr bool is_max = true;
+  static inline void update(double& dist, double diff) { dist = std::max(dist, std::abs(diff)); }
+};
+
+template <typename TNumber, class TNorm>
+inline void scalar_accumulate(
+  const TNumber* a, const TNumber* b, size_t d_begin, size_t d_end, double& distance)
+{
+  TNumber diff;
+  for (size_t d = d_begin; d < d_end; ++d)
+  {
+    diff = a[d] - b[d];
+    TNorm::update(distance, diff);
+  }
+}
+
+template <typename TNumber, class TNorm>
+double scalar_kernel(
+  const TNumber* a, const TNumber* b, size_t dimension, double threshold, size_t& n_visited)
+{
+  double distance = 0;
+  size_t d_end;
+  for (size_t d = 0; d < dimension; d = d_end)
+  {
+    d_end = std::min(d + dense_block_size, dimension);
+    scalar_accumulate<TNumber, TNorm>(a, b, d, d_end, distance);
+    if (distance > threshold)
+    {
+      n_visited = d_end;
+      return distance;
+    }
+  }
+  n_visited = dimension;
+  return distance;
+}
+
+template <typename TNumber, class TNorm>
+void scalar_batch_kernel(const TNumber*              a,
+                         const TNumber* const* const bs,
+                         size_t                      n_bs,
+                         size_t                      dimension,
+                         const double* const         thresholds,
+                         double* const               distances,
+                         size_t&                     n_visited)
+{
+  size_t s_visited;
+  n_visited = 0;
+  for (size_t s = 0; s < n_bs; ++s)
+  {
+    distances[s] = scalar_kernel<TNumber, TNorm>(a, bs[s], dimension, thresholds[s], s_visited);
+    n_visited += s_visited;
+  }
+}
+
+/* the dot product, for l2 with cached squared norms. Accumulated in double. */
+template <typename TNumber>
+inline void scalar_dot_accumulate(
+  const TNumber* a, const TNumber* b, size_t d_begin, size_t d_end, double& dot)
+{
+  for (size_t d = d_begin; d < d_end; ++d)
+  {
+    dot += static_cast<double>(a[d]) * static_cast<double>(b[d]);
+  }
+}
+
+template <typename TNumber>
+double scalar_dot(const TNumber* a, const TNumber* b, size_t dimension)
+{
+  double dot = 0;
+  scalar_dot_accumulate(a, b, 0, dimension, dot);
+  return dot;
+}
+
+/* the merge of the sorted indices, from positions i in a and j in b. */
+template <typename TNumber>
+inline void scalar_sparse_dot_accumulate(const TNumber* a_values,
+                                         const size_t*  a_indices,
+                                         size_t         a_size,
+                                         const TNumber* b_values,
+                                         const size_t*  b_indices,
+                                         size_t         b_size,
+                                         size_t         i,
+                                         size_t         j,
+                                         double&        dot)
+{
+  while (i < a_size && j < b_size)
+  {
+    if (a_indices[i] == b_indices[j])
+    {
+      dot += static_cast<double>(a_values[i]) * static_cast<double>(b_values[j]);
+      ++i;
+      ++j;
+    }
+    else if (a_indices[i] < b_indices[j])
+    {
+      ++i;
+    }
+    else
+    {
+      ++j;
+    }
+  }
+}
+
+template <typename TNumber>
+double scalar_sparse_dot(const TNumber* a_values,
+                         const size_t*  a_indices,
+                         size_t         a_size,
+                         const TNumber* b_values,
+                         const size_t*  b_indices,
+                         size_t         b_size)
+{
+  double dot = 0;
+  scalar_sparse_dot_accumulate(
+    a_values, a_indices, a_size, b_values, b_indices, b_size, 0, 0, dot);
+  return dot;
+}
+
+/* reduced precision storage. The difference is computed in float, as in the vector kernels,
+ * with widen from quantise.hpp. */
+template <typename TCode, class TNorm>
+inline void scalar_quantised_accumulate(const TCode* a,
+                                        const TCode* b,
+                                        const float* scales,
+                                        size_t       d_begin,
+                                        size_t       d_end,
+                                        double&      distance)
+{
+  float diff;
+  for (size_t d = d_begin; d < d_end; ++d)
+  {
+    diff = (widen(a[d]) - widen(b[d])) * scales[d];
+    TNorm::update(distance, diff);
+  }
+}
+
+template <typename TCode, class TNorm>
+double scalar_quantised_kernel(const TCode* a,
+                               const TCode* b,
+                               const float* scales,
+                               size_t       dimension,
+                               double       threshold,
+                               size_t&      n_visited)
+{
+  double distance = 0;
+  size_t d_end;
+  for (size_t d = 0; d < dimension; d = d_end)
+  {
+    d_end = std::min(d + dense_block_size, dimension);
+    scalar_quantised_accumulate<TCode, TNorm>(a, b, scales, d, d_end, distance);
+    if (distance > threshold)
+    {
+      n_visited = d_end;
+      return distance;
+    }
+  }
+  n_visited = dimension;
+  return distance;
+}
+
+#ifdef ZENTAS_LPKERNELS_X86
+
+/* sse2 : 2 doubles per register, 8 registers per block. sse2 is part of x86-64. */
+constexpr size_t sse2_n_regs = dense_block_size / 2;
+
+inline void sse2_diffs(const double* a, const double* b, __m128d* diffs)
+{
+  for (size_t i = 0; i < sse2_n_regs; ++i)
+  {
+    diffs[i] = _mm_sub_pd(_mm_loadu_pd(a + 2 * i), _mm_loadu_pd(b + 2 * i));
+  }
+}
+
+inline void sse2_diffs(const float* a, const float* b, __m128d* diffs)
+{
+  __m128 x;
+  for (size_t i = 0; i < sse2_n_regs / 2; ++i)
+  {
+    x                = _mm_sub_ps(_mm_loadu_ps(a + 4 * i), _mm_loadu_ps(b + 4 * i));
+    diffs[2 * i]     = _mm_cvtps_pd(x);
+    diffs[2 * i + 1] = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+  }
+}
+
+inline __m128d sse2_update(L0Norm, __m128d acc, __m128d diff)
+{
+  return _mm_add_pd(acc, _mm_and_pd(_mm_cmpneq_pd(diff, _mm_setzero_pd()), _mm_set1_pd(1.)));
+}
+
+inline __m128d sse2_update(L1Norm, __m128d acc, __m128d diff)
+{
+  return _mm_add_pd(acc, _mm_andnot_pd(_mm_set1_pd(-0.), diff));
+}
+
+inline __m128d sse2_update(L2Norm, __m128d acc, __m128d diff)
+{
+  return _mm_add_pd(acc, _mm_mul_pd(diff, diff));
+}
+
+inline __m128d sse2_update(LooNorm, __m128d acc, __m128d diff)
+{
+  return _mm_max_pd(acc, _mm_andnot_pd(_mm_set1_pd(-0.), diff));
+}
+
+template <class TNorm>
+inline double sse2_reduce(const __m128d* acc)
+{
+  __m128d x = acc[0];
+  for (size_t i = 1; i < sse2_n_regs; ++i)
+  {
+    x = TNorm::is_max ? _mm_max_pd(x, acc[i]) : _mm_add_pd(x, acc[i]);
+  }
+  __m128d hi = _mm_unpackhi_pd(x, x);
+  x          = TNorm::is_max ? _mm_max_sd(x, hi) : _mm_add_sd(x, hi);
+  return _mm_cvtsd_f64(x);
+}
+
+template <typename TNumber, class TNorm>
+double sse2_kernel(
+  const TNumber* a, const TNumber* b, size_t dimension, double threshold, size_t& n_visited)
+{
+  __m128d acc[sse2_n_regs];
+  __m128d diffs[sse2_n_regs];
+  for (size_t i = 0; i < sse2_n_regs; ++i)
+  {
+    acc[i] = _mm_setzero_pd();
+  }
+
+  double distance = 0;
+  size_t d        = 0;
+  for (; d + dense_block_size <= dimension; d += dense_block_size)
+  {
+    sse2_diffs(a + d, b + d, diffs);
+    for (size_t i = 0; i < sse2_n_regs; ++i)
+    {
+      acc[i] = sse2_update(TNorm(), acc[i], diffs[i]);
+    }
+    distance = sse2_reduce<TNorm>(acc);
+    if (distance > threshold)
+    {
+      n_visited = d + dense_block_size;
+      return distance;
+    }
+  }
+  scalar_accumulate<TNumber, TNorm>(a, b, d, dimension, distance);
+  n_visited = dimension;
+  return distance;
+}
+
+/* as sse2_kernel, for batch_width samples at a time, sharing the loads of a. The
+ * accumulations of all batch_width samples continue until all are over their thresholds, but
+ * the distance of a sample is frozen at the block where it goes over, so the distances are
+ * identical to those of sse2_kernel. There is no intermediate reduction for samples without
+ * a threshold. A final incomplete batch is processed one sample at a time. */
+template <typename TNumber, class TNorm>
+void sse2_batch_kernel(const TNumber*              a,
+                       const TNumber* const* const bs,
+                       size_t                      n_bs,
+                       size_t                      dimension,
+                       const double* const         thresholds,
+                       double* const               distances,
+                       size_t&                     n_visited)
+{
+  __m128d acc[batch_width][sse2_n_regs];
+  __m128d diffs[sse2_n_regs];
+  bool    active[batch_width];
+  size_t  n_active;
+  size_t  d;
+  size_t  s0 = 0;
+
+  n_visited = 0;
+  for (; s0 + batch_width <= n_bs; s0 += batch_width)
+  {
+    for (size_t s = 0; s < batch_width; ++s)
+    {
+      for (size_t i = 0; i < sse2_n_regs; ++i)
+      {
+        acc[s][i] = _mm_setzero_pd();
+      }
+      active[s] = true;
+    }
+    n_active = batch_width;
+
+    for (d = 0; d + dense_block_size <= dimension && n_active > 0; d += dense_block_size)
+    {
+      for (size_t s = 0; s < batch_width; ++s)
+      {
+        sse2_diffs(a + d, bs[s0 + s] + d, diffs);
+        for (size_t i = 0; i < sse2_n_regs; ++i)
+        {
+          acc[s][i] = sse2_update(TNorm(), acc[s][i], diffs[i]);
+        }
+      }
+
+      for (size_t s = 0; s < batch_width; ++s)
+      {
+        if (active[s] && thresholds[s0 + s] < std::numeric_limits<double>::max())
+        {
+          distances[s0 + s] = sse2_reduce<TNorm>(acc[s]);
+          if (distances[s0 + s] > thresholds[s0 + s])
+          {
+            active[s] = false;
+            --n_active;
+            n_visited += d + dense_block_size;
+          }
+        }
+      }
+    }
+
+    for (size_t s = 0; s < batch_width; ++s)
+    {
+      if (active[s])
+      {
+        distances[s0 + s] = sse2_reduce<TNorm>(acc[s]);
+        scalar_accumulate<TNumber, TNorm>(a, bs[s0 + s], d, dimension, distances[s0 + s]);
+        n_visited += dimension;
+      }
+    }
+  }
+
+  size_t s_visited;
+  for (; s0 < n_bs; ++s0)
+  {
+    distances[s0] = sse2_kernel<TNumber, TNorm>(a, bs[s0], dimension, thresholds[s0], s_visited);
+    n_visited += s_visited;
+  }
+}
+
+inline void sse2_widen(const double* a, __m128d* x)
+{
+  for (size_t i = 0; i < sse2_n_regs; ++i)
+  {
+    x[i] = _mm_loadu_pd(a + 2 * i);
+  }
+}
+
+inline void sse2_widen(const float* a, __m128d* x)
+{
+  __m128 y;
+  for (size_t i = 0; i < sse2_n_regs / 2; ++i)
+  {
+    y            = _mm_loadu_ps(a + 4 * i);
+    x[2 * i]     = _mm_cvtps_pd(y);
+    x[2 * i + 1] = _mm_cvtps_pd(_mm_movehl_ps(y, y));
+  }
+}
+
+template <typename TNumber>
+double sse2_dot(const TNumber* a, const TNumber* b, size_t dimension)
+{
+  __m128d acc[sse2_n_regs];
+  __m128d wa[sse2_n_regs];
+  __m128d wb[sse2_n_regs];
+  for (size_t i = 0; i < sse2_n_regs; ++i)
+  {
+    acc[i] = _mm_setzero_pd();
+  }
+
+  size_t d = 0;
+  for (; d + dense_block_size <= dimension; d += dense_block_size)
+  {
+    sse2_widen(a + d, wa);
+    sse2_widen(b + d, wb);
+    for (size_t i = 0; i < sse2_n_regs; ++i)
+    {
+      acc[i] = _mm_add_pd(acc[i], _mm_mul_pd(wa[i], wb[i]));
+    }
+  }
+  /* L2Norm for a sum reduction */
+  double dot = sse2_reduce<L2Norm>(acc);
+  scalar_dot_accumulate(a, b, d, dimension, dot);
+  return dot;
+}
+
+/* avx2 : 4 doubles per register, 4 registers per block. */
+constexpr size_t avx2_n_regs = dense_block_size / 4;
+
+ZENTAS_TARGET_AVX2 inline void avx2_diffs(const double* a, const double* b, __m256d* diffs)
+{
+  for (size_t i = 0; i < avx2_n_regs; ++i)
+  {
+    diffs[i] = _mm256_sub_pd(_mm256_loadu_pd(a + 4 * i), _mm256_loadu_pd(b + 4 * i));
+  }
+}
+
+ZENTAS_TARGET_AVX2 inline void avx2_diffs(const float* a, const float* b, __m256d* diffs)
+{
+  __m256 x;
+  for (size_t i = 0; i < avx2_n_regs / 2; ++i)
+  {
+    x                = _mm256_sub_ps(_mm256_loadu_ps(a + 8 * i), _mm256_loadu_ps(b + 8 * i));
+    diffs[2 * i]     = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+    diffs[2 * i + 1] = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+  }
+}
+
+ZENTAS_TARGET_AVX2 inline __m256d avx2_update(L0Norm, __m256d acc, __m256d diff)
+{
+  return _mm256_add_pd(
+    acc,
+    _mm256_and_pd(_mm256_cmp_pd(diff, _mm256_setzero_pd(), _CMP_NEQ_UQ), _mm256_set1_pd(1.)));
+}
+
+ZENTAS_TARGET_AVX2 inline __m256d avx2_update(L1Norm, __m256d acc, __m256d diff)
+{
+  return _mm256_add_pd(acc, _mm256_andnot_pd(_mm256_set1_pd(-0.), diff));
+}
+
+ZENTAS_TARGET_AVX2 inline __m256d avx2_update(L2Norm, __m256d acc, __m256d diff)
+{
+  return _mm256_fmadd_pd(diff, diff, acc);
+}
+
+ZENTAS_TARGET_AVX2 inline __m256d avx2_update(LooNorm, __m256d acc, __m256d diff)
+{
+  return _mm256_max_pd(acc, _mm256_andnot_pd(_mm256_set1_pd(-0.), diff));
+}
+
+template <class TNorm>
+ZENTAS_TARGET_AVX2 inline double avx2_reduce(const __m256d* acc)
+{
+  __m256d x = acc[0];
+  for (size_t i = 1; i < avx2_n_regs; ++i)
+  {
+    x = TNorm::is_max ? _mm256_max_pd(x, acc[i]) : _mm256_add_pd(x, acc[i]);
+  }
+  __m128d lo = _mm256_castpd256_pd128(x);
+  __m128d hi = _mm256_extractf128_pd(x, 1);
+  lo         = TNorm::is_max ? _mm_max_pd(lo, hi) : _mm_add_pd(lo, hi);
+  hi         = _mm_unpackhi_pd(lo, lo);
+  lo         = TNorm::is_max ? _mm_max_sd(lo, hi) : _mm_add_sd(lo, hi);
+  return _mm_cvtsd_f64(lo);
+}
+
+template <typename TNumber, class TNorm>
+ZENTAS_TARGET_AVX2 double avx2_kernel(
+  const TNumber* a, const TNumber* b, size_t dimension, double threshold, size_t& n_visited)
+{
+  __m256d acc[avx2_n_regs];
+  __m256d diffs[avx2_n_regs];
+  for (size_t i = 0; i < avx2_n_regs; ++i)
+  {
+    acc[i] = _mm256_setzero_pd();
+  }
+
+  double distance = 0;
+  size_t d        = 0;
+  for (; d + dense_block_size <= dimension; d += dense_block_size)
+  {
+    avx2_diffs(a + d, b + d, diffs);
+    for (size_t i = 0; i < avx2_n_regs; ++i)
+    {
+      acc[i] = avx2_update(TNorm(), acc[i], diffs[i]);
+    }
+    distance = avx2_reduce<TNorm>(acc);
+    if (distance > threshold)
+    {
+      n_visited = d + dense_block_size;
+      return distance;
+    }
+  }
+  scalar_accumulate<TNumber, TNorm>(a, b, d, dimension, distance);
+  n_visited = dimension;
+  return distance;
+}
+
+/* as avx2_kernel, for batch_width samples at a time, sharing the loads of a. The
+ * accumulations of all batch_width samples continue until all are over their thresholds, but
+ * the distance of a sample is frozen at the block where it goes over, so the distances are
+ * identical to those of avx2_kernel. There is no intermediate reduction for samples without
+ * a threshold. A final incomplete batch is processed one sample at a time. */
+template <typename TNumber, class TNorm>
+ZENTAS_TARGET_AVX2 void avx2_batch_kernel(const TNumber*              a,
+                                          const TNumber* const* const bs,
+                                          size_t                      n_bs,
+                                          size_t                      dimension,
+                                          const double* const         thresholds,
+                                          double* const               distances,
+                                          size_t&                     n_visited)
+{
+  __m256d acc[batch_width][avx2_n_regs];
+  __m256d diffs[avx2_n_regs];
+  bool    active[batch_width];
+  size_t  n_active;
+  size_t  d;
+  size_t  s0 = 0;
+
+  n_visited = 0;
+  for (; s0 + batch_width <= n_bs; s0 += batch_width)
+  {
+    for (size_t s = 0; s < batch_width; ++s)
+    {
+      for (size_t i = 0; i < avx2_n_regs; ++i)
+      {
+        acc[s][i] = _mm256_setzero_pd();
+      }
+      active[s] = true;
+    }
+    n_active = batch_width;
+
+    for (d = 0; d + dense_block_size <= dimension && n_active > 0; d += dense_block_size)
+    {
+      for (size_t s = 0; s < batch_width; ++s)
+      {
+        avx2_diffs(a + d, bs[s0 + s] + d, diffs);
+        for (size_t i = 0; i < avx2_n_regs; ++i)
+        {
+          acc[s][i] = avx2_update(TNorm(), acc[s][i], diffs[i]);
+        }
+      }
+
+      for (size_t s = 0; s < batch_width; ++s)
+      {
+        if (active[s] && thresholds[s0 + s] < std::numeric_limits<double>::max())
+        {
+          distances[s0 + s] = avx2_reduce<TNorm>(acc[s]);
+          if (distances[s0 + s] > thresholds[s0 + s])
+          {
+            active[s] = false;
+            --n_active;
+            n_visited += d + dense_block_size;
+          }
+        }
+      }
+    }
+
+    for (size_t s = 0; s < batch_width; ++s)
+    {
+      if (active[s])
+      {
+        distances[s0 + s] = avx2_reduce<TNorm>(acc[s]);
+        scalar_accumulate<TNumber, TNorm>(a, bs[s0 + s], d, dimension, distances[s0 + s]);
+        n_visited += dimension;
+      }
+    }
+  }
+
+  size_t s_visited;
+  for (; s0 < n_bs; ++s0)
+  {
+    distances[s0] = avx2_kernel<TNumber, TNorm>(a, bs[s0], dimension, thresholds[s0], s_visited);
+    n_visited += s_visited;
+  }
+}
+
+ZENTAS_TARGET_AVX2 inline void avx2_widen(const double* a, __m256d* x)
+{
+  for (size_t i = 0; i < avx2_n_regs; ++i)
+  {
+    x[i] = _mm256_loadu_pd(a + 4 * i);
+  }
+}
+
+ZENTAS_TARGET_AVX2 inline void avx2_widen(const float* a, __m256d* x)
+{
+  for (size_t i = 0; i < avx2_n_regs; ++i)
+  {
+    x[i] = _mm256_cvtps_pd(_mm_loadu_ps(a + 4 * i));
+  }
+}
+
+template <typename TNumber>
+ZENTAS_TARGET_AVX2 double avx2_dot(const TNumber* a, const TNumber* b, size_t dimension)
+{
+  __m256d acc[avx2_n_regs];
+  __m256d wa[avx2_n_regs];
+  __m256d wb[avx2_n_regs];
+  for (size_t i = 0; i < avx2_n_regs; ++i)
+  {
+    acc[i] = _mm256_setzero_pd();
+  }
+
+  size_t d = 0;
+  for (; d + dense_block_size <= dimension; d += dense_block_size)
+  {
+    avx2_widen(a + d, wa);
+    avx2_widen(b + d, wb);
+    for (size_t i = 0; i < avx2_n_regs; ++i)
+    {
+      acc[i] = _mm256_fmadd_pd(wa[i], wb[i], acc[i]);
+    }
+  }
+  double dot = avx2_reduce<L2Norm>(acc);
+  scalar_dot_accumulate(a, b, d, dimension, dot);
+  return dot;
+}
+
+/* The intersection of sorted indices, 4 x 4 at a time : the block of 4 indices of a is
+ * compared to the 4 rotations of the block of b, and the block with the smaller last index is
+ * then advanced (or both, if equal). This replaces the unpredictable branch of each step of the
+ * merge with one per 4 x 4 block. The matches are found in increasing index order, so the dot
+ * product is the same as scalar_sparse_dot's. */
+template <typename TNumber>
+ZENTAS_TARGET_AVX2 double avx2_sparse_dot(const TNumber* a_values,
+                                          const size_t*  a_indices,
+                                          size_t         a_size,
+                                          const TNumber* b_values,
+                                          const size_t*  b_indices,
+                                          size_t         b_size)
+{
+  double  dot = 0;
+  size_t  i   = 0;
+  size_t  j   = 0;
+  __m256i va;
+  __m256i vb;
+  /* bit k of rotation_matches[r] : a[i + k] == b[j + (k + r) % 4] */
+  int rotation_matches[4];
+  int matches;
+  while (i + 4 <= a_size && j + 4 <= b_size)
+  {
+    va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_indices + i));
+    vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b_indices + j));
+    rotation_matches[0] = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(va, vb)));
+    rotation_matches[1] = _mm256_movemask_pd(_mm256_castsi256_pd(
+      _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1)))));
+    rotation_matches[2] = _mm256_movemask_pd(_mm256_castsi256_pd(
+      _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(1, 0, 3, 2)))));
+    rotation_matches[3] = _mm256_movemask_pd(_mm256_castsi256_pd(
+      _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+    matches = rotation_matches[0] | rotation_matches[1] | rotation_matches[2] | rotation_matches[3];
+
+    for (size_t k = 0; matches != 0; ++k, matches >>= 1)
+    {
+      if (matches & 1)
+      {
+        size_t r = 0;
+        while (((rotation_matches[r] >> k) & 1) == 0)
+        {
+          ++r;
+        }
+        dot += static_cast<double>(a_values[i + k]) *
+               static_cast<double>(b_values[j + (k + r) % 4]);
+      }
+    }
+
+    size_t a_last = a_indices[i + 3];
+    size_t b_last = b_indices[j + 3];
+    i += (a_last <= b_last) ? 4 : 0;
+    j += (b_last <= a_last) ? 4 : 0;
+  }
+  scalar_sparse_dot_accumulate(
+    a_values, a_indices, a_size, b_values, b_indices, b_size, i, j, dot);
+  return dot;
+}
+
+/* widen 8 codes to 8 floats, with the same operations as widen in quantise.hpp */
+ZENTAS_TARGET_AVX2 inline __m256 avx2_widen8(const Float16* a)
+{
+  __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+  __m256  magnitude =
+    _mm256_mul_ps(_mm256_castsi256_ps(_mm256_slli_epi32(
+                    _mm256_and_si256(h, _mm256_set1_epi32(0x7fff)), 13)),
+                  _mm256_castsi256_ps(_mm256_set1_epi32((127 + 112) << 23)));
+  __m256i sign = _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(0x8000)), 16);
+  return _mm256_or_ps(magnitude, _mm256_castsi256_ps(sign));
+}
+
+ZENTAS_TARGET_AVX2 inline __m256 avx2_widen8(const BFloat16* a)
+{
+  __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+  return _mm256_castsi256_ps(_mm256_slli_epi32(h, 16));
+}
+
+ZENTAS_TARGET_AVX2 inline __m256 avx2_widen8(const int8_t* a)
+{
+  return _mm256_cvtepi32_ps(
+    _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a))));
+}
+
+/* the differences of 8 dimensions, in 2 registers */
+template <typename TCode>
+ZENTAS_TARGET_AVX2 inline void
+avx2_quantised_diffs8(const TCode* a, const TCode* b, const float* scales, __m256d* diffs)
+{
+  __m256 x = _mm256_mul_ps(_mm256_sub_ps(avx2_widen8(a), avx2_widen8(b)), _mm256_loadu_ps(scales));
+  diffs[0] = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+  diffs[1] = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+}
+
+/* also used on avx512f machines : the widening is the bottleneck, and avx2 does it well. */
+template <typename TCode, class TNorm>
+ZENTAS_TARGET_AVX2 double avx2_quantised_kernel(const TCode* a,
+                                                const TCode* b,
+                                                const float* scales,
+                                                size_t       dimension,
+                                                double       threshold,
+                                                size_t&      n_visited)
+{
+  __m256d acc[avx2_n_regs];
+  __m256d diffs[avx2_n_regs];
+  for (size_t i = 0; i < avx2_n_regs; ++i)
+  {
+    acc[i] = _mm256_setzero_pd();
+  }
+
+  double distance = 0;
+  size_t d        = 0;
+  for (; d + dense_block_size <= dimension; d += dense_block_size)
+  {
+    avx2_quantised_diffs8(a + d, b + d, scales + d, diffs);
+    avx2_quantised_diffs8(a + d + 8, b + d + 8, scales + d + 8, diffs + 2);
+    for (size_t i = 0; i < avx2_n_regs; ++i)
+    {
+      acc[i] = avx2_update(TNorm(), acc[i], diffs[i]);
+    }
+    distance = avx2_reduce<TNorm>(acc);
+    if (distance > threshold)
+    {
+      n_visited = d + dense_block_size;
+      return distance;
+    }
+  }
+  /* the widening is slow in scalar code, so a remaining half block is vectorised too */
+  if (d + 8 <= dimension)
+  {
+    avx2_quantised_diffs8(a + d, b + d, scales + d, diffs);
+    acc[0]   = avx2_update(TNorm(), acc[0], diffs[0]);
+    acc[1]   = avx2_update(TNorm(), acc[1], diffs[1]);
+    distance = avx2_reduce<TNorm>(acc);
+    d += 8;
+  }
+  scalar_quantised_accumulate<TCode, TNorm>(a, b, scales, d, dimension, distance);
+  n_visited = dimension;
+  return distance;
+}
+
+/* avx512f : 8 doubles per register, 2 registers per block. */
+constexpr size_t avx512_n_regs = dense_block_size / 8;
+
+ZENTAS_TARGET_AVX512 inline void avx512_diffs(const double* a, const double* b, __m512d* diffs)
+{
+  for (size_t i = 0; i < avx512_n_regs; ++i)
+  {
+    diffs[i] = _mm512_sub_pd(_mm512_loadu_pd(a + 8 * i), _mm512_loadu_pd(b + 8 * i));
+  }
+}
+
+ZENTAS_TARGET_AVX512 inline void avx512_diffs(const float* a, const float* b, __m512d* diffs)
+{
+  for (size_t i = 0; i < avx512_n_regs; ++i)
+  {
+    diffs[i] =
+      _mm512_cvtps_pd(_mm256_sub_ps(_mm256_loadu_ps(a + 8 * i), _mm256_loadu_ps(b + 8 * i)));
+  }
+}
+
+ZENTAS_TARGET_AVX512 inline __m512d avx512_update(L0Norm, __m512d acc, __m512d diff)
+{
+  return _mm512_mask_add_pd(acc,
+                            _mm512_cmp_pd_mask(diff, _mm512_setzero_pd(), _CMP_NEQ_UQ),
+                            acc,
+                            _mm512_set1_pd(1.));
+}
+
+ZENTAS_TARGET_AVX512 inline __m512d avx512_update(L1Norm, __m512d acc, __m512d diff)
+{
+  return _mm512_add_pd(acc, _mm512_abs_pd(diff));
+}
+
+ZENTAS_TARGET_AVX512 inline __m512d avx512_update(L2Norm, __m512d acc, __m512d diff)
+{
+  return _mm512_fmadd_pd(diff, diff, acc);
+}
+
+ZENTAS_TARGET_AVX512 inline __m512d avx512_update(LooNorm, __m512d acc, __m512d diff)
+{
+  return _mm512_max_pd(acc, _mm512_abs_pd(diff));
+}
+
+template <class TNorm>
+ZENTAS_TARGET_AVX512 inline double avx512_reduce(const __m512d* acc)
+{
+  __m512d x = acc[0];
+  for (size_t i = 1; i < avx512_n_regs; ++i)
+  {
+    x = TNorm::is_max ? _mm512_max_pd(x, acc[i]) : _mm512_add_pd(x, acc[i]);
+  }
+  return TNorm::is_max ? _mm512_reduce_max_pd(x) : _mm512_reduce_add_pd(x);
+}
+
+template <typename TNumber, class TNorm>
+ZENTAS_TARGET_AVX512 double avx512_kernel(
+  const TNumber* a, const TNumber* b, size_t dimension, double threshold, size_t& n_visited)
+{
+  __m512d acc[avx512_n_regs];
+  __m512d diffs[avx512_n_regs];
+  for (size_t i = 0; i < avx512_n_regs; ++i)
+  {
+    acc[i] = _mm512_setzero_pd();
+  }
+
+  double distance = 0;
+  size_t d        = 0;
+  for (; d + dense_block_size <= dimension; d += dense_block_size)
+  {
+    avx512_diffs(a + d, b + d, diffs);
+    for (size_t i = 0; i < avx512_n_regs; ++i)
+    {
+      acc[i] = avx512_update(TNorm(), acc[i], diffs[i]);
+    }
+    distance = avx512_reduce<TNorm>(acc);
+    if (distance > threshold)
+    {
+      n_visited = d + dense_block_size;
+      return distance;
+    }
+  }
+  scalar_accumulate<TNumber, TNorm>(a, b, d, dimension, distance);
+  n_visited = dimension;
+  return distance;
+}
+
+/* as avx512_kernel, for batch_width samples at a time, sharing the loads of a. The
+ * accumulations of all batch_width samples continue until all are over their thresholds, but
+ * the distance of a sample is frozen at the block where it goes over, so the distances are
+ * identical to those of avx512_kernel. There is no intermediate reduction for samples without
+ * a threshold. A final incomplete batch is processed one sample at a time. */
+template <typename TNumber, class TNorm>
+ZENTAS_TARGET_AVX512 void avx512_batch_kernel(const TNumber*              a,
+                                              const TNumber* const* const bs,
+                                              size_t                      n_bs,
+                                              size_t                      dimension,
+                                              const double* const         thresholds,
+                                              double* const               distances,
+                                              size_t&                     n_visited)
+{
+  __m512d acc[batch_width][avx512_n_regs];
+  __m512d diffs[avx512_n_regs];
+  bool    active[batch_width];
+  size_t  n_active;
+  size_t  d;
+  size_t  s0 = 0;
+
+  n_visited = 0;
+  for (; s0 + batch_width <= n_bs; s0 += batch_width)
+  {
+    for (size_t s = 0; s < batch_width; ++s)
+    {
+      for (size_t i = 0; i < avx512_n_regs; ++i)
+      {
+        acc[s][i] = _mm512_setzero_pd();
+      }
+      active[s] = true;
+    }
+    n_active = batch_width;
+
+    for (d = 0; d + dense_block_size <= dimension && n_active > 0; d += dense_block_size)
+    {
+      for (size_t s = 0; s < batch_width; ++s)
+      {
+        avx512_diffs(a + d, bs[s0 + s] + d, diffs);
+        for (size_t i = 0; i < avx512_n_regs; ++i)
+        {
+          acc[s][i] = avx512_update(TNorm(), acc[s][i], diffs[i]);
+        }
+      }
+
+      for (size_t s = 0; s < batch_width; ++s)
+      {
+        if (active[s] && thresholds[s0 + s] < std::numeric_limits<double>::max())
+        {
+          distances[s0 + s] = avx512_reduce<TNorm>(acc[s]);
+          if (distances[s0 + s] > thresholds[s0 + s])
+          {
+            active[s] = false;
+            --n_active;
+            n_visited += d + dense_block_size;
+          }
+        }
+      }
+    }
+
+    for (size_t s = 0; s < batch_width; ++s)
+    {
+      if (active[s])
+      {
+        distances[s0 + s] = avx512_reduce<TNorm>(acc[s]);
+        scalar_accumulate<TNumber, TNorm>(a, bs[s0 + s], d, dimension, distances[s0 + s]);
+        n_visited += dimension;
+      }
+    }
+  }
+
+  size_t s_visited;
+  for (; s0 < n_bs; ++s0)
+  {
+    distances[s0] = avx512_kernel<TNumber, TNorm>(a, bs[s0], dimension, thresholds[s0], s_visited);
+    n_visited += s_visited;
+  }
+}
+
+ZENTAS_TARGET_AVX512 inline void avx512_widen(const double* a, __m512d* x)
+{
+  for (size_t i = 0; i < avx512_n_regs; ++i)
+  {
+    x[i] = _mm512_loadu_pd(a + 8 * i);
+  }
+}
+
+ZENTAS_TARGET_AVX512 inline void avx512_widen(const float* a, __m512d* x)
+{
+  for (size_t i = 0; i < avx512_n_regs; ++i)
+  {
+    x[i] = _mm512_cvtps_pd(_mm256_loadu_ps(a + 8 * i));
+  }
+}
+
+template <typename TNumber>
+ZENTAS_TARGET_AVX512 double avx512_dot(const TNumber* a, const TNumber* b, size_t dimension)
+{
+  __m512d acc[avx512_n_regs];
+  __m512d wa[avx512_n_regs];
+  __m512d wb[avx512_n_regs];
+  for (size_t i = 0; i < avx512_n_regs; ++i)
+  {
+    acc[i] = _mm512_setzero_pd();
+  }
+
+  size_t d = 0;
+  for (; d + dense_block_size <= dimension; d += dense_block_size)
+  {
+    avx512_widen(a + d, wa);
+    avx512_widen(b + d, wb);
+    for (size_t i = 0; i < avx512_n_regs; ++i)
+    {
+      acc[i] = _mm512_fmadd_pd(wa[i], wb[i], acc[i]);
+    }
+  }
+  double dot = avx512_reduce<L2Norm>(acc);
+  scalar_dot_accumulate(a, b, d, dimension, dot);
+  return dot;
+}
+
+#endif
+
+enum class Isa
+{
+  scalar,
+  sse2,
+  avx2,
+  avx512f
+};
+
+Isa detect_isa()
+{
+#ifdef ZENTAS_LPKERNELS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+  {
+    return Isa::avx512f;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+  {
+    return Isa::avx2;
+  }
+  return Isa::sse2;
+#else
+  return Isa::scalar;
+#endif
+}
+
+Isa get_isa()
+{
+  static const Isa isa = detect_isa();
+  return isa;
+}
+
+std::string get_dense_lp_isa()
+{
+  switch (get_isa())
+  {
+  case Isa::avx512f: return "avx512f";
+  case Isa::avx2: return "avx2";
+  case Isa::sse2: return "sse2";
+  default: return "scalar";
+  }
+}
+
+template <typename TNumber, class TNorm>
+DenseLpKernel<TNumber> get_norm_kernel()
+{
+  switch (get_isa())
+  {
+#ifdef ZENTAS_LPKERNELS_X86
+  case Isa::avx512f: return avx512_kernel<TNumber, TNorm>;
+  case Isa::avx2: return avx2_kernel<TNumber, TNorm>;
+  case Isa::sse2: return sse2_kernel<TNumber, TNorm>;
+#endif
+  default: return scalar_kernel<TNumber, TNorm>;
+  }
+}
+
+template <typename TNumber, class TNorm>
+DenseLpBatchKernel<TNumber> get_norm_batch_kernel()
+{
+  switch (get_isa())
+  {
+#ifdef ZENTAS_LPKERNELS_X86
+  case Isa::avx512f: return avx512_batch_kernel<TNumber, TNorm>;
+  case Isa::avx2: return avx2_batch_kernel<TNumber, TNorm>;
+  case Isa::sse2: return sse2_batch_kernel<TNumber, TNorm>;
+#endif
+  default: return scalar_batch_kernel<TNumber, TNorm>;
+  }
+}
+
+template <typename TNumber>
+DenseLpKernel<TNumber> get_dense_lp_kernel(char p)
+{
+  switch (p)
+  {
+  case '0': return get_norm_kernel<TNumber, L0Norm>();
+  case '1': return get_norm_kernel<TNumber, L1Norm>();
+  case '2': return get_norm_kernel<TNumber, L2Norm>();
+  case 'i': return get_norm_kernel<TNumber, LooNorm>();
+  default:
+    std::string err = "No dense kernel for p = ";
+    err             = err + p;
+    throw zentas::zentas_error(err);
+  }
+}
+
+template <typename TNumber>
+DenseLpBatchKernel<TNumber> get_dense_lp_batch_kernel(char p)
+{
+  switch (p)
+  {
+  case '0': return get_norm_batch_kernel<TNumber, L0Norm>();
+  case '1': return get_norm_batch_kernel<TNumber, L1Norm>();
+  case '2': return get_norm_batch_kernel<TNumber, L2Norm>();
+  case 'i': return get_norm_batch_kernel<TNumber, LooNorm>();
+  default:
+    std::string err = "No dense batch kernel for p = ";
+    err             = err + p;
+    throw zentas::zentas_error(err);
+  }
+}
+
+template <typename TNumber>
+DenseDotKernel<TNumber> get_dense_dot_kernel()
+{
+  switch (get_isa())
+  {
+#ifdef ZENTAS_LPKERNELS_X86
+  case Isa::avx512f: return avx512_dot<TNumber>;
+  case Isa::avx2: return avx2_dot<TNumber>;
+  case Isa::sse2: return sse2_dot<TNumber>;
+#endif
+  default: return scalar_dot<TNumber>;
+  }
+}
+
+template <typename TCode, class TNorm>
+QuantisedLpKernel<TCode> get_quantised_norm_kernel()
+{
+  switch (get_isa())
+  {
+#ifdef ZENTAS_LPKERNELS_X86
+  case Isa::avx512f:
+  case Isa::avx2: return avx2_quantised_kernel<TCode, TNorm>;
+#endif
+  default: return scalar_quantised_kernel<TCode, TNorm>;
+  }
+}
+
+template <typename TCode>
+QuantisedLpKernel<TCode> get_quantised_lp_kernel(char p)
+{
+  switch (p)
+  {
+  case '0': return get_quantised_norm_kernel<TCode, L0Norm>();
+  case '1': return get_quantised_norm_kernel<TCode, L1Norm>();
+  case '2': return get_quantised_norm_kernel<TCode, L2Norm>();
+  case 'i': return get_quantised_norm_kernel<TCode, LooNorm>();
+  default:
+    std::string err = "No quantised kernel for p = ";
+    err             = err + p;
+    throw zentas::zentas_error(err);
+  }
+}
+
+template <typename TNumber>
+SparseDotKernel<TNumber> get_sparse_dot_kernel()
+{
+  switch (get_isa())
+  {
+#ifdef ZENTAS_LPKERNELS_X86
+  case Isa::avx512f:
+  case Isa::avx2: return avx2_sparse_dot<TNumber>;
+#endif
+  default: return scalar_sparse_dot<TNumber>;
+  }
+}
+
+template DenseLpKernel<float> get_dense_lp_kernel(char p);
+template DenseLpKernel<double> get_dense_lp_kernel(char p);
+template DenseLpBatchKernel<float> get_dense_lp_batch_kernel(char p);
+template DenseLpBatchKernel<double> get_dense_lp_batch_kernel(char p);
+template DenseDotKernel<float> get_dense_dot_kernel();
+template DenseDotKernel<double> get_dense_dot_kernel();
+template SparseDotKernel<float> get_sparse_dot_kernel();
+template SparseDotKernel<double> get_sparse_dot_kernel();
+template QuantisedLpKernel<Float16> get_quantised_lp_kernel(char p);
+template QuantisedLpKernel<BFloat16> get_quantised_lp_kernel(char p);
+template QuantisedLpKernel<int8_t> get_quantised_lp_kernel(char p);
+}
+}
@@ -1,11 +1,54 @@
 // Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
 // Written by James Newling <jnewling@idiap.ch>
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
 #include <zentas/lpmetric.hpp>
 
 namespace nszen
 {
 
+namespace
+{
+std::mutex          thread_index_mutex;
+std::vector<size_t> free_thread_indices;
+size_t              n_thread_indices = 0;
+}
+
+ThreadIndex::ThreadIndex()
+{
+  std::lock_guard<std::mutex> lock(thread_index_mutex);
+  if (free_thread_indices.size() == 0)
+  {
+    index = n_thread_indices;
+    ++n_thread_indices;
+  }
+  else
+  {
+    /* the smallest free index, so that the indices stay below the number of threads alive */
+    auto iter = std::min_element(free_thread_indices.begin(), free_thread_indices.end());
+    index     = *iter;
+    free_thread_indices.erase(iter);
+  }
+}
+
+ThreadIndex::~ThreadIndex()
+{
+  std::lock_guard<std::mutex> lock(thread_index_mutex);
+  free_thread_indices.push_back(index);
+}
+
+size_t get_n_distance_counts(size_t nthreads)
+{
+  size_t n_counts = 1;
+  while (n_counts < nthreads + 1)
+  {
+    n_counts *= 2;
+  }
+  return n_counts;
+}
+
 LpMetricInitializer::LpMetricInitializer(
   char p_, bool do_refinement_, std::string rf_alg_, size_t rf_max_rounds_, double rf_max_time_)
   : p(p_),
@@ -50,10 +93,21 @@ void LpMetricInitializer::reset(std::string metric,
     p = '0';
   }
 
+  else if (metric.compare("cosine") == 0)
+  {
+    p = 'c';
+  }
+
+  else if (metric.compare("angular") == 0)
+  {
+    p = 'a';
+  }
+
   else
   {
     std::stringstream ss;
-    ss << "Currently, only li (inf) & l0 & l1 & l2 metrics are implemented for vector data, not `"
+    ss << "Currently, only li (inf) & l0 & l1 & l2 & cosine & angular metrics are implemented for "
+          "vector data, not `"
        << metric << "'.";
     throw zentas::zentas_error(ss.str());
   }
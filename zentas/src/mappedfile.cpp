@@ -0,0 +1,158 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zentas/mappedfile.hpp>
+
+namespace nszen
+{
+
+/* the MappedFiles which exist, for advise_mapped_files */
+static std::mutex                  mapped_files_mutex;
+static std::set<const MappedFile*> mapped_files;
+
+MappedFile::MappedFile(const std::string& filename_) : filename(filename_), data(nullptr), size(0)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throw zentas::zentas_error("Error opening '" + filename + "'. ");
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    throw zentas::zentas_error("Error getting the size of '" + filename + "', or it is empty. ");
+  }
+  size = static_cast<size_t>(st.st_size);
+
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  /* the mapping holds its own reference to the file */
+  close(fd);
+  if (addr == MAP_FAILED)
+  {
+    throw zentas::zentas_error("Error memory mapping '" + filename + "'. ");
+  }
+  data = static_cast<const char*>(addr);
+
+  std::lock_guard<std::mutex> lockraii(mapped_files_mutex);
+  mapped_files.insert(this);
+}
+
+MappedFile::~MappedFile()
+{
+  {
+    std::lock_guard<std::mutex> lockraii(mapped_files_mutex);
+    mapped_files.erase(this);
+  }
+  munmap(const_cast<char*>(data), size);
+}
+
+void MappedFile::advise(AccessAdvice advice) const
+{
+  int posix_advice = advice == AccessAdvice::sequential
+                       ? POSIX_MADV_SEQUENTIAL
+                       : advice == AccessAdvice::random ? POSIX_MADV_RANDOM : POSIX_MADV_NORMAL;
+  /* a hint : failure is not an error */
+  posix_madvise(const_cast<char*>(data), size, posix_advice);
+}
+
+void advise_mapped_files(AccessAdvice advice)
+{
+  std::lock_guard<std::mutex> lockraii(mapped_files_mutex);
+  for (auto& x : mapped_files)
+  {
+    x->advise(advice);
+  }
+}
+
+/* the value (after the colon) of key in the header dictionary of a .npy file */
+static std::string get_npy_header_value(const std::string& header, const std::string& key)
+{
+  size_t key_start = header.find("'" + key + "'");
+  if (key_start == std::string::npos)
+  {
+    throw zentas::zentas_error("the header of the .npy file has no " + key);
+  }
+  size_t value_start = header.find(':', key_start) + 1;
+  while (value_start < header.size() && header[value_start] == ' ')
+  {
+    ++value_start;
+  }
+  /* the shape is a tuple, which contains commas */
+  size_t value_end = header[value_start] == '(' ? header.find(')', value_start) + 1
+                                                 : header.find_first_of(",}", value_start);
+  return header.substr(value_start, value_end - value_start);
+}
+
+NpyArray::NpyArray(const std::string& filename) : file(filename)
+{
+  const char* bytes = file.get_data();
+  if (file.get_size() < 10 || std::memcmp(bytes, "\x93NUMPY", 6) != 0)
+  {
+    throw zentas::zentas_error("'" + filename + "' is not a .npy file (no magic string)");
+  }
+
+  /* version 1 has a 2 byte header length, versions 2 and 3 have 4 bytes, little endian */
+  size_t header_start = bytes[6] == 1 ? 10 : 12;
+  size_t header_size  = 0;
+  for (size_t b = header_start - 1; b >= 8; --b)
+  {
+    header_size = 256 * header_size + static_cast<uint8_t>(bytes[b]);
+  }
+  data_offset = header_start + header_size;
+  if (data_offset > file.get_size())
+  {
+    throw zentas::zentas_error("the header of '" + filename + "' is truncated");
+  }
+  std::string header(bytes + header_start, header_size);
+
+  descr = get_npy_header_value(header, "descr");
+  descr = descr.substr(1, descr.size() - 2);
+  uint16_t endian_test = 1;
+  if (descr.size() < 3 || descr[0] == '>' ||
+      *reinterpret_cast<const uint8_t*>(&endian_test) != 1)
+  {
+    throw zentas::zentas_error("the dtype of '" + filename + "' (" + descr +
+                               ") is not supported, it should be little endian");
+  }
+
+  if (get_npy_header_value(header, "fortran_order") != "False")
+  {
+    throw zentas::zentas_error("'" + filename + "' is fortran ordered, it should be C ordered");
+  }
+
+  std::string shape_string = get_npy_header_value(header, "shape");
+  n_values                 = 1;
+  for (size_t i = 0; i < shape_string.size(); ++i)
+  {
+    if (std::isdigit(shape_string[i]))
+    {
+      size_t n_digits = 1;
+      while (std::isdigit(shape_string[i + n_digits]))
+      {
+        ++n_digits;
+      }
+      shape.push_back(std::stoul(shape_string.substr(i, n_digits)));
+      n_values *= shape.back();
+      i += n_digits;
+    }
+  }
+
+  size_t value_size = std::stoul(descr.substr(2));
+  if (data_offset + n_values * value_size > file.get_size())
+  {
+    throw zentas::zentas_error("'" + filename + "' is shorter than its header states");
+  }
+}
+
+}  // namespace nszen
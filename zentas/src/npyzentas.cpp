@@ -0,0 +1,239 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <zentas/mappedfile.hpp>
+#include <zentas/zentas.hpp>
+#include <zentas/zentaserror.hpp>
+
+namespace nszen
+{
+
+/* The data of the npy functions stays in the memory mapped files : the clusterings are rooted,
+ * and vdimap, quantised and packed storage (which make copies) are not options. Nor is
+ * refinement, which is not implemented for rooted data. With reorder_interval > 0 the dense and
+ * sparse vectors are copied into memory, ordered by cluster, after initialisation. The
+ * sequences have no StringProfiles, which are built in memory. Except with the hamming metric,
+ * for which the sequences are packed into memory (see set_packed_sequences), at 1 to 8 bits per
+ * int8 or S1 value (1 to 32 per int32 value), in whole 64-bit words per sequence. */
+
+void npyvzentas(std::string         filename,
+                size_t              K,
+                const size_t* const indices_init,
+                std::string         initialisation_method,
+                std::string         algorithm,
+                size_t              level,
+                size_t              max_proposals,
+                bool                capture_output,
+                std::string&        text,
+                size_t              seed,
+                double              max_time,
+                double              min_mE,
+                double              max_itok,
+                size_t* const       indices_final,
+                size_t* const       labels,
+                std::string         metric,
+                size_t              nthreads,
+                size_t              max_rounds,
+                bool                patient,
+                std::string         energy,
+                bool                with_tests,
+                double              critical_radius,
+                double              exponent_coeff,
+                size_t              reorder_interval,
+                bool                do_balance_labels)
+{
+
+  NpyArray X(filename);
+  if (X.get_shape().size() != 2)
+  {
+    throw zentas::zentas_error("the array in '" + filename +
+                               "' should be 2-dimensional, (ndata, dimension)");
+  }
+
+  size_t ndata     = X.get_shape()[0];
+  size_t dimension = X.get_shape()[1];
+
+  if (X.is_of_type<float>())
+  {
+    vzentas<float>(ndata, dimension, X.get_data<float>(), K, indices_init, initialisation_method,
+                   algorithm, level, max_proposals, capture_output, text, seed, max_time, min_mE,
+                   max_itok, indices_final, labels, metric, nthreads, max_rounds, patient, energy,
+                   with_tests, true, critical_radius, exponent_coeff, false, false, "", 0, 0,
+                   do_balance_labels, "full", reorder_interval);
+  }
+
+  else if (X.is_of_type<double>())
+  {
+    vzentas<double>(ndata, dimension, X.get_data<double>(), K, indices_init,
+                    initialisation_method, algorithm, level, max_proposals, capture_output, text,
+                    seed, max_time, min_mE, max_itok, indices_final, labels, metric, nthreads,
+                    max_rounds, patient, energy, with_tests, true, critical_radius, exponent_coeff,
+                    false, false, "", 0, 0, do_balance_labels, "full", reorder_interval);
+  }
+
+  else
+  {
+    throw zentas::zentas_error("the dtype of '" + filename + "' is " + X.get_descr() +
+                               ", it should be float32 or float64");
+  }
+}
+
+/* the sizes (and the indices) of sparse vectors and sequences are size_t */
+static const size_t* get_npy_sizes(const NpyArray& sizes, size_t n_values)
+{
+  if (sizes.get_shape().size() != 1)
+  {
+    throw zentas::zentas_error("the array of sizes should be 1-dimensional");
+  }
+  const size_t* ptr_sizes = sizes.get_data<size_t>();
+
+  size_t sum_sizes = 0;
+  for (size_t i = 0; i < sizes.get_n_values(); ++i)
+  {
+    sum_sizes += ptr_sizes[i];
+  }
+  if (sum_sizes != n_values)
+  {
+    throw zentas::zentas_error("the sum of sizes (" + std::to_string(sum_sizes) +
+                               ") is not the number of values (" + std::to_string(n_values) +
+                               ")");
+  }
+  return ptr_sizes;
+}
+
+void npysparse_vector_zentas(std::string         sizes_filename,
+                             std::string         values_filename,
+                             std::string         indices_filename,
+                             size_t              K,
+                             const size_t* const indices_init,
+                             std::string         initialisation_method,
+                             std::string         algorithm,
+                             size_t              level,
+                             size_t              max_proposals,
+                             bool                capture_output,
+                             std::string&        text,
+                             size_t              seed,
+                             double              max_time,
+                             double              min_mE,
+                             double              max_itok,
+                             size_t* const       indices_final,
+                             size_t* const       labels,
+                             std::string         metric,
+                             size_t              nthreads,
+                             size_t              max_rounds,
+                             bool                patient,
+                             std::string         energy,
+                             bool                with_tests,
+                             double              critical_radius,
+                             double              exponent_coeff,
+                             size_t              reorder_interval,
+                             bool                do_balance_labels)
+{
+
+  NpyArray sizes(sizes_filename);
+  NpyArray values(values_filename);
+  NpyArray indices(indices_filename);
+
+  const size_t* ptr_sizes = get_npy_sizes(sizes, values.get_n_values());
+  if (indices.get_n_values() != values.get_n_values())
+  {
+    throw zentas::zentas_error("the number of indices is not the number of values");
+  }
+  size_t ndata = sizes.get_n_values();
+
+  if (values.is_of_type<float>())
+  {
+    sparse_vector_zentas<float>(
+      ndata, ptr_sizes, values.get_data<float>(), indices.get_data<size_t>(), K, indices_init,
+      initialisation_method, algorithm, level, max_proposals, capture_output, text, seed,
+      max_time, min_mE, max_itok, indices_final, labels, metric, nthreads, max_rounds, patient,
+      energy, with_tests, true, critical_radius, exponent_coeff, false, "", 0, 0,
+      do_balance_labels, reorder_interval);
+  }
+
+  else if (values.is_of_type<double>())
+  {
+    sparse_vector_zentas<double>(
+      ndata, ptr_sizes, values.get_data<double>(), indices.get_data<size_t>(), K, indices_init,
+      initialisation_method, algorithm, level, max_proposals, capture_output, text, seed,
+      max_time, min_mE, max_itok, indices_final, labels, metric, nthreads, max_rounds, patient,
+      energy, with_tests, true, critical_radius, exponent_coeff, false, "", 0, 0,
+      do_balance_labels, reorder_interval);
+  }
+
+  else
+  {
+    throw zentas::zentas_error("the dtype of '" + values_filename + "' is " + values.get_descr() +
+                               ", it should be float32 or float64");
+  }
+}
+
+void npyszentas(std::string         sizes_filename,
+                std::string         values_filename,
+                size_t              K,
+                const size_t* const indices_init,
+                std::string         initialisation_method,
+                std::string         algorithm,
+                size_t              level,
+                size_t              max_proposals,
+                bool                capture_output,
+                std::string&        text,
+                size_t              seed,
+                double              max_time,
+                double              min_mE,
+                double              max_itok,
+                size_t* const       indices_final,
+                size_t* const       labels,
+                std::string         metric,
+                size_t              nthreads,
+                size_t              max_rounds,
+                bool                patient,
+                std::string         energy,
+                bool                with_tests,
+                bool                with_cost_matrices,
+                size_t              dict_size,
+                double              c_indel,
+                double              c_switch,
+                const double* const c_indel_arr,
+                const double* const c_switches_arr,
+                size_t              distance_cache_size,
+                double              critical_radius,
+                double              exponent_coeff,
+                bool                do_balance_labels)
+{
+
+  NpyArray sizes(sizes_filename);
+  NpyArray values(values_filename);
+
+  const size_t* ptr_sizes = get_npy_sizes(sizes, values.get_n_values());
+  size_t        ndata     = sizes.get_n_values();
+
+  if (values.is_of_type<char>())
+  {
+    /* with_profiles is false, see above */
+    szentas<char>(ndata, ptr_sizes, values.get_data<char>(), K, indices_init,
+                  initialisation_method, algorithm, level, max_proposals, capture_output, text,
+                  seed, max_time, min_mE, max_itok, indices_final, labels, metric, nthreads,
+                  max_rounds, patient, energy, with_tests, true, with_cost_matrices, dict_size,
+                  c_indel, c_switch, c_indel_arr, c_switches_arr, critical_radius, exponent_coeff,
+                  do_balance_labels, distance_cache_size, "full", false);
+  }
+
+  else if (values.is_of_type<int>())
+  {
+    szentas<int>(ndata, ptr_sizes, values.get_data<int>(), K, indices_init,
+                 initialisation_method, algorithm, level, max_proposals, capture_output, text,
+                 seed, max_time, min_mE, max_itok, indices_final, labels, metric, nthreads,
+                 max_rounds, patient, energy, with_tests, true, with_cost_matrices, dict_size,
+                 c_indel, c_switch, c_indel_arr, c_switches_arr, critical_radius, exponent_coeff,
+                 do_balance_labels, distance_cache_size, "full", false);
+  }
+
+  else
+  {
+    throw zentas::zentas_error("the dtype of '" + values_filename + "' is " + values.get_descr() +
+                               ", it should be int8, bytes (S1) or int32");
+  }
+}
+
+}  // namespace nszen
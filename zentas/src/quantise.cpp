@@ -0,0 +1,242 @@
+// Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
+// Written by James Newling <jnewling@idiap.ch>
+
+#include <zentas/lpkernels.hpp>
+#include <zentas/quantise.hpp>
+#include <zentas/zentaserror.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace nszen
+{
+
+/* round to nearest even. |x| <= 1, so there is no overflow. From F. Giesen's float_to_half. */
+Float16 to_code(float x, Float16)
+{
+  uint32_t bits = float_to_bits(x);
+  uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+  uint32_t half_bits;
+  /* the half is subnormal or zero : a magic addition aligns the 10 mantissa bits at the
+   * bottom of the float, with the rounding done by the float addition. */
+  if (bits < (113u << 23))
+  {
+    uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    half_bits =
+      float_to_bits(bits_to_float(bits) + bits_to_float(denorm_magic)) - denorm_magic;
+  }
+  else
+  {
+    uint32_t mantissa_odd = (bits >> 13) & 1u;
+    bits += ((15u - 127u) << 23) + 0xfffu + mantissa_odd;
+    half_bits = bits >> 13;
+  }
+  return {static_cast<uint16_t>(half_bits | (sign >> 16))};
+}
+
+/* round to nearest even */
+BFloat16 to_code(float x, BFloat16)
+{
+  uint32_t bits = float_to_bits(x);
+  bits += 0x7fffu + ((bits >> 16) & 1u);
+  return {static_cast<uint16_t>(bits >> 16)};
+}
+
+int8_t to_code(float x, int8_t) { return static_cast<int8_t>(std::round(x)); }
+
+/* the value of the largest code */
+float get_max_code(Float16) { return 1.f; }
+float get_max_code(BFloat16) { return 1.f; }
+float get_max_code(int8_t) { return 127.f; }
+
+template <typename TAtomic, typename TCode>
+void set_dense_quantisation(size_t               ndata,
+                            size_t               dimension,
+                            const TAtomic* const data,
+                            DenseQuantisation&   quantisation,
+                            std::vector<TCode>&  codes)
+{
+  std::vector<TAtomic> mins(dimension, std::numeric_limits<TAtomic>::max());
+  std::vector<TAtomic> maxs(dimension, std::numeric_limits<TAtomic>::lowest());
+  for (size_t i = 0; i < ndata; ++i)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      mins[d] = std::min(mins[d], data[i * dimension + d]);
+      maxs[d] = std::max(maxs[d], data[i * dimension + d]);
+    }
+  }
+
+  quantisation.offsets.resize(dimension);
+  quantisation.scales.resize(dimension);
+  float max_code = get_max_code(TCode());
+  for (size_t d = 0; d < dimension; ++d)
+  {
+    quantisation.offsets[d] = static_cast<float>(mins[d] / 2. + maxs[d] / 2.);
+    quantisation.scales[d]  = static_cast<float>((maxs[d] / 2. - mins[d] / 2.) / max_code);
+    if (std::isfinite(quantisation.scales[d]) == false)
+    {
+      throw zentas::zentas_error("the range of the data in a dimension is too large to be "
+                                 "stored with reduced precision");
+    }
+    /* constant in dimension d : all codes are zero */
+    if (quantisation.scales[d] == 0)
+    {
+      quantisation.scales[d] = 1.f;
+    }
+  }
+
+  codes.resize(ndata * dimension);
+  float x;
+  for (size_t i = 0; i < ndata; ++i)
+  {
+    for (size_t d = 0; d < dimension; ++d)
+    {
+      x = static_cast<float>((data[i * dimension + d] - quantisation.offsets[d]) /
+                             quantisation.scales[d]);
+      codes[i * dimension + d] = to_code(std::max(-max_code, std::min(max_code, x)), TCode());
+    }
+  }
+}
+
+template <typename TAtomic>
+void reverify_medoids(size_t                               ndata,
+                      size_t                               dimension,
+                      const TAtomic* const                 data,
+                      size_t                               K,
+                      char                                 p,
+                      const std::function<double(double)>& f_energy,
+                      size_t                               nthreads,
+                      const size_t* const                  labels,
+                      size_t* const                        indices_final,
+                      std::ostream&                        out)
+{
+  /* the number of members nearest to the medoid considered as alternatives */
+  constexpr size_t n_candidates = 16;
+
+  lpkernels::DenseLpKernel<TAtomic> kernel = lpkernels::get_dense_lp_kernel<TAtomic>(p);
+
+  auto get_distance = [kernel, dimension, data, p](size_t i1, size_t i2) {
+    size_t n_visited;
+    double distance = kernel(data + i1 * dimension,
+                             data + i2 * dimension,
+                             dimension,
+                             std::numeric_limits<double>::max(),
+                             n_visited);
+    return p == '2' ? std::sqrt(distance) : distance;
+  };
+
+  std::vector<std::vector<size_t>> members(K);
+  for (size_t i = 0; i < ndata; ++i)
+  {
+    members[labels[i]].push_back(i);
+  }
+
+  std::vector<double> old_energies(K, 0);
+  std::vector<double> new_energies(K, 0);
+
+  auto reverify = [&](size_t k) {
+    const std::vector<size_t>& x = members[k];
+    std::vector<std::pair<double, size_t>> to_medoid(x.size());
+    double                                 best_energy = 0;
+    for (size_t j = 0; j < x.size(); ++j)
+    {
+      to_medoid[j] = {get_distance(indices_final[k], x[j]), x[j]};
+      best_energy += f_energy(to_medoid[j].first);
+    }
+    old_energies[k] = best_energy;
+
+    size_t n_considered = std::min(n_candidates + 1, x.size());
+    std::partial_sort(to_medoid.begin(), to_medoid.begin() + n_considered, to_medoid.end());
+
+    for (size_t c = 0; c < n_considered; ++c)
+    {
+      size_t candidate = to_medoid[c].second;
+      if (candidate == indices_final[k])
+      {
+        continue;
+      }
+      /* abandoned as soon as it is no better than the best so far */
+      double energy = 0;
+      for (size_t j = 0; j < x.size() && energy < best_energy; ++j)
+      {
+        energy += f_energy(get_distance(candidate, x[j]));
+      }
+      if (energy < best_energy)
+      {
+        best_energy      = energy;
+        indices_final[k] = candidate;
+      }
+    }
+    new_energies[k] = best_energy;
+  };
+
+  std::vector<size_t> old_indices_final(indices_final, indices_final + K);
+  nthreads = std::max<size_t>(1, std::min(nthreads, K));
+  std::vector<std::thread> threads;
+  for (size_t ti = 0; ti < nthreads; ++ti)
+  {
+    threads.emplace_back([ti, nthreads, K, &reverify]() {
+      for (size_t k = ti; k < K; k += nthreads)
+      {
+        reverify(k);
+      }
+    });
+  }
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  size_t n_changed  = 0;
+  double old_energy = 0;
+  double new_energy = 0;
+  for (size_t k = 0; k < K; ++k)
+  {
+    n_changed += (old_indices_final[k] != indices_final[k]);
+    old_energy += old_energies[k];
+    new_energy += new_energies[k];
+  }
+
+  out << "full precision medoid check : " << n_changed << " of " << K
+      << " medoids changed, mean energy " << old_energy / ndata << " -> " << new_energy / ndata
+      << "\n";
+}
+
+template void set_dense_quantisation(
+  size_t, size_t, const float* const, DenseQuantisation&, std::vector<Float16>&);
+template void set_dense_quantisation(
+  size_t, size_t, const float* const, DenseQuantisation&, std::vector<BFloat16>&);
+template void set_dense_quantisation(
+  size_t, size_t, const float* const, DenseQuantisation&, std::vector<int8_t>&);
+template void set_dense_quantisation(
+  size_t, size_t, const double* const, DenseQuantisation&, std::vector<Float16>&);
+template void set_dense_quantisation(
+  size_t, size_t, const double* const, DenseQuantisation&, std::vector<BFloat16>&);
+template void set_dense_quantisation(
+  size_t, size_t, const double* const, DenseQuantisation&, std::vector<int8_t>&);
+
+template void reverify_medoids(size_t,
+                               size_t,
+                               const float* const,
+                               size_t,
+                               char,
+                               const std::function<double(double)>&,
+                               size_t,
+                               const size_t* const,
+                               size_t* const,
+                               std::ostream&);
+template void reverify_medoids(size_t,
+                               size_t,
+                               const double* const,
+                               size_t,
+                               char,
+                               const std::function<double(double)>&,
+                               size_t,
+                               const size_t* const,
+                               size_t* const,
+                               std::ostream&);
+}
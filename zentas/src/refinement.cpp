@@ -37,11 +37,11 @@ void ExponionData::specific_initialise_from_n1n2(const XNInfos& nearest_1_infos,
   v_b.resize(K);
   for (size_t k = 0; k < K; ++k)
   {
-    size_t ndata_k = nearest_2_infos[k].size();
+    size_t ndata_k = nearest_2_infos.size(k);
     v_b[k].resize(ndata_k);
-    for (size_t j = 0; j < nearest_2_infos[k].size(); ++j)
+    for (size_t j = 0; j < nearest_2_infos.size(k); ++j)
     {
-      v_b[k][j] = nearest_2_infos[k][j].a_x;
+      v_b[k][j] = nearest_2_infos.get_a(k, j);
     }
   }
   delta_C.resize(K, 0);
@@ -65,7 +65,7 @@ void YinyangData::specific_custom_remove_last(size_t k) { glt_ID[k].pop_back();
 
 void YinyangData::specific_custom_replace_with_last(size_t k, size_t j)
 {
-  glt_ID[k][j] = glt_ID[k].back();
+  glt_ID[k].set(j, glt_ID[k].back());
 }
 
 void YinyangData::specific_initialise_from_n1n2(const XNInfos& nearest_1_infos,
@@ -101,13 +101,13 @@ void YinyangData::specific_final_initialise_memory()
   t_gps.resize(ndata * rf_n_groups);
 
   size_t running_ID = 0;
-  glt_ID.resize(K);
+  glt_ID.assign(K, SampleIDVector(is_wide_sample_IDs(ndata)));
   for (size_t k = 0; k < K; ++k)
   {
     glt_ID[k].resize(get_ndata(k));
     for (size_t j = 0; j < get_ndata(k); ++j)
     {
-      glt_ID[k][j] = running_ID;
+      glt_ID[k].set(j, running_ID);
       ++running_ID;
     }
   }
@@ -152,13 +152,13 @@ void RefinementData::initialise_from_n1n2(const XNInfos& nearest_1_infos,
   upper_1.resize(K);
   for (size_t k = 0; k < K; ++k)
   {
-    size_t ndata_k = nearest_1_infos[k].size();
+    size_t ndata_k = nearest_1_infos.size(k);
     lower_2[k].resize(ndata_k);
     upper_1[k].resize(ndata_k);
-    for (size_t j = 0; j < nearest_2_infos[k].size(); ++j)
+    for (size_t j = 0; j < nearest_2_infos.size(k); ++j)
     {
-      lower_2[k][j] = nearest_2_infos[k][j].d_x;
-      upper_1[k][j] = nearest_1_infos[k][j].d_x;
+      lower_2[k][j] = nearest_2_infos.get_d(k, j);
+      upper_1[k][j] = nearest_1_infos.get_d(k, j);
     }
   }
   delta_C.resize(K, 0);
@@ -174,8 +174,8 @@ size_t RefinementData::get_ndata(size_t k)
 void SkeletonClusterer::rf_swap(size_t k1, size_t k2)
 {
   swap_data(k1, k2);
-  std::swap(nearest_1_infos[k1], nearest_1_infos[k2]);
-  std::swap(sample_IDs[k1], sample_IDs[k2]);
+  nearest_1_infos.swap_clusters(k1, k2);
+  sample_IDs.swap_clusters(k1, k2);
 }
 
 void SkeletonClusterer::initialise_refinement()
@@ -308,12 +308,12 @@ void SkeletonClusterer::initialise_refinement()
 
 void SkeletonClusterer::rf_tighten_nearest(size_t k)
 {
-  double min_d1;
+  std::vector<double> min_d1s(get_ndata(k));
+  set_rf_center_sample_distances(k, k, 0, get_ndata(k), nullptr, min_d1s.data());
   for (size_t j = 0; j < get_ndata(k); ++j)
   {
-    set_rf_center_sample_distance_nothreshold(k, k, j, min_d1);
-    reset_nearest_info(k, j, k, min_d1, f_energy(min_d1));
-    prd->upper_1[k][j] = min_d1;
+    reset_nearest_info(k, j, k, min_d1s[j], f_energy(min_d1s[j]));
+    prd->upper_1[k][j] = min_d1s[j];
   }
 }
 
@@ -623,7 +623,7 @@ void SkeletonClusterer::rf_update_sample_info_exponion()
 
           reset_nearest_info(k, j, min_k1, min_d1, f_energy(min_d1));
           prd->lower_2[k][j] = min_d2;
-          prd->v_b[k][j]     = min_k2;
+          prd->v_b[k][j]     = static_cast<uint32_t>(min_k2);
           prd->upper_1[k][j] = min_d1;
 
           if (min_d1 > prd->u1_C[min_k1])
@@ -812,25 +812,25 @@ void SkeletonClusterer::rf_redistribute()
     {
 
       j     = to_leave_cluster[k][ji];
-      k_new = nearest_1_infos[k][j].a_x;
+      k_new = get_a1(k, j);
 
       rf_cumulative_correction(k_new, k, j);  // correct sums or whatever.
 
-      nearest_1_infos[k_new].push_back(nearest_1_infos[k][j]);
-      sample_IDs[k_new].push_back(sample_IDs[k][j]);
+      nearest_1_infos.append_from(k_new, k, j);
+      sample_IDs.append(k_new, sample_IDs(k, j));
       append_across(k_new, k, j);
       prd->custom_append(k_new, k, j);
 
       // this is `remove_with_tail_pull'
       if (j != get_ndata(k) - 1)
       {
-        nearest_1_infos[k][j] = *(nearest_1_infos[k].end() - 1);
-        sample_IDs[k][j]      = *(sample_IDs[k].end() - 1);
+        nearest_1_infos.replace_with_last(k, j);
+        sample_IDs.replace_with_last(k, j);
         replace_with_last_element(k, j);
         prd->custom_replace_with_last(k, j);
       }
-      nearest_1_infos[k].pop_back();
-      sample_IDs[k].pop_back();
+      nearest_1_infos.remove_last(k);
+      sample_IDs.remove_last(k);
       remove_last(k);
       prd->custom_remove_last(k);
     }
@@ -877,7 +877,7 @@ void SkeletonClusterer::rf_update_energies()
     cluster_energies[k] = 0;
     for (size_t j = 0; j < get_ndata(k); ++j)
     {
-      cluster_energies[k] += nearest_1_infos[k][j].e_x;
+      cluster_energies[k] += get_e1(k, j);
     }
     cluster_mean_energies[k] = cluster_energies[k] / static_cast<double>(get_ndata(k));
     E_total += cluster_energies[k];
@@ -1,18 +1,20 @@
 // Copyright (c) 2016 Idiap Research Institute, http://www.idiap.ch/
 // Written by James Newling <jnewling@idiap.ch>
 
+#include <zentas/mappedfile.hpp>
 #include <zentas/skeletonclusterer.hpp>
 
 namespace nszen
 {
 
-void P2Bundle::initialise_data(size_t n)
+void P2Bundle::initialise_data(size_t n, bool is_wide)
 {
   ndata = n;
   d12_.reset(new std::array<double, 2>[n]);
-  k_1_.reset(new size_t[n]);
-  k_2_.reset(new size_t[n]);
-  ori_.reset(new size_t[n]);
+  k_1_.reset(new uint32_t[n]);
+  k_2_.reset(new uint32_t[n]);
+  ori_ = SampleIDVector(is_wide);
+  ori_.resize(n);
 
   for (unsigned i = 0; i < n; ++i)
   {
@@ -26,14 +28,14 @@ void P2Bundle::initialise_data(size_t n)
   }
 }
 
-P2Bundle::P2Bundle(size_t n) { initialise_data(n); }
+P2Bundle::P2Bundle(size_t n, bool is_wide) { initialise_data(n, is_wide); }
 
-P2Bundle::P2Bundle(const std::vector<size_t>& ori)
+P2Bundle::P2Bundle(const SampleIDVector& ori, bool is_wide)
 {
-  initialise_data(ori.size());
+  initialise_data(ori.size(), is_wide);
   for (size_t i = 0; i < ndata; ++i)
   {
-    ori_[i] = ori[i];
+    ori_.set(i, ori[i]);
   }
 }
 
@@ -105,7 +107,8 @@ SkeletonClusterer::SkeletonClusterer(const SkeletonClustererInitBundle& sb)
     ndata(sb.ndata),
     initialisation_method(sb.init_method),
     nearest_1_infos(K),
-    sample_IDs(K),
+    wide_sample_IDs(is_wide_sample_IDs(ndata)),
+    sample_IDs(K, wide_sample_IDs),
     to_leave_cluster(K),
     cluster_has_changed(K, true),
     cluster_energies(K, 0),
@@ -115,6 +118,7 @@ SkeletonClusterer::SkeletonClusterer(const SkeletonClustererInitBundle& sb)
     round(0),
     v_center_indices_init(K),
     center_indices_init(v_center_indices_init.data()),
+    reordered_positions(wide_sample_IDs),
     max_time_micros(static_cast<size_t>(sb.max_time * 1000000.)),
     min_mE(sb.min_mE),
     max_itok(sb.max_itok),
@@ -126,56 +130,12 @@ SkeletonClusterer::SkeletonClusterer(const SkeletonClustererInitBundle& sb)
     with_tests(sb.with_tests),
     gen(sb.seed),
     kmoo_cc(K * K),
-    kmoo_p2bun(ndata),
+    kmoo_p2bun(ndata, wide_sample_IDs),
     do_balance_labels(sb.do_balance_labels)
 
 {
 
-  if (energy.compare("identity") == 0)
-  {
-    f_energy = nszen::Identity();
-  }
-
-  else if (energy.compare("quadratic") == 0)
-  {
-    f_energy = nszen::Quadratic();
-  }
-
-  else if (energy.compare("cubic") == 0)
-  {
-    f_energy = nszen::Cubic();
-  }
-
-  else if (energy.compare("squarepotential") == 0)
-  {
-    f_energy = nszen::SquarePotential(sb.ptr_energy_initialiser->get_critical_radius());
-  }
-
-  else if (energy.compare("log") == 0)
-  {
-    f_energy = nszen::Log();
-  }
-
-  else if (energy.compare("exp") == 0)
-  {
-    f_energy = nszen::Exponential(sb.ptr_energy_initialiser->get_exponent_coeff());
-  }
-
-  else if (energy.compare("sqrt") == 0)
-  {
-    f_energy = nszen::SquareRoot();
-  }
-
-  else
-  {
-    std::stringstream errmss;
-    errmss << "Unrecognised energy function, `" << energy << "'. ";
-    if (energy == "linear")
-    {
-      errmss << "Perhaps instead of `linear' you meant `identity'?";
-    }
-    throw zentas::zentas_error(std::string() + energy);
-  }
+  f_energy = get_f_energy(energy, *sb.ptr_energy_initialiser);
 
   /* confirm that f_energy(0) is 0 */
   if (f_energy(0) != 0)
@@ -323,7 +283,7 @@ std::string SkeletonClusterer::get_base_summary_string()
 
   std::ostringstream out;
   out << st_round << st_mE << st_Tp << st_Ti << st_Tb << st_Tc << st_Tu << st_Tr << st_Tt << ncc
-      << nc << pc;
+      << nc << pc << get_distance_cache_string();
   return out.str();
 }
 
@@ -331,7 +291,7 @@ std::string SkeletonClusterer::get_base_summary_string()
 void SkeletonClusterer::reset_nearest_info_basic(
   size_t k, size_t j, size_t k_nearest, double d_nearest, double e_nearest)
 {
-  nearest_1_infos[k][j].reset(k_nearest, d_nearest, e_nearest);
+  nearest_1_infos.reset(k, j, k_nearest, d_nearest, e_nearest);
   cluster_has_changed[k] = true;
 }
 
@@ -353,7 +313,7 @@ size_t SkeletonClusterer::draw_j_uniform(size_t k) { return dis(gen) % get_ndata
 void SkeletonClusterer::kmoo_prepare()
 {
   kmoo_cc.resize(K * K);
-  kmoo_p2bun = P2Bundle(ndata);
+  kmoo_p2bun = P2Bundle(ndata, wide_sample_IDs);
 }
 
 void SkeletonClusterer::print_ndatas()
@@ -459,7 +419,7 @@ void SkeletonClusterer::triangular_kmeanspp_aq2(size_t n_bins)
   /* tail_k is how many k's have use all the data (at the end) */
   size_t tail_k = K - non_tail_k;
   reset_p2buns_dt(static_cast<unsigned>(n_bins));
-  aq2p_original_indices = std::vector<std::vector<size_t>>(n_bins);
+  aq2p_original_indices = std::vector<SampleIDVector>(n_bins, SampleIDVector(wide_sample_IDs));
   aq2p_p2buns           = std::vector<P2Bundle>(n_bins);
 
   std::vector<size_t> bin_indices(n_bins);
@@ -484,7 +444,7 @@ void SkeletonClusterer::triangular_kmeanspp_aq2(size_t n_bins)
 
   for (size_t bin = 0; bin < n_bins; ++bin)
   {
-    aq2p_p2buns[bin] = P2Bundle(aq2p_original_indices[bin]);
+    aq2p_p2buns[bin] = P2Bundle(aq2p_original_indices[bin], wide_sample_IDs);
   }
 
   auto update_nearest_info =
@@ -495,8 +455,9 @@ void SkeletonClusterer::triangular_kmeanspp_aq2(size_t n_bins)
       {
         for (size_t k = k_start; k < k_end; ++k)
         {
-          if (kmoo_cc[aq2p_p2buns[bin].k_1(i) * K + k] <
-              aq2p_p2buns[bin].d_1(i) + aq2p_p2buns[bin].d_2(i))
+          if (satisfies_triangle_inequality() == false ||
+              kmoo_cc[aq2p_p2buns[bin].k_1(i) * K + k] <
+                aq2p_p2buns[bin].d_1(i) + aq2p_p2buns[bin].d_2(i))
           {
             set_center_sample_pp_distance(k, bin, i, some_distance);
             kmpp_inner(i, k, some_distance, aq2p_p2buns[bin]);
@@ -582,12 +543,12 @@ void SkeletonClusterer::triangular_kmeanspp_aq2(size_t n_bins)
   {
     for (size_t i = 0; i < aq2p_p2buns[bin].get_ndata(); ++i)
     {
-      size_t index0          = aq2p_p2buns[bin].ori(i);
+      size_t index0          = aq2p_p2buns[bin].get_ori(i);
       kmoo_p2bun.d_1(index0) = aq2p_p2buns[bin].d_1(i);
       kmoo_p2bun.d_2(index0) = aq2p_p2buns[bin].d_2(i);
       kmoo_p2bun.k_1(index0) = aq2p_p2buns[bin].k_1(i);
       kmoo_p2bun.k_2(index0) = aq2p_p2buns[bin].k_2(i);
-      kmoo_p2bun.ori(index0) = index0;
+      kmoo_p2bun.set_ori(index0, index0);
     }
   }
 
@@ -605,7 +566,7 @@ void SkeletonClusterer::triangular_kmeanspp()
 {
   for (size_t i = 0; i < ndata; ++i)
   {
-    kmoo_p2bun.ori(i) = i;
+    kmoo_p2bun.set_ori(i, i);
   }
   size_t k0 = 0;
   size_t k1 = K;
@@ -726,7 +687,7 @@ void SkeletonClusterer::triangular_kmeanspp_after_initial(size_t aq2p_bin,
 
     update_c_ind_c_dt = [this, &v_cum_nearest_energies, &p2bun, aq2p_bin](size_t k) {
       size_t sami            = get_sample_from(v_cum_nearest_energies);
-      center_indices_init[k] = p2bun.ori(sami);
+      center_indices_init[k] = p2bun.get_ori(sami);
       append_pp_from_bin(aq2p_bin, sami);
 
     };
@@ -790,8 +751,10 @@ void SkeletonClusterer::triangular_kmeanspp_after_initial(size_t aq2p_bin,
     /* update nearest distances, second nearest distances, and centers */
     for (size_t i = 0; i < kmeanspp_ndata; ++i)
     {
-      /* note that if k0 = 0, k_1(i) is 0 so this is fine. */
-      if (kmoo_cc[p2bun.k_1(i) * K + k] < p2bun.d_1(i) + p2bun.d_2(i))
+      /* note that if k0 = 0, k_1(i) is 0 so this is fine. Without the triangle inequality,
+       * center k cannot be eliminated with kmoo_cc. */
+      if (satisfies_triangle_inequality() == false ||
+          kmoo_cc[p2bun.k_1(i) * K + k] < p2bun.d_1(i) + p2bun.d_2(i))
       {
         set_distance_ik(i, k);
         kmpp_inner(i, k, a_distance, p2bun);
@@ -898,6 +861,68 @@ void SkeletonClusterer::output_halt_kmedoids_reason()
   mowri << zentas::Endl;
 }
 
+void SkeletonClusterer::reserve_clusters(const std::vector<size_t>& capacities)
+{
+  nearest_1_infos.reserve(capacities);
+  sample_IDs.reserve(capacities);
+  reserve_cluster_datas(capacities);
+  custom_reserve(capacities);
+}
+
+/* the bytes copied so far when the memory of a cluster (its data, nearest infos, sample IDs and
+ * custom per-sample values) outgrew its capacity */
+size_t SkeletonClusterer::get_n_bytes_reallocated()
+{
+  return nearest_1_infos.get_n_bytes_reallocated() + sample_IDs.get_n_bytes_reallocated() +
+         get_cluster_datas_n_bytes_reallocated() + get_custom_n_bytes_reallocated();
+}
+
+/* Rooted clusters store the positions of their samples in the input, which are scattered. The
+ * input is copied (in parallel) in the order center 0, cluster 0, center 1, cluster 1, ..., so
+ * that the samples of a cluster are contiguous until they move. Only the positions change :
+ * sample_IDs, center_IDs and labels are still the IDs of the user's input. */
+void SkeletonClusterer::reorder_rooted_data()
+{
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  std::vector<size_t> order;
+  order.reserve(ndata);
+  for (size_t k = 0; k < K; ++k)
+  {
+    order.push_back(get_position(center_IDs[k]));
+    for (size_t j = 0; j < get_ndata(k); ++j)
+    {
+      order.push_back(get_position(sample_IDs(k, j)));
+    }
+  }
+
+  if (order.size() != ndata)
+  {
+    throw zentas::zentas_error("the clusters and centers do not contain all samples, cannot "
+                               "reorder the data");
+  }
+
+  std::vector<size_t> old_to_new(ndata);
+  for (size_t p = 0; p < ndata; ++p)
+  {
+    old_to_new[order[p]] = p;
+  }
+
+  reorder_datain(order, old_to_new);
+
+  bool is_first = reordered_positions.empty();
+  reordered_positions.resize(ndata);
+  for (size_t i = 0; i < ndata; ++i)
+  {
+    reordered_positions.set(i, old_to_new[is_first ? i : reordered_positions[i]]);
+  }
+
+  ++n_reorders;
+  time_reordering += std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::high_resolution_clock::now() - t0)
+                       .count();
+}
+
 bool SkeletonClusterer::halt_kmedoids()
 {
   bool do_not_halt =
@@ -955,6 +980,15 @@ void SkeletonClusterer::run_kmedoids()
 {
   core_kmedoids_loops();
   output_halt_kmedoids_reason();
+  mowri << "bytes copied reallocating cluster memory:  initialisation="
+        << n_bytes_reallocated_initialising
+        << "  k-medoids=" << get_n_bytes_reallocated() - n_bytes_reallocated_initialising
+        << zentas::Endl;
+  if (reorder_interval > 0)
+  {
+    mowri << "reordered the rooted data " << n_reorders << " times, in "
+          << time_reordering / 1000 << " ms" << zentas::Endl;
+  }
 }
 
 void SkeletonClusterer::core_kmedoids_loops()
@@ -1017,6 +1051,11 @@ void SkeletonClusterer::core_kmedoids_loops()
       mowri << zentas::Endl;
     mowri << get_round_summary() << zentas::Endl;
     ++round;
+
+    if (reorder_interval > 0 && round % reorder_interval == 0 && halt_kmedoids() == false)
+    {
+      reorder_rooted_data();
+    }
   }
 }
 
@@ -1036,12 +1075,18 @@ void SkeletonClusterer::go()
 
   std::string init1foo = "Will now initialize with method: " + initialisation_method + ".";
   mowri << '\n' << init1foo << '\n';
+  advise_mapped_files(AccessAdvice::sequential);
   initialise_all();
+  if (reorder_interval > 0)
+  {
+    reorder_rooted_data();
+  }
 
   std::string kmefact =
     "Will now run k-medoids a.k.a  k-centers with method: " + get_kmedoids_method_string() + ".";
   mowri << '\n' << kmefact << '\n';
   mowri << get_equals_line(get_round_summary().size());
+  advise_mapped_files(AccessAdvice::random);
   run_kmedoids();
 
   if (do_refinement == true)
@@ -1069,7 +1114,7 @@ void SkeletonClusterer::go()
     {
       for (size_t j = 0; j < get_ndata(k); ++j)
       {
-        labels[sample_IDs[k][j]] = k;
+        labels[sample_IDs(k, j)] = k;
       }
     }
   }
@@ -1082,11 +1127,13 @@ void SkeletonClusterer::go()
       labels[center_IDs[k]] = k;
       for (size_t j = 0; j < get_ndata(k); ++j)
       {
-        labels[sample_IDs[k][j]] = k;
+        labels[sample_IDs(k, j)] = k;
       }
     }
   }
 
+  advise_mapped_files(AccessAdvice::normal);
+
   if (do_balance_labels == true && do_refinement == true)
   {
     throw zentas::zentas_error("balancing labels is only an option when there is no refinement");
@@ -1265,7 +1312,7 @@ void SkeletonClusterer::to_leave_cluster_test()
   {
     for (size_t j = 0; j < get_ndata(k); ++j)
     {
-      if (nearest_1_infos[k][j].a_x != k)
+      if (get_a1(k, j) != k)
       {
         bool is_listed = false;
         for (auto& x : to_leave_cluster[k])
@@ -1300,7 +1347,7 @@ void SkeletonClusterer::to_leave_cluster_test()
               << " times in the to leave list of cluster " << k << zentas::Endl;
       }
 
-      if (nearest_1_infos[k][x].a_x == k)
+      if (get_a1(k, x) == k)
       {
         mowri << "\ncluster and size ( " << k << " : " << get_ndata(k) << ") " << zentas::Endl;
         mowri << "j : " << x << zentas::Endl;
@@ -1310,7 +1357,7 @@ void SkeletonClusterer::to_leave_cluster_test()
         {
           mowri << x_ << " " << zentas::Flush;
         }
-        mowri << "\n(a,d,e) : " << nearest_1_infos[k][x].get_string() << zentas::Endl;
+        mowri << "\n(a,d,e) : " << nearest_1_infos.get_string(k, x) << zentas::Endl;
         mowri << "\nto leave cluster but k is 'k'" << zentas::Endl;
         throw zentas::zentas_error(errm);
       }
@@ -1331,7 +1378,7 @@ void SkeletonClusterer::cluster_statistics_test()
     double E__0k = 0;
     for (size_t j = 0; j < get_ndata(k); ++j)
     {
-      E__0k += nearest_1_infos[k][j].e_x;
+      E__0k += get_e1(k, j);
     }
     if (E__0k != cluster_energies[k])
     {
@@ -1400,7 +1447,7 @@ void SkeletonClusterer::info_tests()
         }
       }
       double e_first_nearest = f_energy(d_first_nearest);
-      if (d_first_nearest != nearest_1_infos[k][j].d_x)
+      if (get_as_stored(d_first_nearest) != get_d1(k, j))
       {
 
         std::stringstream strerrm;
@@ -1410,24 +1457,25 @@ void SkeletonClusterer::info_tests()
         strerrm << "j=" << j << "\n";
         strerrm << "the " << j << "'th sample in cluster " << k << " is "
                 << string_for_sample(k, j) << "\n";
-        strerrm << "cluster size is " << nearest_1_infos[k].size() << "\n";
+        strerrm << "cluster size is " << nearest_1_infos.size(k) << "\n";
         strerrm << std::setprecision(20);
         strerrm << "get_a1(k,j)=" << get_a1(k, j) << "\n";
         strerrm << "just computed first nearest center index: " << k_first_nearest << "\n";
         strerrm << "the " << k_first_nearest
                 << "'th center is: " << string_for_center(k_first_nearest) << "\n";
         strerrm << "just computed distance to this center is: " << d_first_nearest << "\n";
-        strerrm << "the recorded first nearest center index: " << nearest_1_infos[k][j].a_x
+        strerrm << "the recorded first nearest center index: " << get_a1(k, j) << "\n";
+        strerrm << "the " << get_a1(k, j) << "'th center is " << string_for_center(get_a1(k, j))
                 << "\n";
-        strerrm << "the " << nearest_1_infos[k][j].a_x << "'th center is "
-                << string_for_center(nearest_1_infos[k][j].a_x) << "\n";
-        strerrm << "the recorded distance to this center is " << nearest_1_infos[k][j].d_x << "\n";
+        strerrm << "the recorded distance to this center is " << get_d1(k, j) << "\n";
         throw zentas::zentas_error(strerrm.str());
       }
 
-      if (e_first_nearest != nearest_1_infos[k][j].e_x)
+      /* with FLOAT_NEAREST_INFOS, the energy may be of the stored (rounded) distance */
+      if (get_as_stored(e_first_nearest) != get_e1(k, j) &&
+          get_as_stored(f_energy(get_d1(k, j))) != get_e1(k, j))
       {
-        throw zentas::zentas_error(errm + "e_first_nearest != nearest_1_infos[k][j].e_x");
+        throw zentas::zentas_error(errm + "e_first_nearest != get_e1(k, j)");
       }
     }
   }
@@ -1442,7 +1490,7 @@ void SkeletonClusterer::ndata_tests()
   size_t      ndata_internal = 0;
   for (size_t k = 0; k < K; ++k)
   {
-    if (get_ndata(k) != nearest_1_infos[k].size())
+    if (get_ndata(k) != nearest_1_infos.size(k))
     {
       throw zentas::zentas_error(errm);
     }
@@ -1466,10 +1514,10 @@ void SkeletonClusterer::as_assigned_test()
   {
     for (size_t j = 0; j < get_ndata(k); ++j)
     {
-      if (nearest_1_infos[k][j].a_x != k)
+      if (get_a1(k, j) != k)
       {
         std::string errstring = "A sample in cluster " + std::to_string(k) + " has a_x " +
-                                std::to_string(nearest_1_infos[k][j].a_x);
+                                std::to_string(get_a1(k, j));
         throw zentas::zentas_error(errstring);
       }
     }
@@ -1496,7 +1544,7 @@ void SkeletonClusterer::injective_ID_test()
 
       for (size_t j = 0; j < get_ndata(k); ++j)
       {
-        if (i == sample_IDs[k][j])
+        if (i == sample_IDs(k, j))
         {
           ++count_i;
           in_cluster.push_back(k);
@@ -1713,7 +1761,7 @@ void SkeletonClusterer::redistribute()
        * immigration */
       if (j != std::numeric_limits<size_t>::max())
       {
-        k_new = nearest_1_infos[k][j].a_x;
+        k_new = get_a1(k, j);
 
         cluster_has_changed[k]     = true;
         cluster_has_changed[k_new] = true;
@@ -1726,7 +1774,7 @@ void SkeletonClusterer::redistribute()
          * no luck,
          * can still swap with movers */
         size_t insert_attempts = 0;
-        while (j_new != get_ndata(k_new) && nearest_1_infos[k_new][j_new].a_x != k_new &&
+        while (j_new != get_ndata(k_new) && get_a1(k_new, j_new) != k_new &&
                insert_attempts < 10)
         {
           j_new = dis(gen) % (get_ndata(k_new) + 1);
@@ -1736,8 +1784,8 @@ void SkeletonClusterer::redistribute()
         /* case 1 : k,j goes on the tail */
         if (j_new == get_ndata(k_new))
         {
-          nearest_1_infos[k_new].push_back(nearest_1_infos[k][j]);
-          sample_IDs[k_new].push_back(sample_IDs[k][j]);
+          nearest_1_infos.append_from(k_new, k, j);
+          sample_IDs.append(k_new, sample_IDs(k, j));
           append_across(k_new, k, j);
           custom_append(k_new, k, j);
         }
@@ -1746,7 +1794,7 @@ void SkeletonClusterer::redistribute()
         else
         {
 
-          if (nearest_1_infos[k_new][j_new].a_x != k_new)
+          if (get_a1(k_new, j_new) != k_new)
           {
             target_is_a_mover = true;
           }
@@ -1757,15 +1805,15 @@ void SkeletonClusterer::redistribute()
           }
 
           /* putting k_new, j_new on the tail to make space for k, j */
-          nearest_1_infos[k_new].push_back(nearest_1_infos[k_new][j_new]);
-          sample_IDs[k_new].push_back(sample_IDs[k_new][j_new]);
+          nearest_1_infos.append_from(k_new, k_new, j_new);
+          sample_IDs.append(k_new, sample_IDs(k_new, j_new));
 
           append_across(k_new, k_new, j_new);
           custom_append(k_new, k_new, j_new);
 
           /* putting k, j in where space has been made for it */
-          nearest_1_infos[k_new][j_new] = nearest_1_infos[k][j];
-          sample_IDs[k_new][j_new]      = sample_IDs[k][j];
+          nearest_1_infos.replace_with(k_new, j_new, k, j);
+          sample_IDs.set(k_new, j_new, sample_IDs(k, j));
           replace_with(k_new, j_new, k, j);
 
           custom_replace_with(k_new, j_new, k, j);
@@ -1830,7 +1878,7 @@ void SkeletonClusterer::set_cluster_statistics(size_t k)
   set_to_zero_custom_cluster_statistics(k);
   for (size_t j = 0; j < get_ndata(k); ++j)
   {
-    cluster_energies[k] += nearest_1_infos[k][j].e_x;
+    cluster_energies[k] += get_e1(k, j);
     increment_custom_cluster_statistics(k, j);  // includes max
   }
   cluster_mean_energies[k] = cluster_energies[k] / static_cast<double>(get_ndata(k));
@@ -1843,14 +1891,14 @@ void SkeletonClusterer::remove_with_tail_pull(size_t k, size_t j)
 {
   if (j != get_ndata(k) - 1)
   {
-    nearest_1_infos[k][j] = *(nearest_1_infos[k].end() - 1);
-    sample_IDs[k][j]      = *(sample_IDs[k].end() - 1);
+    nearest_1_infos.replace_with_last(k, j);
+    sample_IDs.replace_with_last(k, j);
     replace_with_last_element(k, j);
     custom_replace_with_last(k, j);
   }
 
-  nearest_1_infos[k].pop_back();
-  sample_IDs[k].pop_back();
+  nearest_1_infos.remove_last(k);
+  sample_IDs.remove_last(k);
   remove_last(k);
   custom_remove_last(k);
   cluster_has_changed[k] = true;
@@ -1859,7 +1907,7 @@ void SkeletonClusterer::remove_with_tail_pull(size_t k, size_t j)
 void SkeletonClusterer::initialise_all()
 {
 
-  if (with_tests == true)
+  if (with_tests == true && satisfies_triangle_inequality() == true)
   {
     fundamental_triangle_inequality_test();
   }
@@ -1905,6 +1953,7 @@ void SkeletonClusterer::initialise_all()
   auto t1             = std::chrono::high_resolution_clock::now();
   time_initialising   = std::chrono::duration_cast<std::chrono::microseconds>(t1 - tstart).count();
   ncalcs_initialising = get_ncalcs();
+  n_bytes_reallocated_initialising = get_n_bytes_reallocated();
   mowri << get_equals_line(get_round_summary().size());
   mowri << get_round_summary() << zentas::Endl;
 }
@@ -1943,6 +1992,32 @@ void SkeletonClusterer::put_samples_in_clusters()
     std::swap(non_center_IDs[i], non_center_IDs[swap_with]);
   }
 
+  /* Each cluster is given room for its samples and a quarter more, for immigrants during
+   * k-medoids. With kmeans++, the cluster sizes are known before the samples are put in
+   * clusters. With the other initialisations, the clusters are given room for the mean size
+   * before, and for their sizes after. */
+  std::string         prefix      = "kmeans++";
+  bool                is_kmeanspp = initialisation_method.substr(0, prefix.size()) == prefix;
+  std::vector<size_t> capacities(K, 0);
+  if (is_kmeanspp)
+  {
+    for (auto& i : non_center_IDs)
+    {
+      ++capacities[kmoo_p2bun.k_1(i)];
+    }
+  }
+
+  else
+  {
+    std::fill(capacities.begin(), capacities.end(), (ndata - K) / K);
+  }
+
+  for (auto& x : capacities)
+  {
+    x += x / 4 + 1;
+  }
+  reserve_clusters(capacities);
+
   std::vector<std::thread> threads;
   for (size_t ti = 0; ti < nthreads; ++ti)
   {
@@ -1956,6 +2031,15 @@ void SkeletonClusterer::put_samples_in_clusters()
   {
     t.join();
   }
+
+  if (is_kmeanspp == false)
+  {
+    for (size_t k = 0; k < K; ++k)
+    {
+      capacities[k] = get_ndata(k) + get_ndata(k) / 4 + 1;
+    }
+    reserve_clusters(capacities);
+  }
   kmoo_finish_with();
 }
 
@@ -2000,9 +2084,8 @@ void SkeletonClusterer::final_push_into_cluster_basic(size_t i,
                                                       double min_distance)
 {
   append_from_ID(nearest_center, i);
-  nearest_1_infos[nearest_center].emplace_back(
-    nearest_center, min_distance, f_energy(min_distance));
-  sample_IDs[nearest_center].push_back(i);
+  nearest_1_infos.append(nearest_center, nearest_center, min_distance, f_energy(min_distance));
+  sample_IDs.append(nearest_center, i);
 }
 
 void SkeletonClusterer::reset_multiple_sample_infos(size_t k_to, size_t j_a, size_t j_z)
@@ -2076,9 +2159,9 @@ void SkeletonClusterer::swap_center_with_sample(size_t k, size_t j)
 {
   cluster_has_changed[k] = true;
   size_t c_id_k          = center_IDs[k];
-  center_IDs[k]          = sample_IDs[k][j];
+  center_IDs[k]          = sample_IDs(k, j);
   /* jn : bug fix, voronoi 11 june 2017. the following was missing: */
-  sample_IDs[k][j] = c_id_k;
+  sample_IDs.set(k, j, c_id_k);
   swap_center_data(k, j);
   reset_sample_infos_basic(k, j);
 }
@@ -2158,7 +2241,7 @@ void SkeletonClusterer::reset_sample_infos(size_t k, size_t j)
 {
 
   reset_sample_infos_basic(k, j);
-  if (k != nearest_1_infos[k][j].a_x)
+  if (k != get_a1(k, j))
   {
     std::lock_guard<std::mutex> lock(mutex0);
     to_leave_cluster[k].push_back(j);
@@ -2185,7 +2268,7 @@ void SkeletonClusterer::final_push_into_cluster(size_t              i,
 void SkeletonClusterer::overwrite_center_with_sample(size_t k1, size_t k2, size_t j2)
 {
   centers_replace_with_sample(k1, k2, j2);
-  center_IDs[k1]          = sample_IDs[k2][j2];
+  center_IDs[k1]          = sample_IDs(k2, j2);
   cluster_has_changed[k1] = true;
 }
 
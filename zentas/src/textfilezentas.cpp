@@ -3,6 +3,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <set>
 #include <vector>
 #include <zentas/costs.hpp>
@@ -36,7 +37,10 @@ void textfilezentas(std::vector<std::string> filenames,
                     double                   critical_radius,
                     double                   exponent_coeff,
                     std::string              initialisation_method,
-                    bool                     do_balance_labels)
+                    bool                     do_balance_labels,
+                    size_t                   distance_cache_size,
+                    std::string              storage,
+                    bool                     with_profiles)
 {
 
   /* Input : filenames, outfilename,  costfilename
@@ -276,7 +280,10 @@ void textfilezentas(std::vector<std::string> filenames,
           c_switch_arr,
           critical_radius,
           exponent_coeff,
-          do_balance_labels);
+          do_balance_labels,
+          distance_cache_size,
+          storage,
+          with_profiles);
 
   /* (6) write results to outfilename */
   if (with_cost_matrices == true)
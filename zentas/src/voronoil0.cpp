@@ -22,8 +22,7 @@ void VoronoiL0::custom_initialise_refinement()
 
   // Voronoi does not have second nearest information, so we need to build that here.
 
-  std::vector<std::vector<XNearestInfo>> nearest_2_infos;
-  nearest_2_infos.resize(K);
+  NearestInfos nearest_2_infos(K);
 
   std::unique_ptr<double[]> up_distances(new double[K]);
   double                    min_distance          = std::numeric_limits<double>::max();
@@ -34,7 +33,7 @@ void VoronoiL0::custom_initialise_refinement()
   size_t total_visits = 0;
   for (size_t k2 = 0; k2 < K; ++k2)
   {
-    for (size_t i = 0; i < nearest_1_infos[k2].size(); ++i)
+    for (size_t i = 0; i < nearest_1_infos.size(k2); ++i)
     {
       ++total_visits;
       min_distance          = std::numeric_limits<double>::max();
@@ -61,17 +60,17 @@ void VoronoiL0::custom_initialise_refinement()
           }
         }
       }
-      if (nearest_center != k2 || nearest_1_infos[k2][i].a_x != k2)
+      if (nearest_center != k2 || get_a1(k2, i) != k2)
       {
         std::stringstream ss;
         ss << " i = " << i << "  nearest_center = " << nearest_center << "   k2 = " << k2
-           << " a_x = " << nearest_1_infos[k2][i].a_x << "  no way jose";
+           << " a_x = " << get_a1(k2, i) << "  no way jose";
         throw zentas::zentas_error(ss.str());
       }
       else
       {
-        nearest_2_infos[k2].emplace_back(
-          second_nearest_center, second_min_distance, f_energy(second_min_distance));
+        nearest_2_infos.append(
+          k2, second_nearest_center, second_min_distance, f_energy(second_min_distance));
       }
     }
   }
@@ -100,25 +99,33 @@ std::string VoronoiL0::get_round_summary()
 
 void VoronoiL0::update_sample_info()
 {
-  double adistance{0};
-  double min_distance{0};
-  size_t min_k{0};
+  /* center by center, so that the distances of each center to cluster k are one batch. The
+   * thresholds are the running minima, as when going sample by sample */
+  std::vector<double> distances;
+  std::vector<double> min_distances;
+  std::vector<size_t> min_ks;
 
   for (size_t k = 0; k < K; ++k)
   {
-    for (size_t j = 0; j < get_ndata(k); ++j)
+    distances.resize(get_ndata(k));
+    min_distances.assign(get_ndata(k), std::numeric_limits<double>::max());
+    min_ks.assign(get_ndata(k), 0);
+    for (size_t kp = 0; kp < K; ++kp)
     {
-      min_distance = std::numeric_limits<double>::max();
-      for (size_t kp = 0; kp < K; ++kp)
+      set_center_sample_distances(kp, k, 0, get_ndata(k), min_distances.data(), distances.data());
+      for (size_t j = 0; j < get_ndata(k); ++j)
       {
-        set_center_sample_distance(kp, k, j, min_distance, adistance);
-        if (adistance < min_distance)
+        if (distances[j] < min_distances[j])
         {
-          min_distance = adistance;
-          min_k        = kp;
+          min_distances[j] = distances[j];
+          min_ks[j]        = kp;
         }
       }
-      reset_nearest_info(k, j, min_k, min_distance, f_energy(min_distance));
+    }
+
+    for (size_t j = 0; j < get_ndata(k); ++j)
+    {
+      reset_nearest_info(k, j, min_ks[j], min_distances[j], f_energy(min_distances[j]));
     }
   }
 }
@@ -6,6 +6,8 @@
 #include <zentas/claransl2.hpp>
 #include <zentas/claransl3.hpp>
 #include <zentas/dispatch.hpp>
+#include <zentas/dtw.hpp>
+#include <zentas/hamming.hpp>
 #include <zentas/levenshtein.hpp>
 #include <zentas/lpmetric.hpp>
 #include <zentas/outputwriter.hpp>
@@ -14,6 +16,8 @@
 #include <zentas/zentas.hpp>
 #include <zentas/zentaserror.hpp>
 
+#include <cmath>
+
 namespace nszen
 {
 
@@ -25,6 +29,225 @@ void confirm_can_refine(std::string algorithm)
     // initialization");
   }
 }
+
+/* The p of LpMetric is a template parameter, so that distance calls are not virtual. It is
+ * chosen once, here. */
+template <typename TData, typename... Args>
+void lp_zentas_base(char p, Args&&... args)
+{
+  typedef typename TData::DataIn DataIn;
+
+  if (p == '2')
+  {
+    zentas_base<TData, LpMetric<DataIn, '2'>>(std::forward<Args>(args)...);
+  }
+
+  else if (p == '1')
+  {
+    zentas_base<TData, LpMetric<DataIn, '1'>>(std::forward<Args>(args)...);
+  }
+
+  else if (p == '0')
+  {
+    zentas_base<TData, LpMetric<DataIn, '0'>>(std::forward<Args>(args)...);
+  }
+
+  else if (p == 'i')
+  {
+    zentas_base<TData, LpMetric<DataIn, 'i'>>(std::forward<Args>(args)...);
+  }
+
+  else
+  {
+    std::string err = "No implementation for p = ";
+    err             = err + p;
+    throw zentas::zentas_error(err);
+  }
+}
+
+/* Metrics cosine ('c') and angular ('a'), for samples of unit norm */
+template <typename TData, typename... Args>
+void unit_lp_zentas_base(char p, Args&&... args)
+{
+  typedef typename TData::DataIn DataIn;
+
+  if (p == 'c')
+  {
+    zentas_base<TData, LpMetric<DataIn, 'c'>>(std::forward<Args>(args)...);
+  }
+
+  else if (p == 'a')
+  {
+    zentas_base<TData, LpMetric<DataIn, 'a'>>(std::forward<Args>(args)...);
+  }
+
+  else
+  {
+    std::string err = "No implementation of unit_lp_zentas_base for p = ";
+    err             = err + p;
+    throw zentas::zentas_error(err);
+  }
+}
+
+/* For metrics cosine and angular, the samples are scaled to unit l2 norm once, before
+ * clustering. The n_vectors vectors of sizes[i] (or dimension, if sizes is nullptr) values are
+ * contiguous in values. */
+template <typename T>
+void set_unit_norm_values(size_t              n_vectors,
+                          const size_t* const sizes,
+                          size_t              dimension,
+                          const T* const      values,
+                          std::vector<T>&     v_unit)
+{
+  size_t n_values = 0;
+  for (size_t i = 0; i < n_vectors; ++i)
+  {
+    n_values += (sizes == nullptr ? dimension : sizes[i]);
+  }
+  v_unit.resize(n_values);
+
+  size_t c_size = 0;
+  size_t size;
+  double norm;
+  for (size_t i = 0; i < n_vectors; ++i)
+  {
+    size = (sizes == nullptr ? dimension : sizes[i]);
+    norm = 0;
+    for (size_t d = 0; d < size; ++d)
+    {
+      norm += static_cast<double>(values[c_size + d]) * static_cast<double>(values[c_size + d]);
+    }
+    norm = std::sqrt(norm);
+    if (norm == 0)
+    {
+      throw zentas::zentas_error("the cosine and angular metrics are not defined for zero "
+                                 "vectors, and sample " +
+                                 std::to_string(i) + " is zero");
+    }
+    for (size_t d = 0; d < size; ++d)
+    {
+      v_unit[c_size + d] = static_cast<T>(values[c_size + d] / norm);
+    }
+    c_size += size;
+  }
+}
+
+/* metrics cosine and angular : no refinement, as there is no center (minimiser) for them */
+void confirm_can_use_unit_metric(const std::string& metric, bool do_refinement)
+{
+  if (do_refinement == true)
+  {
+    throw zentas::zentas_error("refinement is not available with metric " + metric);
+  }
+}
+
+/* Reduced precision storage of dense vectors, with TCode one of Float16, BFloat16 and int8_t
+ * (see quantise.hpp) */
+template <typename T, typename TCode, typename... Args>
+void quantised_lp_zentas_base(bool rooted, char p, Args&&... args)
+{
+  if (rooted == true)
+  {
+    lp_zentas_base<QuantisedVDataRooted<QuantisedDenseVectorDataRootedIn<T, TCode>>>(
+      p, std::forward<Args>(args)...);
+  }
+
+  else
+  {
+    lp_zentas_base<QuantisedVData<QuantisedDenseVectorDataUnrootedIn<T, TCode>>>(
+      p, std::forward<Args>(args)...);
+  }
+}
+
+template <typename T, typename... Args>
+void quantised_zentas_base(const std::string& storage, bool rooted, char p, Args&&... args)
+{
+  if (storage == "fp16")
+  {
+    quantised_lp_zentas_base<T, Float16>(rooted, p, std::forward<Args>(args)...);
+  }
+
+  else if (storage == "bf16")
+  {
+    quantised_lp_zentas_base<T, BFloat16>(rooted, p, std::forward<Args>(args)...);
+  }
+
+  else if (storage == "int8")
+  {
+    quantised_lp_zentas_base<T, int8_t>(rooted, p, std::forward<Args>(args)...);
+  }
+
+  else
+  {
+    throw zentas::zentas_error("Unrecognised storage, `" + storage +
+                               "'. It should be one of full, fp16, bf16 and int8");
+  }
+}
+
+/* Samples packed into words of 64 bits, with the hamming metric (see hamming.hpp) */
+template <typename... Args>
+void hamming_zentas_base(bool rooted, Args&&... args)
+{
+  if (rooted == true)
+  {
+    zentas_base<VDataRooted<DenseVectorDataRootedIn<uint64_t>>,
+                HammingMetric<DenseVectorDataRootedIn<uint64_t>>>(std::forward<Args>(args)...);
+  }
+
+  else
+  {
+    zentas_base<VData<DenseVectorDataUnrootedIn<uint64_t>>,
+                HammingMetric<DenseVectorDataUnrootedIn<uint64_t>>>(std::forward<Args>(args)...);
+  }
+}
+
+/* time series, with the dtw metric (see dtw.hpp) */
+template <typename T, typename... Args>
+void dtw_zentas_base(bool rooted, Args&&... args)
+{
+  if (rooted == true)
+  {
+    zentas_base<SDataRooted<TimeSeriesDataRootedIn<T>>, DTWMetric<TimeSeriesDataRootedIn<T>>>(
+      std::forward<Args>(args)...);
+  }
+
+  else
+  {
+    zentas_base<SData<TimeSeriesDataUnrootedIn<T>>, DTWMetric<TimeSeriesDataUnrootedIn<T>>>(
+      std::forward<Args>(args)...);
+  }
+}
+
+/* strings, of which the values are stored packed (2 or 4 bits per value) with storage
+ * "packed" (see BasePackedStringDataIn) */
+template <typename T, typename... Args>
+void levenshtein_zentas_base(const std::string& storage, bool rooted, Args&&... args)
+{
+  if (storage == "packed" && rooted == true)
+  {
+    zentas_base<SDataRooted<PackedStringDataRootedIn<T>>,
+                LevenshteinMetric<PackedStringDataRootedIn<T>>>(std::forward<Args>(args)...);
+  }
+
+  else if (storage == "packed")
+  {
+    zentas_base<PackedSData<PackedStringDataUnrootedIn<T>>,
+                LevenshteinMetric<PackedStringDataUnrootedIn<T>>>(std::forward<Args>(args)...);
+  }
+
+  else if (rooted == true)
+  {
+    zentas_base<SDataRooted<StringDataRootedIn<T>>, LevenshteinMetric<StringDataRootedIn<T>>>(
+      std::forward<Args>(args)...);
+  }
+
+  else
+  {
+    zentas_base<SData<StringDataUnrootedIn<T>>, LevenshteinMetric<StringDataUnrootedIn<T>>>(
+      std::forward<Args>(args)...);
+  }
+}
+
 /* dense vectors */
 
 template <typename T>
@@ -105,7 +328,9 @@ void vzentas(size_t              ndata,
              std::string         rf_alg,
              size_t              rf_max_rounds,
              double              rf_max_time,
-             bool                do_balance_labels)
+             bool                do_balance_labels,
+             std::string         storage,
+             size_t              reorder_interval)
 {
 
   auto bigbang = std::chrono::high_resolution_clock::now();
@@ -136,14 +361,228 @@ void vzentas(size_t              ndata,
     confirm_can_refine(algorithm);
   }
 
-  metric_initializer.reset(metric, do_refinement, rf_alg, rf_max_rounds, rf_max_time);
+  /* "l2c" is l2, with the squared norms of the samples and centers cached (see
+   * NormedDenseSample). Worthwhile when the dimension is large. Metrics cosine and angular
+   * are computed in the same way, as the samples are scaled to unit norm. */
+  bool cache_norms = (metric == "l2c");
+  bool unit_norms  = (metric == "cosine" || metric == "angular");
+  metric_initializer.reset(
+    cache_norms ? "l2" : metric, do_refinement, rf_alg, rf_max_rounds, rf_max_time);
+
+  std::vector<T> v_unit;
+  if (unit_norms == true)
+  {
+    confirm_can_use_unit_metric(metric, do_refinement);
+    if (do_vdimap == true)
+    {
+      throw zentas::zentas_error("do_vdimap is not available with metric " + metric);
+    }
+    set_unit_norm_values(ndata, nullptr, true_dimension, true_ptr_datain, v_unit);
+    true_ptr_datain = v_unit.data();
+  }
 
   EnergyInitialiser energy_initialiser(critical_radius, exponent_coeff);
 
+  /* the reordered copy of the input is made by the clusterer, see reorder_rooted_data */
+  if (reorder_interval > 0 && (rooted == false || storage != "full"))
+  {
+    throw zentas::zentas_error(
+      "reorder_interval > 0 is only an option when rooted is true and storage is full");
+  }
+
   ConstLengthInitBundle<T> datain_ib(ndata, true_dimension, true_ptr_datain);
-  if (rooted == true)
+
+  /* With reduced precision storage, the medoids are checked with the full precision data at
+   * the end (see reverify_medoids). */
+  if (storage != "full")
+  {
+    if (cache_norms == true || unit_norms == true || do_refinement == true)
+    {
+      throw zentas::zentas_error("neither metric " + metric +
+                                 " nor refinement is available with reduced precision storage "
+                                 "(storage = " +
+                                 storage + ")");
+    }
+
+    quantised_zentas_base<T>(storage,
+                             rooted,
+                             metric_initializer.p,
+                             datain_ib,
+                             K,
+                             indices_init,
+                             initialisation_method,
+                             algorithm,
+                             level,
+                             max_proposals,
+                             capture_output,
+                             text,
+                             seed,
+                             max_time,
+                             min_mE,
+                             max_itok,
+                             indices_final,
+                             labels,
+                             nthreads,
+                             max_rounds,
+                             patient,
+                             energy,
+                             with_tests,
+                             metric_initializer,
+                             energy_initialiser,
+                             bigbang,
+                             do_balance_labels);
+
+    std::stringstream ss;
+    reverify_medoids(ndata,
+                     true_dimension,
+                     true_ptr_datain,
+                     K,
+                     metric_initializer.p,
+                     get_f_energy(energy, energy_initialiser),
+                     nthreads,
+                     labels,
+                     indices_final,
+                     ss);
+    if (capture_output == true)
+    {
+      text += ss.str();
+    }
+    else
+    {
+      std::cout << ss.str() << std::flush;
+    }
+  }
+
+  else if (rooted == true && unit_norms == true)
   {
-    zentas_base<VDataRooted<DenseVectorDataRootedIn<T>>, LpMetric<DenseVectorDataRootedIn<T>>>(
+    unit_lp_zentas_base<NormedVDataRooted<NormedDenseVectorDataRootedIn<T>>>(
+      metric_initializer.p,
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels,
+      0,
+      reorder_interval);
+  }
+
+  else if (unit_norms == true)
+  {
+    unit_lp_zentas_base<NormedVData<NormedDenseVectorDataUnrootedIn<T>>>(
+      metric_initializer.p,
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels);
+  }
+
+  else if (rooted == true && cache_norms == true)
+  {
+    zentas_base<NormedVDataRooted<NormedDenseVectorDataRootedIn<T>>,
+                LpMetric<NormedDenseVectorDataRootedIn<T>, '2'>>(
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels,
+      0,
+      reorder_interval);
+  }
+
+  else if (rooted == true)
+  {
+    lp_zentas_base<VDataRooted<DenseVectorDataRootedIn<T>>>(
+      metric_initializer.p,
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels,
+      0,
+      reorder_interval);
+  }
+
+  else if (cache_norms == true)
+  {
+    zentas_base<NormedVData<NormedDenseVectorDataUnrootedIn<T>>,
+                LpMetric<NormedDenseVectorDataUnrootedIn<T>, '2'>>(
       datain_ib,
       K,
       indices_init,
@@ -172,7 +611,8 @@ void vzentas(size_t              ndata,
 
   else
   {
-    zentas_base<VData<DenseVectorDataUnrootedIn<T>>, LpMetric<DenseVectorDataUnrootedIn<T>>>(
+    lp_zentas_base<VData<DenseVectorDataUnrootedIn<T>>>(
+      metric_initializer.p,
       datain_ib,
       K,
       indices_init,
@@ -231,7 +671,9 @@ template void vzentas(size_t              ndata,
                       std::string         rf_alg,
                       size_t              rf_max_rounds,
                       double              rf_max_time,
-                      bool                do_balance_labels);
+                      bool                do_balance_labels,
+                      std::string         storage,
+                      size_t              reorder_interval);
 
 template void vzentas(size_t              ndata,
                       size_t              dimension,
@@ -264,7 +706,9 @@ template void vzentas(size_t              ndata,
                       std::string         rf_alg,
                       size_t              rf_max_rounds,
                       double              rf_max_time,
-                      bool                do_balance_labels);
+                      bool                do_balance_labels,
+                      std::string         storage,
+                      size_t              reorder_interval);
 
 /* sparse vectors */
 
@@ -300,7 +744,8 @@ void sparse_vector_zentas(size_t              ndata,
                           std::string         rf_alg,
                           size_t              rf_max_rounds,
                           double              rf_max_time,
-                          bool                do_balance_labels)
+                          bool                do_balance_labels,
+                          size_t              reorder_interval)
 {
 
   auto bigbang = std::chrono::high_resolution_clock::now();
@@ -314,66 +759,147 @@ void sparse_vector_zentas(size_t              ndata,
 
   metric_initializer.reset(metric, do_refinement, rf_alg, rf_max_rounds, rf_max_time);
 
+  /* see vzentas */
+  bool           unit_norms = (metric == "cosine" || metric == "angular");
+  std::vector<T> v_unit;
+  if (unit_norms == true)
+  {
+    confirm_can_use_unit_metric(metric, do_refinement);
+    set_unit_norm_values(ndata, sizes, 0, ptr_datain, v_unit);
+  }
+
   EnergyInitialiser energy_initialiser(critical_radius, exponent_coeff);
 
-  SparseVectorDataInitBundle<T> datain_ib(ndata, sizes, ptr_datain, ptr_indices_s);
+  if (reorder_interval > 0 && rooted == false)
+  {
+    throw zentas::zentas_error("reorder_interval > 0 is only an option when rooted is true");
+  }
 
-  if (rooted == true)
+  SparseVectorDataInitBundle<T> datain_ib(
+    ndata, sizes, unit_norms ? v_unit.data() : ptr_datain, ptr_indices_s);
+
+  if (rooted == true && unit_norms == true)
+  {
+    unit_lp_zentas_base<SparseVectorDataRooted<SparseVectorDataRootedIn<T>>>(
+      metric_initializer.p,
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels,
+      0,
+      reorder_interval);
+  }
+
+  else if (unit_norms == true)
+  {
+    unit_lp_zentas_base<SparseVectorData<SparseVectorDataUnrootedIn<T>>>(
+      metric_initializer.p,
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels);
+  }
+
+  else if (rooted == true)
   {
-    zentas_base<SparseVectorDataRooted<SparseVectorDataRootedIn<T>>,
-                LpMetric<SparseVectorDataRootedIn<T>>>(datain_ib,
-                                                       K,
-                                                       indices_init,
-                                                       initialisation_method,
-                                                       algorithm,
-                                                       level,
-                                                       max_proposals,
-                                                       capture_output,
-                                                       text,
-                                                       seed,
-                                                       max_time,
-                                                       min_mE,
-                                                       max_itok,
-                                                       indices_final,
-                                                       labels,
-                                                       nthreads,
-                                                       max_rounds,
-                                                       patient,
-                                                       energy,
-                                                       with_tests,
-                                                       metric_initializer,
-                                                       energy_initialiser,
-                                                       bigbang,
-                                                       do_balance_labels);
+    lp_zentas_base<SparseVectorDataRooted<SparseVectorDataRootedIn<T>>>(
+      metric_initializer.p,
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels,
+      0,
+      reorder_interval);
   }
 
   else
   {
-    zentas_base<SparseVectorData<SparseVectorDataUnrootedIn<T>>,
-                LpMetric<SparseVectorDataUnrootedIn<T>>>(datain_ib,
-                                                         K,
-                                                         indices_init,
-                                                         initialisation_method,
-                                                         algorithm,
-                                                         level,
-                                                         max_proposals,
-                                                         capture_output,
-                                                         text,
-                                                         seed,
-                                                         max_time,
-                                                         min_mE,
-                                                         max_itok,
-                                                         indices_final,
-                                                         labels,
-                                                         nthreads,
-                                                         max_rounds,
-                                                         patient,
-                                                         energy,
-                                                         with_tests,
-                                                         metric_initializer,
-                                                         energy_initialiser,
-                                                         bigbang,
-                                                         do_balance_labels);
+    lp_zentas_base<SparseVectorData<SparseVectorDataUnrootedIn<T>>>(
+      metric_initializer.p,
+      datain_ib,
+      K,
+      indices_init,
+      initialisation_method,
+      algorithm,
+      level,
+      max_proposals,
+      capture_output,
+      text,
+      seed,
+      max_time,
+      min_mE,
+      max_itok,
+      indices_final,
+      labels,
+      nthreads,
+      max_rounds,
+      patient,
+      energy,
+      with_tests,
+      metric_initializer,
+      energy_initialiser,
+      bigbang,
+      do_balance_labels);
   }
 }
 
@@ -408,7 +934,8 @@ template void sparse_vector_zentas(size_t              ndata,
                                    std::string         rf_alg,
                                    size_t              rf_max_rounds,
                                    double              rf_max_time,
-                                   bool                do_balance_labels);
+                                   bool                do_balance_labels,
+                                   size_t              reorder_interval);
 
 template void sparse_vector_zentas(size_t              ndata,
                                    const size_t* const sizes,
@@ -441,7 +968,8 @@ template void sparse_vector_zentas(size_t              ndata,
                                    std::string         rf_alg,
                                    size_t              rf_max_rounds,
                                    double              rf_max_time,
-                                   bool                do_balance_labels);
+                                   bool                do_balance_labels,
+                                   size_t              reorder_interval);
 
 /* strings */
 
@@ -478,14 +1006,18 @@ void szentas(size_t              ndata,
              const double* const c_switches_arr,
              double              critical_radius,
              double              exponent_coeff,
-             bool                do_balance_labels)
+             bool                do_balance_labels,
+             size_t              distance_cache_size,
+             std::string         storage,
+             bool                with_profiles)
 {
 
   auto bigbang = std::chrono::high_resolution_clock::now();
 
   EnergyInitialiser energy_initialiser(critical_radius, exponent_coeff);
 
-  std::vector<std::string> possible_metrics       = {"levenshtein", "normalised levenshtein"};
+  std::vector<std::string> possible_metrics = {
+    "levenshtein", "normalised levenshtein", "hamming"};
   bool                     valid_metric           = false;
   std::string              possible_metric_string = " [ ";
   for (auto& possible_metric : possible_metrics)
@@ -503,7 +1035,56 @@ void szentas(size_t              ndata,
 
   possible_metric_string += " ] ";
 
-  if (valid_metric == true)
+  if (storage != "full" && storage != "packed")
+  {
+    throw zentas::zentas_error("Unrecognised storage, `" + storage +
+                               "'. It should be one of full and packed");
+  }
+
+  /* sequences of equal length, packed into words (see hamming.hpp) */
+  if (valid_metric == true && metric.compare("hamming") == 0)
+  {
+    if (with_cost_matrices == true)
+    {
+      throw zentas::zentas_error("with_cost_matrices is true, but there are no costs with the "
+                                 "hamming metric");
+    }
+
+    std::vector<uint64_t> packed;
+    size_t                field_width;
+    size_t                n_words;
+    hamming::set_packed_sequences(ndata, sizes, ptr_datain, packed, field_width, n_words);
+    HammingInitializer metric_initializer(field_width, ndata == 0 ? 0 : sizes[0]);
+
+    hamming_zentas_base(rooted,
+                        ConstLengthInitBundle<uint64_t>(ndata, n_words, packed.data()),
+                        K,
+                        indices_init,
+                        initialisation_method,
+                        algorithm,
+                        level,
+                        max_proposals,
+                        capture_output,
+                        text,
+                        seed,
+                        max_time,
+                        min_mE,
+                        max_itok,
+                        indices_final,
+                        labels,
+                        nthreads,
+                        max_rounds,
+                        patient,
+                        energy,
+                        with_tests,
+                        metric_initializer,
+                        energy_initialiser,
+                        bigbang,
+                        do_balance_labels,
+                        distance_cache_size);
+  }
+
+  else if (valid_metric == true)
   {  // (metric.compare("levenshtein") == 0 || metric.compare("normalised levenshtein") == 0){
 
     bool normalised = false;
@@ -543,64 +1124,44 @@ void szentas(size_t              ndata,
         LevenshteinInitializer(dict_size, c_indel_arr, c_switches_arr, normalised);  //
     }
 
-    VariableLengthInitBundle<T> datain_ib(ndata, sizes, ptr_datain);
-    if (rooted == true)
+    /* the profiles are only built if they can pay off for sequences of the mean size */
+    double mean_size = 0;
+    for (size_t i = 0; i < ndata; ++i)
     {
-      zentas_base<SDataRooted<StringDataRootedIn<T>>, LevenshteinMetric<StringDataRootedIn<T>>>(
-        datain_ib,
-        K,
-        indices_init,
-        initialisation_method,
-        algorithm,
-        level,
-        max_proposals,
-        capture_output,
-        text,
-        seed,
-        max_time,
-        min_mE,
-        max_itok,
-        indices_final,
-        labels,
-        nthreads,
-        max_rounds,
-        patient,
-        energy,
-        with_tests,
-        metric_initializer,
-        energy_initialiser,
-        bigbang,
-        do_balance_labels);
-    }
-
-    else
-    {
-      zentas_base<SData<StringDataUnrootedIn<T>>, LevenshteinMetric<StringDataUnrootedIn<T>>>(
-        datain_ib,
-        K,
-        indices_init,
-        initialisation_method,
-        algorithm,
-        level,
-        max_proposals,
-        capture_output,
-        text,
-        seed,
-        max_time,
-        min_mE,
-        max_itok,
-        indices_final,
-        labels,
-        nthreads,
-        max_rounds,
-        patient,
-        energy,
-        with_tests,
-        metric_initializer,
-        energy_initialiser,
-        bigbang,
-        do_balance_labels);
+      mean_size += static_cast<double>(sizes[i]) / static_cast<double>(ndata);
     }
+    VariableLengthInitBundle<T> datain_ib(
+      ndata,
+      sizes,
+      ptr_datain,
+      with_profiles && metric_initializer.profiles_can_pay_off(mean_size));
+    levenshtein_zentas_base<T>(storage,
+                               rooted,
+                               datain_ib,
+                               K,
+                               indices_init,
+                               initialisation_method,
+                               algorithm,
+                               level,
+                               max_proposals,
+                               capture_output,
+                               text,
+                               seed,
+                               max_time,
+                               min_mE,
+                               max_itok,
+                               indices_final,
+                               labels,
+                               nthreads,
+                               max_rounds,
+                               patient,
+                               energy,
+                               with_tests,
+                               metric_initializer,
+                               energy_initialiser,
+                               bigbang,
+                               do_balance_labels,
+                               distance_cache_size);
   }
 
   else
@@ -644,7 +1205,10 @@ template void szentas(size_t              ndata,
                       const double* const c_switches_arr,
                       double              critical_radius,
                       double              exponent_coeff,
-                      bool                do_balance_labels);
+                      bool                do_balance_labels,
+                      size_t              distance_cache_size,
+                      std::string         storage,
+                      bool                with_profiles);
 
 template void szentas(size_t              ndata,
                       const size_t* const sizes,
@@ -678,6 +1242,230 @@ template void szentas(size_t              ndata,
                       const double* const c_switches_arr,
                       double              critical_radius,
                       double              exponent_coeff,
-                      bool                do_balance_labels);
+                      bool                do_balance_labels,
+                      size_t              distance_cache_size,
+                      std::string         storage,
+                      bool                with_profiles);
+
+/* packed binary vectors */
+
+void bvzentas(size_t                ndata,
+              size_t                n_bits,
+              const uint64_t* const ptr_datain,
+              size_t                K,
+              const size_t* const   indices_init,
+              std::string           initialisation_method,
+              std::string           algorithm,
+              size_t                level,
+              size_t                max_proposals,
+              bool                  capture_output,
+              std::string&          text,
+              size_t                seed,
+              double                max_time,
+              double                min_mE,
+              double                max_itok,
+              size_t* const         indices_final,
+              size_t* const         labels,
+              size_t                nthreads,
+              size_t                max_rounds,
+              bool                  patient,
+              std::string           energy,
+              bool                  with_tests,
+              bool                  rooted,
+              size_t                distance_cache_size,
+              double                critical_radius,
+              double                exponent_coeff,
+              bool                  do_balance_labels)
+{
+
+  auto bigbang = std::chrono::high_resolution_clock::now();
+
+  EnergyInitialiser energy_initialiser(critical_radius, exponent_coeff);
+
+  /* the bits beyond n_bits in the last word of a sample are not part of it, and are cleared in
+   * a copy if any is set */
+  size_t                n_words         = (n_bits + 63) / 64;
+  const uint64_t*       true_ptr_datain = ptr_datain;
+  std::vector<uint64_t> v_cleared;
+  if (n_bits % 64 != 0)
+  {
+    uint64_t sample_bits = (uint64_t(1) << (n_bits % 64)) - 1;
+    for (size_t i = 0; i < ndata && true_ptr_datain == ptr_datain; ++i)
+    {
+      if ((ptr_datain[i * n_words + n_words - 1] & ~sample_bits) != 0)
+      {
+        v_cleared.assign(ptr_datain, ptr_datain + ndata * n_words);
+        for (size_t i2 = 0; i2 < ndata; ++i2)
+        {
+          v_cleared[i2 * n_words + n_words - 1] &= sample_bits;
+        }
+        true_ptr_datain = v_cleared.data();
+      }
+    }
+  }
+
+  HammingInitializer metric_initializer(1, n_bits);
+
+  hamming_zentas_base(rooted,
+                      ConstLengthInitBundle<uint64_t>(ndata, n_words, true_ptr_datain),
+                      K,
+                      indices_init,
+                      initialisation_method,
+                      algorithm,
+                      level,
+                      max_proposals,
+                      capture_output,
+                      text,
+                      seed,
+                      max_time,
+                      min_mE,
+                      max_itok,
+                      indices_final,
+                      labels,
+                      nthreads,
+                      max_rounds,
+                      patient,
+                      energy,
+                      with_tests,
+                      metric_initializer,
+                      energy_initialiser,
+                      bigbang,
+                      do_balance_labels,
+                      distance_cache_size);
+}
+
+/* time series */
+
+template <typename T>
+void tszentas(size_t              ndata,
+              const size_t* const sizes,
+              const T* const      ptr_datain,
+              size_t              K,
+              const size_t* const indices_init,
+              std::string         initialisation_method,
+              std::string         algorithm,
+              size_t              level,
+              size_t              max_proposals,
+              bool                capture_output,
+              std::string&        text,
+              size_t              seed,
+              double              max_time,
+              double              min_mE,
+              double              max_itok,
+              size_t* const       indices_final,
+              size_t* const       labels,
+              std::string         metric,
+              size_t              nthreads,
+              size_t              max_rounds,
+              bool                patient,
+              std::string         energy,
+              bool                with_tests,
+              bool                rooted,
+              size_t              window,
+              size_t              distance_cache_size,
+              double              critical_radius,
+              double              exponent_coeff,
+              bool                do_balance_labels)
+{
+
+  auto bigbang = std::chrono::high_resolution_clock::now();
+
+  EnergyInitialiser energy_initialiser(critical_radius, exponent_coeff);
+
+  if (metric.compare("dtw") != 0)
+  {
+    throw zentas::zentas_error("Currently, only metric dtw is implemented for time series, not " +
+                               metric);
+  }
+
+  DTWInitializer metric_initializer(window);
+
+  dtw_zentas_base<T>(rooted,
+                     VariableLengthInitBundle<T>(ndata, sizes, ptr_datain),
+                     K,
+                     indices_init,
+                     initialisation_method,
+                     algorithm,
+                     level,
+                     max_proposals,
+                     capture_output,
+                     text,
+                     seed,
+                     max_time,
+                     min_mE,
+                     max_itok,
+                     indices_final,
+                     labels,
+                     nthreads,
+                     max_rounds,
+                     patient,
+                     energy,
+                     with_tests,
+                     metric_initializer,
+                     energy_initialiser,
+                     bigbang,
+                     do_balance_labels,
+                     distance_cache_size);
+}
+
+template void tszentas(size_t              ndata,
+                       const size_t* const sizes,
+                       const float* const  ptr_datain,
+                       size_t              K,
+                       const size_t* const indices_init,
+                       std::string         initialisation_method,
+                       std::string         algorithm,
+                       size_t              level,
+                       size_t              max_proposals,
+                       bool                capture_output,
+                       std::string&        text,
+                       size_t              seed,
+                       double              max_time,
+                       double              min_mE,
+                       double              max_itok,
+                       size_t* const       indices_final,
+                       size_t* const       labels,
+                       std::string         metric,
+                       size_t              nthreads,
+                       size_t              max_rounds,
+                       bool                patient,
+                       std::string         energy,
+                       bool                with_tests,
+                       bool                rooted,
+                       size_t              window,
+                       size_t              distance_cache_size,
+                       double              critical_radius,
+                       double              exponent_coeff,
+                       bool                do_balance_labels);
+
+template void tszentas(size_t              ndata,
+                       const size_t* const sizes,
+                       const double* const ptr_datain,
+                       size_t              K,
+                       const size_t* const indices_init,
+                       std::string         initialisation_method,
+                       std::string         algorithm,
+                       size_t              level,
+                       size_t              max_proposals,
+                       bool                capture_output,
+                       std::string&        text,
+                       size_t              seed,
+                       double              max_time,
+                       double              min_mE,
+                       double              max_itok,
+                       size_t* const       indices_final,
+                       size_t* const       labels,
+                       std::string         metric,
+                       size_t              nthreads,
+                       size_t              max_rounds,
+                       bool                patient,
+                       std::string         energy,
+                       bool                with_tests,
+                       bool                rooted,
+                       size_t              window,
+                       size_t              distance_cache_size,
+                       double              critical_radius,
+                       double              exponent_coeff,
+                       bool                do_balance_labels);
 
 }  // namespace nszen
@@ -17,7 +17,7 @@ std::map<std::string, std::string> init_rf_dict()
   return {
     {"do_refinement",
      "whether or not to perform refinement (which is K-Means in l2 with "
-     "quadratic energy) after K-Medoids halts"},
+     "quadratic energy, and K-Medians in l1 with identity energy) after K-Medoids halts"},
     {"rf_alg",
      "the algorithm to use for refinement. Currently it is one of "
      "`exponion' and `yinyang'. `exponion' is generally best in low (<5) "
@@ -32,6 +32,35 @@ const std::map<std::string, std::string>& get_rf_dict()
   return rf_dict;
 }
 
+std::string get_distance_cache_size_string()
+{
+  return "the number of distances to keep in a cache, keyed by pairs of samples, or 0 for no "
+         "cache. clarans computes many of the same distances repeatedly, to centers which have "
+         "not changed and to proposals which have been rejected before. For long sequences, "
+         "where a distance is expensive, a cache of a few million distances (24 bytes each) can "
+         "avoid many of them. The hit rate is reported as `hits' in the round summaries.";
+}
+
+std::string get_reorder_interval_string()
+{
+  return "only an option when rooted is true. If positive, the data is copied (in parallel) in "
+         "the order of the clusters after initialisation and every reorder_interval rounds, so "
+         "that the samples of a cluster are contiguous, as when rooted is false, until they are "
+         "reassigned. This uses as much memory again as the data. With a small interval there "
+         "is more copying, with a large interval the clusters become scattered. 0 for no "
+         "reordering.";
+}
+
+std::string get_sequence_storage_string()
+{
+  return "one of `full' and `packed'. With `packed', each value of a sequence is stored as a "
+         "code of 2 bits if there are at most 4 distinct values (nucleotides), or 4 bits if "
+         "there are at most 16 (nucleotides with the IUPAC ambiguity codes), and unpacked "
+         "for each distance. This is 4x to 16x less memory than `full' for char sequences, "
+         "at a small cost in speed. With more than 16 distinct values, `packed' is not "
+         "available.";
+}
+
 std::map<std::string, std::string> init_seq_dict()
 {
   return {
@@ -43,7 +72,12 @@ std::map<std::string, std::string> init_seq_dict()
      "base/char/int, or a single value if the cost is the same for all bases."},
     {"cost_switch",
      "the cost of a switch (a.k.a.  a `subsitution'). Either a single value, or an "
-     "array of size (number of bases)*(number of bases)"},
+     "array of size (number of bases)*(number of bases). When cost_indel and cost_switch "
+     "are single values and equal, a faster bit-parallel algorithm is used. When all costs "
+     "are integer multiples of a common unit (0.5 say), distances are computed in integers, "
+     "which is faster"},
+    {"distance_cache_size", get_distance_cache_size_string()},
+    {"storage", get_sequence_storage_string()},
   };
 }
 const std::map<std::string, std::string>& get_seq_dict()
@@ -58,6 +92,7 @@ std::map<std::string, std::string> init_spa_dict()
     {"sizes", "an array containing the number of non-zero elements of each sparse vector"},
     {"indices", "the indices at which the values are non-zero"},
     {"values", "the non-zero values"},
+    {"reorder_interval", get_reorder_interval_string()},
   };
 
   for (auto& x : get_rf_dict())
@@ -81,6 +116,14 @@ std::map<std::string, std::string> init_den_dict()
      "enabling earlier stopping. The distances are preserved by the transformation "
      "up to floating point rounding errors, so that clustering results should be "
      "exactly the same, if used or not. "},
+    {"storage",
+     "how the data is stored while clustering, one of `full', `fp16', `bf16' and `int8'. With "
+     "`fp16' and `bf16' each value takes 2 bytes, with `int8' 1 byte, each dimension being "
+     "offset and scaled by its range. This saves memory (when rooted is false, each sample is "
+     "copied) and memory bandwidth, but distances are approximate. The medoids are checked with "
+     "full precision distances at the end : for each cluster, the 16 samples nearest to the "
+     "medoid are tried as medoid. Not available with metric `l2c' or with refinement."},
+    {"reorder_interval", get_reorder_interval_string()},
   };
 
   for (auto& x : get_rf_dict())
@@ -97,6 +140,47 @@ const std::map<std::string, std::string>& get_den_dict()
   return den_dict;
 }
 
+std::map<std::string, std::string> init_bvec_dict()
+{
+  return {
+    {"X",
+     "the binary vectors packed into an array of type np.uint64, ndata x ((n_bits + 63) / 64), "
+     "with bit b of a vector in word b / 64, at position b % 64. The metric is hamming, the "
+     "number of bits at which two vectors differ, whatever metric is."},
+    {"n_bits", "the number of bits of each vector. The bits beyond n_bits are ignored."},
+    {"distance_cache_size", get_distance_cache_size_string()},
+  };
+}
+
+const std::map<std::string, std::string>& get_bvec_dict()
+{
+  static const std::map<std::string, std::string> bvec_dict = init_bvec_dict();
+  return bvec_dict;
+}
+
+std::map<std::string, std::string> init_tseries_dict()
+{
+  return {
+    {"sizes", "an array containing the length of each time series"},
+    {"values",
+     "an array of type np.float32 or np.float64. All of the time series, concatenated. The "
+     "metric should be `dtw'."},
+    {"window",
+     "the width of the Sakoe-Chiba band : x[i] and y[j] can be matched if |i - j| <= window "
+     "(widened to the difference of the lengths of x and y if that is larger). 0 is the l2 "
+     "distance (for series of equal length), and the longest length is unconstrained dtw. A "
+     "narrow band is faster, as the lower bounds LB_Kim and LB_Keogh are tighter and the DP "
+     "smaller."},
+    {"distance_cache_size", get_distance_cache_size_string()},
+  };
+}
+
+const std::map<std::string, std::string>& get_tseries_dict()
+{
+  static const std::map<std::string, std::string> tseries_dict = init_tseries_dict();
+  return tseries_dict;
+}
+
 // TODO : make const static variable of function (so that not constructed unless needed).
 // auto spa_dict = get_spa_dict();
 
@@ -114,6 +198,10 @@ std::map<std::string, std::string> init_txt_seq_dict()
 
     {"outfilename", "where to write the clustering results."},
 
+    {"distance_cache_size", get_distance_cache_size_string()},
+
+    {"storage", get_sequence_storage_string()},
+
     {"costfilename", R"(
    where to obtain the indel and switch costs. file format, either:
 
@@ -184,7 +272,10 @@ std::map<std::string, std::string> init_output_keys()
      "in a distance computation is. For vectors, it counts how many dimensions are actually "
      "looked at before halting, for sequences it measures the ratio of the computed cells "
      "in the dynamic alg. to the total number of cells (product of sequence lengths). "},
-    {"nprops", "(for clarans) the number of rejected proposals before one is accepted."}};
+    {"nprops", "(for clarans) the number of rejected proposals before one is accepted."},
+    {"hits",
+     "(with a distance cache) the fraction of distance queries answered by the cache, since the "
+     "start"}};
 }
 
 const std::map<std::string, std::string>& get_output_keys()
@@ -288,12 +379,25 @@ std::map<std::string, std::tuple<std::string, std::string>> init_parameter_info_
 
   std::stringstream ss_met;
   ss_met << "for sparse vectors and dense vectors, this is one of `l0', `l1', `l1', `li'. For "
-            "sequences it is one of `levenshtein', and `normalised levenshtein' of Yujian (2007). "
+            "sequences it is one of `levenshtein', `normalised levenshtein' of Yujian (2007), and "
+            "`hamming', the number of positions at which sequences of equal length differ. With "
+            "`hamming', the sequences are packed into 64-bit words (2 bits per value for "
+            "nucleotides) and distances are popcounts, and for binary vectors (bvec) it is the "
+            "only metric. For time series (tseries) the metric is `dtw', dynamic time warping, "
+            "which does not satisfy the triangle inequality : with it, clarans is only available "
+            "at level 0. "
             "To illustrate the vector norms, consider vectors in 2-D, {2,2} and {5,6}. The "
             "distance between them is, (l0) 2.0  (l1) 7.0  (l2) 5.0  li (4.0). In particular, l0 "
             "counts how many dimensions the vectors differ in, l1 is the sum of the absolute "
             "differences, l2 is the standard Euclidean distance, and li is the largest absolute "
-            "difference across the dimensions. For more details, see "
+            "difference across the dimensions. For dense vectors, `l2c' is l2 computed as "
+            "||a||^2 + ||b||^2 - 2 a.b with the squared norms of samples and centers cached, which "
+            "is faster than `l2' when the dimension is large. For dense and sparse vectors, "
+            "`cosine' is sqrt(1 - cos(a,b)), so that with energy `quadratic' the energy is the "
+            "sum of the cosine distances 1 - cos(a,b), and `angular' is the angle between a and b "
+            "divided by pi. Both satisfy the triangle inequality, and the samples are scaled to "
+            "unit norm once, so that each distance is a dot product. Neither is available with "
+            "refinement. For more details, see "
          << get_us();
 
   pim["metric"] = std::make_tuple(ss_met.str(), "'l2'");
@@ -539,25 +643,54 @@ std::string get_cluster_func_string(std::vector<std::string> dict_keys,
 
 std::string get_python_txt_seq_string()
 {
-  return get_cluster_func_string({"filenames_list", "outfilename", "costfilename"},
-                                 get_txt_seq_dict());
+  return get_cluster_func_string(
+    {"filenames_list", "outfilename", "costfilename", "distance_cache_size", "storage"},
+    get_txt_seq_dict());
 }
 
 std::string get_python_seq_string()
 {
-  return get_cluster_func_string({"sizes", "values", "cost_indel", "cost_switch"}, get_seq_dict());
+  return get_cluster_func_string(
+    {"sizes", "values", "cost_indel", "cost_switch", "distance_cache_size", "storage"},
+    get_seq_dict());
 }
 
 std::string get_python_spa_string()
 {
   return get_cluster_func_string(
-    {"sizes", "indices", "values", "do_refinement", "rf_alg", "rf_max_rounds", "rf_max_time"},
+    {"sizes",
+     "indices",
+     "values",
+     "do_refinement",
+     "rf_alg",
+     "rf_max_rounds",
+     "rf_max_time",
+     "reorder_interval"},
     get_spa_dict());
 }
 
+std::string get_python_bvec_string()
+{
+  return get_cluster_func_string({"X", "n_bits", "distance_cache_size"}, get_bvec_dict());
+}
+
+std::string get_python_tseries_string()
+{
+  return get_cluster_func_string({"sizes", "values", "window", "distance_cache_size"},
+                                 get_tseries_dict());
+}
+
 std::string get_python_den_string()
 {
   return get_cluster_func_string(
-    {"X", "do_vdimap", "do_refinement", "rf_alg", "rf_max_rounds", "rf_max_time"}, get_den_dict());
+    {"X",
+     "do_vdimap",
+     "do_refinement",
+     "rf_alg",
+     "rf_max_rounds",
+     "rf_max_time",
+     "storage",
+     "reorder_interval"},
+    get_den_dict());
 }
 }